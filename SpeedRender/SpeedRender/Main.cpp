@@ -11,16 +11,32 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <chrono>
+#include <cmath>
 
 #include "Core.h"
 #include "Camera.h"
 #include "Lighting.h"
 #include "Shader.h"
+#include "GLState.h"
 #include "Model.h"
 #include "Mesh.h"
 #include "Texture.h"
 #include "Cubemap.h"
 #include "Skybox.h"
+#include "TextureLoader.h"
+#include "ResourceManager.h"
+#include "Benchmark.h"
+#include "AssetGraph.h"
+#include "ModelLibrary.h"
+#include "StreamingMesh.h"
+#include "StreamingMeshBuilder.h"
+#include "AssetCooker.h"
+#include "AssetPack.h"
+#include "CookedAssets.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
 
 GLenum glCheckError_(const char *file, int line)
 {
@@ -62,7 +78,20 @@ Camera camera(
     glm::vec3(0.0f, 1.0f, 0.0f), WIDTH, HEIGHT
 );
 
-int main() {
+int main(int argc, char **argv) {
+    if (Benchmark::Run(argc, argv)) return 0;
+    if (AssetCooker::Run(argc, argv)) return 0;
+    if (StreamingMeshBuilder::Run(argc, argv)) return 0;
+
+    // --stream <file.srstream> adds an out of core mesh to the scene, --sky <file.hdr> replaces the skybox
+    std::string streamPath, skyPath;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--stream") streamPath = argv[i + 1];
+        if (std::string(argv[i]) == "--sky") skyPath = argv[i + 1];
+    }
+
+    std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+
     // initialization
 	glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -88,205 +117,396 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     glViewport(0, 0, WIDTH, HEIGHT);
-    glEnable(GL_DEPTH_TEST);
-
-    // mesh data
-    Model cube("assets/models/cube.obj");
-    Model sphere("assets/models/sphere.obj"); 
-    Model bunny("assets/models/bunny.obj");
-    Model teapot("assets/models/teapot.obj");
-    Model suzanne("assets/models/suzanne.obj");
-
-    sphere.transform = {
-        glm::vec3(0.0f, -1.703f, 0.0f),
-        glm::vec3(0.0f),
-        glm::vec3(0.025f)
-    };
-
-    bunny.transform = {
-        glm::vec3(0.566f, -0.778f, -0.106f),
-        glm::vec3(0.0f, 0.556f, 0.0f),
-        glm::vec3(1.0f)
-    };
-
-    teapot.transform = {
-        glm::vec3(0.0f, -1.0f, 0.0f),
-        glm::vec3(-1.533f, 0.067f, -2.632f),
-        glm::vec3(0.153f)
-    };
-
-    suzanne.transform = {
-        glm::vec3(0.0f),
-        glm::vec3(-0.566f, 0.556f, 0.29f),
-        glm::vec3(1.241f)
-    };
-
-    // textures
-    Texture::SetFlipImageOnLoad(true);
-    Texture diffuseMap("assets/images/container2.png");
-    Texture specularMap("assets/images/container2_specular.png", "specular");
-    cube.meshes[0].AddTexture(diffuseMap);
-    cube.meshes[0].AddTexture(specularMap);
-
-    // set up shaders
-    Shader unlitShader("assets/shaders/MainVertex.vert", "assets/shaders/Unlit.frag");
-    Shader litShader("assets/shaders/MainVertex.vert", "assets/shaders/LOGL_PBR.frag");
-    Shader emShader("assets/shaders/MainVertex.vert", "assets/shaders/EM_Lit.frag");
-    Shader wireframeShader("assets/shaders/MainVertex.vert", "assets/shaders/Wireframe.frag");
-    Shader normalsShader("assets/shaders/MainVertex.vert", "assets/shaders/TestNormals.frag");
-    Shader uvsShader("assets/shaders/MainVertex.vert", "assets/shaders/TestUVs.frag");
-    Material material = { diffuseMap, specularMap, 32.0f };
-
-    // lights
-    DirectionalLight dirLight(glm::vec3(-0.216f, -0.6f, -0.455f), Color(1.0f, 1.0f, 1.0f),
-        { 
-            glm::vec3(0.2f, 0.2f, 0.2f),
-            glm::vec3(0.5f, 0.5f, 0.5f),
-            glm::vec3(1.0f, 1.0f, 1.0f)
-        });
-
-    enum ShaderState { SS_UNLIT, SS_LIT, SS_EM_LIT, SS_WIREFRAME, SS_NORMALS, SS_UVS, SS_COUNT };
-    int shaderState = SS_LIT;
-    Shader* shader = &litShader;
+    GLState::SetDepthTest(true);
+    // filter across cubemap face edges, the mips would show the seams otherwise
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-    enum ModelState { MS_CUBE, MS_SPHERE, MS_BUNNY, MS_TEAPOT, MS_SUZANNE, MS_COUNT };
-    int modelState = MS_BUNNY;
-    Model* model = &bunny;
-
-    float flatness = 1.0f;
-
-    glm::vec3 albedo(1.0f, 0.0f, 0.0f);
-    float metallic = 0.0f;
-    float roughness = 1.0f;
-    float ao = 0.295f;
-
-    float refractionIndex = 1.3f;
-    float reflectance = 0.5f;
-
-    // skybox
-    stbi_set_flip_vertically_on_load(false);
-    std::vector<std::string> skyboxFaces = {
-        "assets/skyboxes/water/right.jpg",
-        "assets/skyboxes/water/left.jpg",
-        "assets/skyboxes/water/top.jpg",
-        "assets/skyboxes/water/bottom.jpg",
-        "assets/skyboxes/water/front.jpg",
-        "assets/skyboxes/water/back.jpg"
-    }; Skybox skybox(skyboxFaces);
-
-    // render loop
-    while(!glfwWindowShouldClose(window)) {
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+    // scene resources live in this scope so their GL objects are freed while the context still exists
+    {
+        // mapped once up front, every cooked file the loaders ask for afterwards is a view into it
+        const AssetPack &pack = AssetPack::Global();
+        if (pack.IsOpen()) std::cout << "Mounted " << CookedAssets::PackPath() << ": " << pack.Count() << " files" << std::endl;
+
+        // Programs and the skybox are loaded through one graph: shader sources are read and expanded on the
+        // workers while this thread links whatever is ready. Models stream in through the ModelLibrary and
+        // images through the TextureLoader, both on the same workers.
+        AssetGraph startup;
+
+        // half the vertex memory and fetch bandwidth of full floats, see --bench-vertex for the error
+        Mesh::SetDefaultLayout(VertexFormat::Layout::Packed);
+
+        // Models are only registered here. The selected one starts loading right away, the others once
+        // they are selected or predicted, and each draws as a box until it is resident.
+        ModelLibrary library;
+        std::shared_ptr<Texture> diffuseMap, specularMap;
+
+        enum ModelState { MS_CUBE, MS_SPHERE, MS_BUNNY, MS_TEAPOT, MS_SUZANNE, MS_COUNT };
+        ModelLibrary::Handle models[MS_COUNT];
+        models[MS_CUBE] = library.Register("assets/models/cube.obj", { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f) },
+            [&](Model &cube) {
+                // textures are streamed by the TextureLoader, attached whenever the cube (re)appears
+                cube.meshes[0]->AddTexture(diffuseMap);
+                cube.meshes[0]->AddTexture(specularMap);
+            });
+
+        models[MS_SPHERE] = library.Register("assets/models/sphere.obj", {
+            glm::vec3(0.0f, -1.703f, 0.0f),
+            glm::vec3(0.0f),
+            glm::vec3(0.025f)
+        });
 
-        deltaTime = glfwGetTime() - lastTime;
-        lastTime = glfwGetTime();
+        models[MS_BUNNY] = library.Register("assets/models/bunny.obj", {
+            glm::vec3(0.566f, -0.778f, -0.106f),
+            glm::vec3(0.0f, 0.556f, 0.0f),
+            glm::vec3(1.0f)
+        });
 
-        ProcessInput(window);
+        models[MS_TEAPOT] = library.Register("assets/models/teapot.obj", {
+            glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(-1.533f, 0.067f, -2.632f),
+            glm::vec3(0.153f)
+        });
 
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        models[MS_SUZANNE] = library.Register("assets/models/suzanne.obj", {
+            glm::vec3(0.0f),
+            glm::vec3(-0.566f, 0.556f, 0.29f),
+            glm::vec3(1.241f)
+        });
 
-        ImGui::ShowDemoWindow();
+        int modelState = MS_BUNNY;
+        library.Request(models[modelState]);
 
-        {
-            ImGui::PushStyleColor(ImGuiCol_ResizeGrip, 0);
-            ImGui::Begin("Settings");
-            ImGui::Text("Hold RMB to explore");
-
-            const char* model_names[MS_COUNT] = { "Cube", "Sphere", "Bunny", "Teapot", "Suzanne" };
-            const char* shader_names[SS_COUNT] = { "Unlit", "Lit", "Env Mapping", "Wireframe", "Normals", "UVs" };
-            ImGui::Combo("Model", &modelState, model_names, IM_ARRAYSIZE(model_names));
-            ImGui::Combo("Shader", &shaderState, shader_names, IM_ARRAYSIZE(shader_names));
-
-            ImGui::ColorEdit3("Albedo", (float*)&albedo);
-            ImGui::SliderFloat("Metallic", &metallic, 0.0f, 1.0f);
-            ImGui::SliderFloat("Roughness", &roughness, 0.0f, 1.0f);
-            ImGui::SliderFloat("AO", &ao, 0.0f, 1.0f);
-
-            ImGui::SliderFloat("Refraction", &refractionIndex, 0.0f, 2.0f);
-            ImGui::SliderFloat("Reflectance", &reflectance, 0.0f, 1.0f);
-
-            if (shaderState == SS_UNLIT) shader = &unlitShader;
-            else if (shaderState == SS_LIT) shader = &litShader;
-            else if (shaderState == SS_EM_LIT) shader = &emShader;
-            else if (shaderState == SS_WIREFRAME) shader = &wireframeShader;
-            else if (shaderState == SS_NORMALS) shader = &normalsShader;
-            else if (shaderState == SS_UVS) shader = &uvsShader;
-
-            if (modelState == MS_CUBE) model = &cube;
-            else if (modelState == MS_SPHERE) model = &sphere;
-            else if (modelState == MS_BUNNY) model = &bunny;
-            else if (modelState == MS_TEAPOT) model = &teapot;
-            else if (modelState == MS_SUZANNE) model = &suzanne;
-
-            if (ImGui::Button("Fracture")) { }
-            ImGui::SameLine();
-            if (ImGui::Button("Reset")) { }
-            ImGui::End();
-
-            ImGui::Begin("FPS", (bool*)true, ImGuiWindowFlags_NoTitleBar);
-            ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
-            ImGui::End();
-            ImGui::PopStyleColor();
-        }
+        startup.Add("container2 textures", nullptr, [&]() {
+            Texture::SetFlipImageOnLoad(true);
+            diffuseMap = ResourceManager::GetTexture("assets/images/container2.png");
+            specularMap = ResourceManager::GetTexture("assets/images/container2_specular.png", "specular");
+        });
 
-        glm::mat4 m = model->GetModelMatrix();
-        glm::mat4 v = camera.GetViewMatrix();
-        glm::mat4 p = camera.GetProjectionMatrix();
-
-        shader->Use();
-        shader->SetMat4("model", m);
-        shader->SetMat4("view", v);
-        shader->SetMat4("projection", p);
-
-        if (shaderState == SS_UNLIT) {
-            shader->SetVec3("mainColor", glm::vec3(1.0f, 1.0f, 1.0f)); 
-        } else if (shaderState == SS_LIT) {
-            //shader->SetVec3("dirLight.direction", dirLight.direction);
-            //shader->SetVec3("dirLight.color", dirLight.color);
-            //shader->SetVec3("dirLight.ambient", dirLight.lightProfile.ambient);
-            //shader->SetVec3("dirLight.diffuse", dirLight.lightProfile.diffuse);
-            //shader->SetVec3("dirLight.specular", dirLight.lightProfile.specular);
-            //shader->SetFloat("material.shininess", material.shininess);
-            
-            // material
-            shader->SetVec3("albedo", albedo);
-            shader->SetFloat("metallic", metallic);
-            shader->SetFloat("roughness", roughness);
-            shader->SetFloat("ao", ao);
-            // lights
-            shader->SetVec3("lightPositions[0]", glm::vec3(1.0f, 5.0f, 0.0f));
-            shader->SetVec3("lightPositions[1]", glm::vec3(-1.0f, -5.0f, 0.0f));
-            shader->SetVec3("lightPositions[2]", glm::vec3(0.0f, 0.0f, 1.0f));
-            shader->SetVec3("lightPositions[3]", glm::vec3(3.0f, 0.0f, -1.0f));
-            shader->SetVec3("lightColors[0]", glm::vec3(1.0f, 1.0f, 1.0f));
-            shader->SetVec3("lightColors[1]", glm::vec3(1.0f, 1.0f, 1.0f));
-            shader->SetVec3("lightColors[2]", glm::vec3(1.0f, 1.0f, 1.0f));
-            shader->SetVec3("lightColors[3]", glm::vec3(1.0f, 1.0f, 1.0f));
-
-            shader->SetVec3("cameraPos", camera.position);
-        } else if (shaderState == SS_EM_LIT) {
-            shader->SetVec3("cameraPos", camera.position);
-            shader->SetFloat("refractionIndex", refractionIndex);
-            shader->SetFloat("reflectance", reflectance);
-        } else if (shaderState == SS_WIREFRAME) {
-            shader->SetVec3("wireColor", glm::vec3(0.25f, 0.5f, 0.7f)); 
-            shader->SetFloat("bFlat", flatness);
+        // point lights for the PBR shader
+        std::vector<glm::vec3> lightPositions = {
+            glm::vec3(1.0f, 5.0f, 0.0f),
+            glm::vec3(-1.0f, -5.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f),
+            glm::vec3(3.0f, 0.0f, -1.0f)
+        };
+        std::vector<glm::vec3> lightColors(lightPositions.size(), glm::vec3(1.0f, 1.0f, 1.0f));
+
+        // camera and lights once per frame for every program, transforms and material per draw
+        UniformBuffer<UniformBlocks::Frame> frameBlock;
+        UniformBuffer<UniformBlocks::Object> objectBlock(16);
+        UniformBuffer<UniformBlocks::Material> materialBlock(16);
+        RenderQueue queue(objectBlock);
+
+        // set up shaders, the lit shader is specialized for the light count and for textured models
+        ShaderPreprocessor::Defines litDefines = { "NR_LIGHTS " + std::to_string(lightPositions.size()) };
+        ShaderPreprocessor::Defines litTexturedDefines = litDefines;
+        litTexturedDefines.push_back("HAS_ALBEDO_MAP");
+
+        std::shared_ptr<Shader> unlitShader, litShader, litTexturedShader, emShader, wireframeShader, normalsShader, uvsShader, placeholderShader;
+        // sources are read and expanded on a worker, this thread only compiles and links
+        auto loadProgram = [&startup](std::shared_ptr<Shader> &shader, const std::string &vertexPath, const std::string &fragmentPath,
+                                      const ShaderPreprocessor::Defines &defines = {}) {
+            std::string name = fragmentPath + " " + ShaderPreprocessor::DefinesKey(defines);
+            std::shared_ptr<Shader::Source> source = std::make_shared<Shader::Source>();
+            return startup.Add(name, [source, vertexPath, fragmentPath, defines]() {
+                *source = Shader::Preprocess(vertexPath, fragmentPath, defines);
+            }, [&shader, source, vertexPath, fragmentPath, defines]() {
+                shader = ResourceManager::GetShader(vertexPath, fragmentPath, defines, *source);
+            });
+        };
+        auto loadShader = [&loadProgram](std::shared_ptr<Shader> &shader, const std::string &fragmentPath,
+                                         const ShaderPreprocessor::Defines &defines = {}) {
+            return loadProgram(shader, "assets/shaders/MainVertex.vert", fragmentPath, defines);
+        };
+        loadShader(unlitShader, "assets/shaders/Unlit.frag");
+        loadShader(litShader, "assets/shaders/LOGL_PBR.frag", litDefines);
+        loadShader(litTexturedShader, "assets/shaders/LOGL_PBR.frag", litTexturedDefines);
+        loadShader(emShader, "assets/shaders/EM_Lit.frag");
+        loadShader(wireframeShader, "assets/shaders/Wireframe.frag");
+        loadShader(normalsShader, "assets/shaders/TestNormals.frag");
+        loadShader(uvsShader, "assets/shaders/TestUVs.frag");
+        loadShader(placeholderShader, "assets/shaders/Placeholder.frag");
+
+        // instanced twins of the unlit and lit shaders for the instance grid
+        ShaderPreprocessor::Defines instancedLitDefines = litDefines;
+        instancedLitDefines.push_back("INSTANCED");
+        std::shared_ptr<Shader> instancedUnlitShader, instancedLitShader;
+        loadShader(instancedUnlitShader, "assets/shaders/Unlit.frag", { "INSTANCED" });
+        loadShader(instancedLitShader, "assets/shaders/LOGL_PBR.frag", instancedLitDefines);
+
+        // lights
+        DirectionalLight dirLight(glm::vec3(-0.216f, -0.6f, -0.455f), Color(1.0f, 1.0f, 1.0f),
+            { 
+                glm::vec3(0.2f, 0.2f, 0.2f),
+                glm::vec3(0.5f, 0.5f, 0.5f),
+                glm::vec3(1.0f, 1.0f, 1.0f)
+            });
+
+        enum ShaderState { SS_UNLIT, SS_LIT, SS_EM_LIT, SS_WIREFRAME, SS_NORMALS, SS_UVS, SS_COUNT };
+        int shaderState = SS_LIT;
+        Shader* shader = nullptr;
+
+        Model* model = &library.Get(models[modelState]);
+        float modelMemory = library.memoryBudget / (1024.0f * 1024.0f);
+
+        // a grid of copies of the current model behind it, drawn with one instanced draw per mesh
+        InstanceBuffer instances;
+        int instanceCount = 0;
+        int instanceLod = 0;
+        bool animateInstances = false;
+
+        std::unique_ptr<StreamingMesh> streaming;
+        if (!streamPath.empty()) streaming.reset(new StreamingMesh(streamPath));
+        float streamingMemory = streaming ? streaming->ramBudget / (1024.0f * 1024.0f) : 0.0f;
+
+        float flatness = 1.0f;
+        float lodThreshold = Model::GetLodThreshold();
+        bool meshletCulling = Model::GetMeshletCulling();
+
+        glm::vec3 albedo(1.0f, 0.0f, 0.0f);
+        float metallic = 0.0f;
+        float roughness = 1.0f;
+        float ao = 0.295f;
+
+        float refractionIndex = 1.3f;
+        float reflectance = 0.5f;
+
+        // skybox
+        std::vector<std::string> skyboxFaces = {
+            "assets/skyboxes/water/right.jpg",
+            "assets/skyboxes/water/left.jpg",
+            "assets/skyboxes/water/top.jpg",
+            "assets/skyboxes/water/bottom.jpg",
+            "assets/skyboxes/water/front.jpg",
+            "assets/skyboxes/water/back.jpg"
+        };
+        if (!skyPath.empty()) skyboxFaces = { skyPath };
+        std::unique_ptr<Skybox> skybox;
+        // held so the skybox finds its program already linked
+        std::shared_ptr<Shader> skyboxShader;
+        AssetGraph::Handle skyboxProgram = loadProgram(skyboxShader, "assets/shaders/Skybox.vert", "assets/shaders/Skybox.frag");
+        startup.Add("skybox", nullptr, [&]() {
+            Texture::SetFlipImageOnLoad(false);
+            skybox.reset(new Skybox(skyboxFaces));
+        }, { skyboxProgram });
+
+        startup.Run();
+
+        ResourceManager::WarmUpShaders();
+        placeholderShader->polygonMode = GL_LINE;
+        startup.PrintTimings();
+        ResourceManager::PrintStats();
+        double timeToFirstFrame = 0.0;
+
+        // render loop
+        while(!glfwWindowShouldClose(window)) {
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            // the last frame's uniform traffic, shown in the FPS window
+            Shader::UniformStats uniformStats = Shader::GetUniformStats();
+            UniformBlocks::Stats blockStats = UniformBlocks::GetStats();
+            GLState::Stats stateStats = GLState::GetStats();
+            Shader::ResetUniformStats();
+            UniformBlocks::ResetStats();
+            GLState::ResetStats();
+            InstanceBuffer::Stats instanceStats = instances.GetStats();
+            instances.ResetStats();
+
+            deltaTime = glfwGetTime() - lastTime;
+            lastTime = glfwGetTime();
+
+            ProcessInput(window);
+
+            // stream in pending textures, bounded per frame so loads never hitch
+            TextureLoader::Get().Update();
+            library.Update();
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            ImGui::ShowDemoWindow();
+
+            {
+                ImGui::PushStyleColor(ImGuiCol_ResizeGrip, 0);
+                ImGui::Begin("Settings");
+                ImGui::Text("Hold RMB to explore");
+
+                const char* model_names[MS_COUNT] = { "Cube", "Sphere", "Bunny", "Teapot", "Suzanne" };
+                const char* shader_names[SS_COUNT] = { "Unlit", "Lit", "Env Mapping", "Wireframe", "Normals", "UVs" };
+                ImGui::Combo("Model", &modelState, model_names, IM_ARRAYSIZE(model_names));
+                ImGui::Combo("Shader", &shaderState, shader_names, IM_ARRAYSIZE(shader_names));
+
+                ImGui::ColorEdit3("Albedo", (float*)&albedo);
+                ImGui::SliderFloat("Metallic", &metallic, 0.0f, 1.0f);
+                ImGui::SliderFloat("Roughness", &roughness, 0.0f, 1.0f);
+                ImGui::SliderFloat("AO", &ao, 0.0f, 1.0f);
+
+                ImGui::SliderFloat("Refraction", &refractionIndex, 0.0f, 2.0f);
+                ImGui::SliderFloat("Reflectance", &reflectance, 0.0f, 1.0f);
+
+                if (ImGui::SliderFloat("LOD error (px)", &lodThreshold, 0.0f, 16.0f)) Model::SetLodThreshold(lodThreshold);
+                if (ImGui::Checkbox("Meshlet culling", &meshletCulling)) Model::SetMeshletCulling(meshletCulling);
+                ImGui::Text("%d triangles", (int)queue.GetStats().trianglesDrawn);
+
+                model = &library.Get(models[modelState]);
+                bool placeholder = !library.IsResident(models[modelState]);
+                // the next pick is most likely a neighbour in the combo, fetch those once the current one is in
+                if (!placeholder) {
+                    library.Prefetch(models[(modelState + 1) % MS_COUNT]);
+                    library.Prefetch(models[(modelState + MS_COUNT - 1) % MS_COUNT]);
+                }
+
+                if (shaderState == SS_UNLIT) shader = unlitShader.get();
+                else if (shaderState == SS_LIT) shader = model->HasTexture("diffuse") ? litTexturedShader.get() : litShader.get();
+                else if (shaderState == SS_EM_LIT) shader = emShader.get();
+                else if (shaderState == SS_WIREFRAME) shader = wireframeShader.get();
+                else if (shaderState == SS_NORMALS) shader = normalsShader.get();
+                else if (shaderState == SS_UVS) shader = uvsShader.get();
+                if (placeholder) shader = placeholderShader.get();
+
+                if (ImGui::Button("Fracture")) { }
+                ImGui::SameLine();
+                if (ImGui::Button("Reset")) { }
+
+                if (ImGui::CollapsingHeader("Instances")) {
+                    ImGui::SliderInt("Count", &instanceCount, 0, 10000);
+                    ImGui::SliderInt("LOD", &instanceLod, 0, 7);
+                    ImGui::Checkbox("Animate", &animateInstances);
+                    ImGui::Text("%d instances, %u uploads of %.1f KB last frame", (int)instances.Size(), instanceStats.uploads,
+                                instanceStats.bytes / 1024.0);
+                }
+
+                if (ImGui::CollapsingHeader("Models")) {
+                    if (ImGui::SliderFloat("Memory budget (MB)", &modelMemory, 1.0f, 1024.0f))
+                        library.memoryBudget = (size_t)(modelMemory * 1024.0f * 1024.0f);
+                    ImGui::Text("%d of %d resident, %.1f MB, %d loading", (int)library.GetResidentCount(), (int)library.Count(),
+                                library.GetResidentBytes() / (1024.0 * 1024.0), (int)library.GetLoadingCount());
+                    for (int i = 0; i < MS_COUNT; i++)
+                        ImGui::Text("%-10s %s", model_names[i], library.IsResident(models[i]) ? "resident" :
+                                    library.IsLoading(models[i]) ? "loading" : library.IsFailed(models[i]) ? "failed" : "-");
+                }
+
+                if (streaming && ImGui::CollapsingHeader("Streaming")) {
+                    const StreamingMesh::Stats &stats = streaming->GetStats();
+                    if (ImGui::SliderFloat("Read budget (MB)", &streamingMemory, 1.0f, 1024.0f))
+                        streaming->ramBudget = (size_t)(streamingMemory * 1024.0f * 1024.0f);
+                    ImGui::Text("%d of %d chunks resident in %d slots, %.1f MB VRAM", (int)stats.residentChunks, (int)streaming->GetChunkCount(),
+                                (int)streaming->GetSlotCount(), stats.vramBytes / (1024.0 * 1024.0));
+                    ImGui::Text("%d loading, %.1f MB RAM (peak %.1f MB)", (int)stats.loadingChunks, stats.ramBytes / (1024.0 * 1024.0),
+                                stats.peakRamBytes / (1024.0 * 1024.0));
+                    ImGui::Text("%d loads, %d evictions, %d triangles", (int)stats.loads, (int)stats.evictions, (int)stats.trianglesDrawn);
+                }
+
+                if (ImGui::CollapsingHeader("Startup")) {
+                    ImGui::Text("First frame after %.1f ms, graph took %.1f ms", timeToFirstFrame, startup.GetTotalMs());
+                    for (const AssetGraph::Timing &timing : startup.GetTimings())
+                        ImGui::Text("%-36s %7.1f worker %6.1f GL  done %7.1f", timing.name.c_str(), timing.workMs, timing.finishMs, timing.doneMs);
+                    ImGui::Separator();
+                    for (const TextureLoader::Timing &timing : TextureLoader::Get().GetTimings())
+                        ImGui::Text("%-36s %7.1f ms to upload", timing.path.c_str(), timing.ms);
+                }
+                ImGui::End();
+
+                ImGui::Begin("FPS", (bool*)true, ImGuiWindowFlags_NoTitleBar);
+                ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+                ImGui::Text("%u uniforms set, %u unchanged, %u inactive", uniformStats.issued, uniformStats.skipped, uniformStats.inactive);
+                ImGui::Text("%u uniform blocks written, %u unchanged", blockStats.uploads, blockStats.skipped);
+                ImGui::Text("%u state changes, %u redundant ones dropped", stateStats.issued, stateStats.skipped);
+                const RenderQueue::Stats &queueStats = queue.GetStats();
+                ImGui::Text("%d packets, sorting saved %d of %d program/texture/mesh switches", (int)queueStats.packets,
+                            (int)queueStats.submittedChanges - (int)queueStats.sortedChanges, (int)queueStats.submittedChanges);
+                if (TextureLoader::Get().PendingCount() > 0)
+                    ImGui::Text("Streaming %d textures", (int)TextureLoader::Get().PendingCount());
+                ImGui::End();
+                ImGui::PopStyleColor();
+            }
+
+            glm::mat4 v = camera.GetViewMatrix();
+            glm::mat4 p = camera.GetProjectionMatrix();
+
+            UniformBlocks::Frame frame = {};
+            frame.view = v;
+            frame.projection = p;
+            frame.viewProjection = p * v;
+            frame.cameraPos = camera.position;
+            frame.lightCount = (int)std::min(lightPositions.size(), (size_t)UniformBlocks::MAX_LIGHTS);
+            for (int i = 0; i < frame.lightCount; i++) {
+                frame.lightPositions[i] = lightPositions[i];
+                frame.lightColors[i] = lightColors[i];
+            }
+            frameBlock.Push(frame);
+
+            UniformBlocks::Material material = {};
+            material.albedo = albedo;
+            material.metallic = metallic;
+            material.roughness = roughness;
+            material.ao = ao;
+            material.refractionIndex = refractionIndex;
+            material.reflectance = reflectance;
+            material.flatness = flatness;
+            if (shader == placeholderShader.get()) material.color = glm::vec3(0.8f, 0.8f, 0.8f);
+            else if (shaderState == SS_WIREFRAME) material.color = glm::vec3(0.25f, 0.5f, 0.7f);
+            else material.color = glm::vec3(1.0f, 1.0f, 1.0f);
+            materialBlock.Push(material);
+
+            // only samplers are left as plain uniforms
+            shader->Use();
+            if (shader == litTexturedShader.get()) shader->SetInt("albedoMap", 0);
+
+            // everything is submitted, the queue decides the order
+            queue.Begin(p * v, camera.position);
+            model->Submit(queue, *shader, camera);
+
+            if (streaming) {
+                streaming->Update(p * v, camera.position);
+                queue.Submit(RenderQueue::Pass::Opaque, [&]() {
+                    objectBlock.Push(UniformBlocks::Object::FromModel(glm::mat4(1.0f)));
+                    return streaming->Draw(*shader, p * v);
+                }, shader);
+            }
+
+            if (instances.Size() != (size_t)instanceCount || animateInstances) {
+                // only instances whose transform changes are uploaded again
+                size_t previous = animateInstances ? 0 : std::min(instances.Size(), (size_t)instanceCount);
+                instances.Resize(instanceCount);
+                int side = (int)std::ceil(std::sqrt((double)instanceCount));
+                for (size_t i = previous; i < (size_t)instanceCount; i++) {
+                    float x = ((int)(i % side) - side * 0.5f) * 2.5f, z = -2.5f * (float)(i / side + 2);
+                    float y = animateInstances ? 0.5f * std::sin((float)glfwGetTime() * 2.0f + x * 0.3f + z * 0.2f) : 0.0f;
+                    instances.Set(i, glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z)));
+                    instances.SetColor(i, glm::vec4(0.6f + 0.4f * std::sin(i * 0.37f), 0.6f + 0.4f * std::sin(i * 0.71f), 0.6f + 0.4f * std::sin(i * 1.13f), 1.0f));
+                }
+            }
+            if (instances.Size() > 0 && shader != placeholderShader.get()) {
+                Shader *instancedShader = shaderState == SS_LIT ? instancedLitShader.get() : instancedUnlitShader.get();
+                queue.Submit(RenderQueue::Pass::Opaque, [&, instancedShader]() {
+                    return model->DrawInstanced(*instancedShader, instances, instanceLod);
+                }, instancedShader);
+            }
+
+            queue.Submit(RenderQueue::Pass::Skybox, [&]() {
+                skybox->Draw();
+                return (size_t)12;
+            });
+            queue.Submit(RenderQueue::Pass::UI, []() {
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+                return (size_t)0;
+            });
+            queue.Flush();
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+
+            if (timeToFirstFrame == 0.0) {
+                timeToFirstFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+                std::cout << "First frame presented " << timeToFirstFrame << " ms after launch" << std::endl;
+            }
+
+            glCheckError();
         }
-
-        model->Draw(*shader);
-
-        skybox.Draw(v, p);
-
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-
-        glCheckError();
     }
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -5,12 +5,9 @@ in vec3 normal;
 in vec3 worldPosition;
 in vec3 pos;
 
-uniform vec3 cameraPos;
-uniform samplerCube skybox;
-uniform float refractionIndex;
-uniform float reflectance;
+#include "include/Blocks.glsl"
 
-uniform mat4 model;
+uniform samplerCube skybox;
 
 void main() {             
     vec3 wPos = vec3(model * vec4(pos, 1.0));
@@ -5,8 +5,7 @@ out vec4 FragColor;
 in vec3 worldPos;
 in vec3 normal;
 
-uniform vec3 wireColor;
-uniform float bFlat;
+#include "include/Blocks.glsl"
 
 const vec3 lightPos 	= vec3(200,60,100);
 const vec3 ambientColor = vec3(0.2, 0.0, 0.0);
@@ -14,7 +13,7 @@ const vec3 diffuseColor = vec3(0.5, 0.0, 0.0);
 const vec3 specColor 	= vec3(1.0, 1.0, 1.0);
 
 void main() {
-	vec3 norm = mix(normalize(normal), normalize(cross(dFdx(worldPos), dFdy(worldPos))), bFlat);
+	vec3 norm = mix(normalize(normal), normalize(cross(dFdx(worldPos), dFdy(worldPos))), flatness);
 	vec3 lightDir = normalize(lightPos - worldPos);
 	
 	float lambertian = max(dot(lightDir,norm), 0.0);
@@ -1,40 +1,47 @@
 #version 330 core
 
+// permutations: NR_LIGHTS point lights, HAS_ALBEDO_MAP samples albedo from a texture instead of a uniform
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 4
+#endif
+
 out vec4 FragColor;
 
 in vec2 texCoords;
 in vec3 worldPos;
 in vec3 normal;
+in vec4 tint;
 
-// material parameters
-uniform vec3  albedo;
-uniform float metallic;
-uniform float roughness;
-uniform float ao;
+// material parameters, camera and lights are in the blocks
+#include "include/Blocks.glsl"
 
-// lights
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+#if NR_LIGHTS > MAX_LIGHTS
+#error NR_LIGHTS is larger than the Frame block's light arrays
+#endif
 
-uniform vec3 cameraPos;
+#ifdef HAS_ALBEDO_MAP
+uniform sampler2D albedoMap;
+#endif
 
-const float PI = 3.14159265359;
-  
-float DistributionGGX(vec3 N, vec3 H, float roughness);
-float GeometrySchlickGGX(float NdotV, float roughness);
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness);
-vec3 fresnelSchlick(float cosTheta, vec3 F0);
+#include "include/PBR.glsl"
 
 void main() {		
     vec3 N = normalize(normal);
     vec3 V = normalize(cameraPos - worldPos);
 
+#ifdef HAS_ALBEDO_MAP
+    vec3 baseColor = pow(texture(albedoMap, texCoords).rgb, vec3(2.2)) * tint.rgb;
+#else
+    vec3 baseColor = albedo * tint.rgb;
+#endif
+
     vec3 F0 = vec3(0.04); 
-    F0 = mix(F0, albedo, metallic);
+    F0 = mix(F0, baseColor, metallic);
 	           
     // reflectance equation
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i) 
+#if NR_LIGHTS > 0
+    for(int i = 0; i < NR_LIGHTS && i < lightCount; ++i) 
     {
         // calculate per-light radiance
         vec3 L = normalize(lightPositions[i] - worldPos);
@@ -58,51 +65,15 @@ void main() {
             
         // add to outgoing radiance Lo
         float NdotL = max(dot(N, L), 0.0);                
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL; 
+        Lo += (kD * baseColor / PI + specular) * radiance * NdotL; 
     }   
+#endif
   
-    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 ambient = vec3(0.03) * baseColor * ao;
     vec3 color = ambient + Lo;
 	
     color = color / (color + vec3(1.0));
     color = pow(color, vec3(1.0/2.2));  
    
     FragColor = vec4(color, 1.0);
-}  
-
-float DistributionGGX(vec3 N, vec3 H, float roughness) {
-    float a      = roughness*roughness;
-    float a2     = a*a;
-    float NdotH  = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH*NdotH;
-	
-    float num   = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-	
-    return num / denom;
 }
-
-float GeometrySchlickGGX(float NdotV, float roughness) {
-    float r = (roughness + 1.0);
-    float k = (r*r) / 8.0;
-
-    float num   = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-	
-    return num / denom;
-}
-
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx2  = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1  = GeometrySchlickGGX(NdotL, roughness);
-	
-    return ggx1 * ggx2;
-}
-
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}  
-
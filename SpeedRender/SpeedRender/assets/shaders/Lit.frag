@@ -16,49 +16,10 @@ struct Material {
   
 uniform Material material;
 
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-uniform DirectionalLight dirLight;
+#include "include/Lights.glsl"
 
-struct PointLight {    
-    vec3 position;
-    vec3 color;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-#define NR_POINT_LIGHTS 4  
+uniform DirectionalLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
-
-struct SpotLight {    
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-
-    float cutoff;
-    float innerCutoff;
-    float outerCutoff;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-#define NR_SPOT_LIGHTS 1
 uniform SpotLight spotLights[NR_SPOT_LIGHTS];
 
 vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir);  
@@ -94,7 +55,7 @@ vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir) {
     // combine results
     vec3 ambient  = light.ambient  * vec3(texture(material.diffuse1, texCoords));
     vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse1, texCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular1, texCoords));
+    vec3 specular = light.specular * spec * vec3(texture(material.specular1, texCoords).r);
     return (ambient + diffuse + specular) * light.color;
 }  
 
@@ -111,7 +72,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     // combine results
     vec3 ambient  = light.ambient  * vec3(texture(material.diffuse1, texCoords));
     vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse1, texCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular1, texCoords));
+    vec3 specular = light.specular * spec * vec3(texture(material.specular1, texCoords).r);
     ambient  *= attenuation;
     diffuse  *= attenuation;
     specular *= attenuation;
@@ -137,7 +98,7 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
         diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse1, texCoords));
-        specular = light.specular * spec * vec3(texture(material.specular1, texCoords));
+        specular = light.specular * spec * vec3(texture(material.specular1, texCoords).r);
     }
 
     ambient  = light.ambient  * vec3(texture(material.diffuse1, texCoords));
@@ -4,19 +4,54 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
+// INSTANCED takes the transform and a color from the instance buffer (see InstanceBuffer.h) instead of the
+// Object block
+#ifdef INSTANCED
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in vec4 aInstanceColor;
+layout (location = 8) in mat3 aInstanceNormalMatrix;
+#endif
+
 out vec3 normal;
 out vec3 worldPos;
 out vec2 texCoords;
 out vec3 pos;
+out vec4 tint;
+
+#include "include/Blocks.glsl"
+
+// packed meshes (see VertexFormat.h) store normalized positions and UVs in the mesh's bounds and
+// octahedral normals, float meshes leave these at the identity
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+uniform vec2 uvOffset = vec2(0.0);
+uniform vec2 uvScale = vec2(1.0);
+uniform bool octNormals = false;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+vec3 OctDecode(vec2 e) {
+   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+   float t = max(-n.z, 0.0);
+   n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+   return normalize(n);
+}
 
 void main() {
-   gl_Position = projection * view * model * vec4(aPos, 1.0);
-   normal = mat3(transpose(inverse(model))) * aNormal;
-   worldPos = vec3(model * vec4(aPos, 1.0));
-   texCoords = aTexCoords;
-   pos = aPos;
+   vec3 position = aPos * positionScale + positionOffset;
+   vec3 objectNormal = octNormals ? OctDecode(aNormal.xy) : aNormal;
+
+#ifdef INSTANCED
+   mat4 objectModel = aInstanceModel;
+   mat3 objectNormalMatrix = aInstanceNormalMatrix;
+   tint = aInstanceColor;
+#else
+   mat4 objectModel = model;
+   mat3 objectNormalMatrix = mat3(normalMatrix);
+   tint = vec4(1.0);
+#endif
+
+   gl_Position = viewProjection * objectModel * vec4(position, 1.0);
+   normal = objectNormalMatrix * objectNormal;
+   worldPos = vec3(objectModel * vec4(position, 1.0));
+   texCoords = aTexCoords * uvScale + uvOffset;
+   pos = position;
 }
@@ -0,0 +1,10 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// flat color for the bounding box drawn while a model is still loading
+#include "include/Blocks.glsl"
+
+void main() {
+    FragColor = vec4(color, 1.0);
+}
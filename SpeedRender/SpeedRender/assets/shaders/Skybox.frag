@@ -4,7 +4,11 @@ out vec4 FragColor;
 in vec3 texCoords;
 
 uniform samplerCube skybox;
+uniform bool hdr;
 
 void main() {    
     FragColor = texture(skybox, texCoords);
+
+    // panoramas are linear HDR, tone mapped and gamma corrected like LOGL_PBR
+    if (hdr) FragColor.rgb = pow(FragColor.rgb / (FragColor.rgb + vec3(1.0)), vec3(1.0 / 2.2));
 }
\ No newline at end of file
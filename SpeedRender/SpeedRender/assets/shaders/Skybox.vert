@@ -3,11 +3,11 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 texCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "include/Blocks.glsl"
 
 void main() {
     texCoords = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    // rotation only, the sky stays put as the camera moves
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }  
\ No newline at end of file
@@ -3,10 +3,12 @@
 out vec4 FragColor;
 
 in vec2 texCoords;
+in vec4 tint;
+
+#include "include/Blocks.glsl"
 
 uniform sampler2D diffuse1;
-uniform vec3 mainColor;
 
 void main() {
-    FragColor = texture(diffuse1, texCoords) * vec4(mainColor, 1.0);
+    FragColor = texture(diffuse1, texCoords) * vec4(color, 1.0) * tint;
 }
@@ -0,0 +1,29 @@
+// Uniform blocks shared by every program, laid out like the structs in UniformBlocks.h
+
+#define MAX_LIGHTS 8
+
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPos;
+    int lightCount;
+    vec3 lightPositions[MAX_LIGHTS];
+    vec3 lightColors[MAX_LIGHTS];
+};
+
+layout (std140) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+layout (std140) uniform Material {
+    vec3 albedo;
+    float metallic;
+    vec3 color;
+    float roughness;
+    float ao;
+    float refractionIndex;
+    float reflectance;
+    float flatness;
+};
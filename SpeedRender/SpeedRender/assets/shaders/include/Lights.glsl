@@ -0,0 +1,49 @@
+// Light structs shared by the Blinn-Phong shaders, counts can be overridden per permutation
+
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+
+#ifndef NR_SPOT_LIGHTS
+#define NR_SPOT_LIGHTS 1
+#endif
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 color;
+  
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};  
+
+struct PointLight {    
+    vec3 position;
+    vec3 color;
+    
+    float constant;
+    float linear;
+    float quadratic;  
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};  
+
+struct SpotLight {    
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+
+    float cutoff;
+    float innerCutoff;
+    float outerCutoff;
+    
+    float constant;
+    float linear;
+    float quadratic;  
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
@@ -0,0 +1,370 @@
+#include "AssetCooker.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "AssetPack.h"
+#include "CookedAssets.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "ShaderPreprocessor.h"
+#include "TextureCache.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // +X, -X, +Y, -Y, +Z, -Z, the order Cubemap takes its faces in
+    const char *const CUBE_FACES[6] = { "right", "left", "top", "bottom", "front", "back" };
+
+    // cubemap faces are RGB, BC1 is the matching block format
+    const TextureCompressor::Format CUBEMAP_FORMAT = TextureCompressor::Format::BC1;
+
+    struct Job {
+        CookedAssets::Entry entry;
+        const CookedAssets::Entry *previous = nullptr;
+        std::string type;   // of a texture, picks its format
+
+        bool upToDate = false;
+        bool failed = false;
+        std::string log;
+    };
+
+    std::string Lower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return text;
+    }
+
+    bool IsImage(const fs::path &path) {
+        std::string extension = Lower(path.extension().string());
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+    }
+
+    // container2_specular.png is a "specular" texture, the same convention the scene code names them by
+    std::string TextureType(const fs::path &path) {
+        std::string stem = Lower(path.stem().string());
+        for (const char *type : { "specular", "normal" }) {
+            std::string suffix = std::string("_") + type;
+            if (stem.size() > suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0) return type;
+        }
+        return "diffuse";
+    }
+
+    // the six faces if directory holds a cubemap, in CUBE_FACES order
+    bool FindCubeFaces(const fs::path &directory, std::vector<std::string> &faces) {
+        faces.assign(6, "");
+        std::error_code ec;
+        for (const fs::directory_entry &file : fs::directory_iterator(directory, ec)) {
+            if (!file.is_regular_file() || !IsImage(file.path())) continue;
+            std::string stem = Lower(file.path().stem().string());
+            for (int face = 0; face < 6; face++)
+                if (stem == CUBE_FACES[face]) faces[face] = CookedAssets::Normalize(file.path().string());
+        }
+        return std::none_of(faces.begin(), faces.end(), [](const std::string &face) { return face.empty(); });
+    }
+
+    // packed meshes are mapped and uploaded in place, loose ones are read whole and are better off small
+    std::string MeshExtension(const AssetCooker::Options &options) {
+        return options.pack ? ".srmesh" : ".srmz";
+    }
+
+    bool CreateParent(const std::string &path) {
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        return !ec;
+    }
+
+    // Stamps every input and fills in its content hash, reused from previous while the stamp is unchanged.
+    // Returns false if an input is missing.
+    bool HashInputs(std::vector<CookedAssets::Input> &inputs, const CookedAssets::Entry *previous) {
+        for (CookedAssets::Input &input : inputs) {
+            if (!CookedAssets::GetStamp(input.path, input.size, input.time)) return false;
+
+            const CookedAssets::Input *old = nullptr;
+            if (previous) {
+                for (const CookedAssets::Input &candidate : previous->inputs)
+                    if (candidate.path == input.path) old = &candidate;
+            }
+            if (old && old->size == input.size && old->time == input.time) input.hash = old->hash;
+            else if (!CookedAssets::HashFile(input.path, input.hash)) return false;
+        }
+        return true;
+    }
+
+    // true if nothing job.previous was built from has changed and its outputs are all still there
+    bool IsUpToDate(Job &job, const AssetCooker::Options &options) {
+        const CookedAssets::Entry *previous = job.previous;
+        if (!previous || previous->kind != job.entry.kind || previous->outputs.empty()) return false;
+        if (job.entry.kind == "mesh" && fs::path(previous->outputs[0]).extension() != MeshExtension(options)) return false;
+
+        // shaders find their includes while cooking, so their last set of inputs is the one to check
+        std::vector<CookedAssets::Input> inputs = job.entry.kind == "shader" ? previous->inputs : job.entry.inputs;
+        if (inputs.size() != previous->inputs.size()) return false;
+        if (!HashInputs(inputs, previous)) return false;
+        for (size_t i = 0; i < inputs.size(); i++)
+            if (inputs[i].path != previous->inputs[i].path || inputs[i].hash != previous->inputs[i].hash) return false;
+
+        for (const std::string &output : previous->outputs)
+            if (!fs::exists(output)) return false;
+
+        job.entry.inputs = inputs;
+        job.entry.outputs = previous->outputs;
+        return true;
+    }
+
+    bool CookMesh(Job &job, const AssetCooker::Options &options) {
+        const std::string &source = job.entry.source;
+        ObjLoader::Result obj;
+        if (!ObjLoader::Load(source, obj)) return false;
+
+        std::vector<MeshLod> lods;
+        std::vector<Meshlet> meshlets;
+        std::ostringstream report;
+        MeshOptimizer::Process(source, obj.vertices, obj.indices, lods, meshlets, report);
+        AABB bounds = Mesh::ComputeBounds(obj.vertices.data(), obj.vertices.size());
+
+        std::string output = CookedAssets::OutputPath(source, MeshExtension(options), options.root, options.outputRoot);
+        if (!CreateParent(output)) return false;
+        if (options.pack) {
+            if (!MeshCache::Write(output, source, obj.vertices, obj.indices, lods, meshlets, bounds, obj.hasNormals, obj.hasUVs)) return false;
+        } else if (!MeshCodec::Write(output, source, obj.vertices.data(), obj.vertices.size(), obj.indices.data(), obj.indices.size(),
+                                     lods, meshlets, bounds, obj.hasNormals, obj.hasUVs)) {
+            return false;
+        }
+
+        job.entry.outputs = { output };
+        job.log = report.str();
+        return true;
+    }
+
+    bool CookTexture(Job &job, const AssetCooker::Options &options) {
+        const std::string &source = job.entry.source;
+        stbi_set_flip_vertically_on_load_thread(options.flipImages);
+
+        int width, height, channels;
+        unsigned char *data = stbi_load(source.c_str(), &width, &height, &channels, 4);
+        if (!data) return false;
+
+        TextureCompressor::Format format = TextureCompressor::FormatForType(job.type);
+        bool srgb = TextureCompressor::IsSRGBType(job.type);
+        std::vector<std::vector<unsigned char>> levels;
+        TextureCompressor::CompressMipChain(format, data, width, height, true, srgb, levels);
+        stbi_image_free(data);
+
+        uint32_t flags = (options.flipImages ? TextureCache::FLAG_FLIPPED : 0) | (srgb ? TextureCache::FLAG_SRGB_MIPS : 0);
+        std::string output = CookedAssets::OutputPath(source, TextureCache::Extension(format), options.root, options.outputRoot);
+        if (!CreateParent(output) || !TextureCache::Write(output, source, format, flags, width, height, 1, levels)) return false;
+
+        job.entry.outputs = { output };
+        return true;
+    }
+
+    bool CookCubemap(Job &job, const AssetCooker::Options &options) {
+        stbi_set_flip_vertically_on_load_thread(false);
+
+        int width = 0, height = 0;
+        std::vector<std::vector<unsigned char>> faces;
+        for (const CookedAssets::Input &input : job.entry.inputs) {
+            int faceWidth, faceHeight, channels;
+            unsigned char *data = stbi_load(input.path.c_str(), &faceWidth, &faceHeight, &channels, 4);
+            if (!data) return false;
+            if (!faces.empty() && (faceWidth != width || faceHeight != height)) {
+                std::cout << "Texture face size mismatch at " << input.path << std::endl;
+                stbi_image_free(data);
+                return false;
+            }
+
+            width = faceWidth;
+            height = faceHeight;
+            TextureCompressor::CompressMipChain(CUBEMAP_FORMAT, data, width, height, true, true, faces);
+            stbi_image_free(data);
+        }
+
+        std::string output = CookedAssets::OutputPath(job.entry.source, ".cube" + TextureCache::Extension(CUBEMAP_FORMAT),
+                                                      options.root, options.outputRoot);
+        if (!CreateParent(output) || !TextureCache::Write(output, job.entry.source, CUBEMAP_FORMAT, TextureCache::FLAG_SRGB_MIPS, width, height, 6, faces)) return false;
+
+        job.entry.outputs = { output };
+        return true;
+    }
+
+    bool CookShader(Job &job, const AssetCooker::Options &options) {
+        const std::string &source = job.entry.source;
+
+        // no defines, the runtime adds each permutation's after #version like it does for the sources
+        std::string code;
+        std::vector<std::string> files;
+        if (!ShaderPreprocessor::Process(source, {}, code, files)) return false;
+
+        std::string output = CookedAssets::OutputPath(source, fs::path(source).extension().string() + ".glsl", options.root, options.outputRoot);
+        if (!CreateParent(output)) return false;
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        if (!file.write(code.data(), code.size())) return false;
+
+        // source string n of the expanded code is files[n], keep them in that order
+        job.entry.inputs.clear();
+        for (const std::string &path : files) job.entry.inputs.push_back({ path });
+        job.entry.outputs = { output };
+        return true;
+    }
+
+    void RunJob(Job &job, const AssetCooker::Options &options) {
+        if (!options.force && IsUpToDate(job, options)) {
+            job.upToDate = true;
+            return;
+        }
+
+        Clock::time_point start = Clock::now();
+        bool ok = false;
+        if (job.entry.kind == "mesh") ok = CookMesh(job, options);
+        else if (job.entry.kind == "texture") ok = CookTexture(job, options);
+        else if (job.entry.kind == "cubemap") ok = CookCubemap(job, options);
+        else if (job.entry.kind == "shader") ok = CookShader(job, options);
+
+        // hashed after cooking, an edit made meanwhile is picked up by the next run
+        job.failed = !ok || !HashInputs(job.entry.inputs, nullptr);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::ostringstream line;
+        line << (job.failed ? "Failed to cook " : "Cooked ") << job.entry.kind << " " << job.entry.source;
+        if (!job.failed) line << " in " << ms << " ms";
+        job.log += line.str() + "\n";
+    }
+}
+
+AssetCooker::Stats AssetCooker::Cook(const Options &options) {
+    Clock::time_point start = Clock::now();
+    Stats stats;
+
+    std::string manifestPath = CookedAssets::ManifestPath(options.outputRoot);
+    std::vector<CookedAssets::Entry> previousEntries;
+    CookedAssets::ReadManifest(manifestPath, previousEntries);
+    std::unordered_map<std::string, const CookedAssets::Entry*> previous;
+    for (const CookedAssets::Entry &entry : previousEntries) previous[entry.source] = &entry;
+
+    // collect the jobs, cubemap directories first so their faces aren't cooked as 2D textures too
+    std::vector<std::unique_ptr<Job>> jobs;
+    auto addJob = [&](const std::string &kind, const std::string &source, const std::vector<std::string> &inputs) {
+        std::unique_ptr<Job> job(new Job());
+        job->entry.kind = kind;
+        job->entry.source = source;
+        for (const std::string &input : inputs) job->entry.inputs.push_back({ input });
+        auto it = previous.find(source);
+        if (it != previous.end()) job->previous = it->second;
+        jobs.push_back(std::move(job));
+        return jobs.back().get();
+    };
+
+    std::string outputRoot = CookedAssets::Normalize(options.outputRoot);
+    std::vector<std::string> sources, cubeFaces;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(options.root, ec), end; it != end; it.increment(ec)) {
+        if (ec) break;
+        std::string path = CookedAssets::Normalize(it->path().string());
+        if (it->is_directory() && path == outputRoot) {
+            it.disable_recursion_pending();
+            continue;
+        }
+
+        std::vector<std::string> faces;
+        if (it->is_directory() && FindCubeFaces(it->path(), faces)) {
+            addJob("cubemap", faces[0], faces);
+            cubeFaces.insert(cubeFaces.end(), faces.begin(), faces.end());
+        } else if (it->is_regular_file()) {
+            sources.push_back(path);
+        }
+    }
+
+    for (const std::string &path : sources) {
+        fs::path file(path);
+        std::string extension = Lower(file.extension().string());
+        if (extension == ".obj") {
+            addJob("mesh", path, { path });
+        } else if (extension == ".vert" || extension == ".frag") {
+            addJob("shader", path, { path });
+        } else if (IsImage(file) && std::find(cubeFaces.begin(), cubeFaces.end(), path) == cubeFaces.end()) {
+            addJob("texture", path, { path })->type = TextureType(file);
+        }
+    }
+
+    // one task per asset, the block compressor and mesh optimizer spread further over the pool themselves
+    std::vector<std::future<void>> done;
+    for (std::unique_ptr<Job> &job : jobs) {
+        Job *raw = job.get();
+        done.push_back(ThreadPool::Global().Submit([raw, &options]() { RunJob(*raw, options); }));
+    }
+    for (std::future<void> &future : done) future.wait();
+
+    std::vector<CookedAssets::Entry> entries;
+    for (std::unique_ptr<Job> &job : jobs) {
+        std::cout << job->log;
+        if (job->failed) {
+            stats.failed++;
+            continue;
+        }
+        if (job->upToDate) stats.upToDate++;
+        else stats.cooked++;
+        entries.push_back(job->entry);
+    }
+
+    // outputs nothing refers to any more, of deleted sources, failed ones or ones rebuilt into another kind
+    std::unordered_set<std::string> current;
+    for (const CookedAssets::Entry &entry : entries) current.insert(entry.outputs.begin(), entry.outputs.end());
+    for (const auto &stale : previous) {
+        for (const std::string &output : stale.second->outputs)
+            if (!current.count(output)) fs::remove(output, ec);
+        if (std::any_of(jobs.begin(), jobs.end(), [&](const std::unique_ptr<Job> &job) { return job->entry.source == stale.first; })) continue;
+        std::cout << "Removed " << stale.second->kind << " " << stale.first << std::endl;
+        stats.removed++;
+    }
+
+    if (!CreateParent(manifestPath) || !CookedAssets::WriteManifest(manifestPath, entries))
+        std::cout << "Failed to write cook manifest " << manifestPath << std::endl;
+
+    if (options.pack) {
+        std::vector<std::string> files = { manifestPath };
+        for (const CookedAssets::Entry &entry : entries) files.insert(files.end(), entry.outputs.begin(), entry.outputs.end());
+
+        std::string packPath = CookedAssets::PackPath(options.outputRoot);
+        if (AssetPack::Build(packPath, files)) std::cout << "Packed " << files.size() << " files into " << packPath << std::endl;
+        else std::cout << "Failed to write asset pack " << packPath << std::endl;
+    }
+
+    stats.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return stats;
+}
+
+bool AssetCooker::Run(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "--cook") != 0) return false;
+
+    Options options;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--force") == 0) options.force = true;
+        else if (strcmp(argv[i], "--no-flip") == 0) options.flipImages = false;
+        else if (strcmp(argv[i], "--pack") == 0) options.pack = true;
+        else if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) options.root = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) options.outputRoot = argv[++i];
+        else std::cout << "Unknown cook option " << argv[i] << std::endl;
+    }
+
+    Stats stats = Cook(options);
+    std::cout << "Cooked " << stats.cooked << ", " << stats.upToDate << " up to date, " << stats.failed << " failed, "
+              << stats.removed << " removed in " << stats.ms << " ms" << std::endl;
+    return true;
+}
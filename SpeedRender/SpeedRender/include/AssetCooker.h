@@ -0,0 +1,39 @@
+#ifndef ASSET_COOKER_H
+#define ASSET_COOKER_H
+
+#include <string>
+
+// Offline half of CookedAssets, run with SpeedRender --cook. Walks the asset root and turns every source
+// into the form the runtime would otherwise build on first load:
+//  - .obj                     welded, optimized, with LODs and meshlets, compressed as .srmz, or as
+//                             .srmesh when packing so the arrays can be used in place
+//  - images                   mip chain in the block format of their type, as .srtex
+//  - right/left/top/bottom/front/back images in one directory, a cubemap with all six faces in one .srtex
+//  - .vert/.frag              includes expanded, as .glsl
+// Assets are cooked in parallel on the thread pool. An asset is only rebuilt when the content hash of one of
+// its inputs changed, inputs whose size and time still match the manifest are not even read. With pack set
+// the manifest and every output are also put into one AssetPack for deployment.
+namespace AssetCooker {
+    struct Options {
+        std::string root = "assets";
+        std::string outputRoot = "assets/cooked";
+        bool force = false;         // rebuild everything
+        bool flipImages = true;     // 2D images are flipped like Texture::SetFlipImageOnLoad(true), cubemaps never
+        bool pack = false;          // also write CookedAssets::PackPath(outputRoot)
+    };
+
+    struct Stats {
+        unsigned int cooked = 0;
+        unsigned int upToDate = 0;
+        unsigned int failed = 0;
+        unsigned int removed = 0;   // outputs of sources that no longer exist
+        double ms = 0.0;
+    };
+
+    Stats Cook(const Options &options);
+
+    // --cook [--force] [--no-flip] [--pack] [--root <dir>] [--output <dir>], true if argv asked for a cook
+    bool Run(int argc, char **argv);
+}
+
+#endif
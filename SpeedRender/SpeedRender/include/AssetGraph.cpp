@@ -0,0 +1,90 @@
+#include "AssetGraph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "ThreadPool.h"
+
+AssetGraph::Handle AssetGraph::Add(const std::string &name, std::function<void()> work, std::function<void()> finish,
+                                   const std::vector<Handle> &dependencies) {
+    Node node;
+    node.name = name;
+    node.work = std::move(work);
+    node.finish = std::move(finish);
+    node.dependencies = dependencies;
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+void AssetGraph::Run() {
+    Clock::time_point start = Clock::now();
+    auto msSince = [](Clock::time_point from) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+    };
+
+    size_t remaining = std::count_if(nodes.begin(), nodes.end(), [](const Node &node) { return !node.finished; });
+    while (remaining > 0) {
+        bool progressed = false;
+
+        for (Node &node : nodes) {
+            if (node.finished) continue;
+
+            if (!node.started) {
+                bool ready = std::all_of(node.dependencies.begin(), node.dependencies.end(),
+                                         [this](Handle dependency) { return nodes[dependency].finished; });
+                if (!ready) continue;
+
+                node.started = true;
+                progressed = true;
+                if (node.work) {
+                    std::function<void()> *work = &node.work;
+                    node.workDone = ThreadPool::Global().Submit([work, msSince]() {
+                        Clock::time_point workStart = Clock::now();
+                        (*work)();
+                        return msSince(workStart);
+                    });
+                } else {
+                    std::promise<double> none;
+                    none.set_value(0.0);
+                    node.workDone = none.get_future();
+                }
+            }
+
+            if (node.workDone.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+            Timing timing;
+            timing.name = node.name;
+            timing.workMs = node.workDone.get();
+            Clock::time_point finishStart = Clock::now();
+            if (node.finish) node.finish();
+            timing.finishMs = msSince(finishStart);
+            timing.doneMs = msSince(start);
+            timings.push_back(timing);
+
+            node.finished = true;
+            progressed = true;
+            remaining--;
+        }
+
+        // nothing to upload yet, help the workers instead of spinning
+        if (!progressed && !ThreadPool::Global().RunPendingTask())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    totalMs += msSince(start);
+}
+
+void AssetGraph::PrintTimings() const {
+    std::cout << "Loaded " << timings.size() << " assets in " << totalMs << " ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Timing &timing : timings) {
+        std::cout << "  " << std::left << std::setw(40) << timing.name << std::right
+                  << " worker " << std::setw(8) << timing.workMs << " ms"
+                  << "  GL " << std::setw(7) << timing.finishMs << " ms"
+                  << "  done at " << std::setw(8) << timing.doneMs << " ms" << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
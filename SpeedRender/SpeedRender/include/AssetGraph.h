@@ -0,0 +1,55 @@
+#ifndef ASSET_GRAPH_H
+#define ASSET_GRAPH_H
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+// Loads a set of assets as a dependency graph. Every node has an optional work stage that runs on the
+// thread pool (file I/O, parsing, decoding) and an optional finish stage that runs on the GL thread
+// (creating buffers, textures and programs). A node starts once all of its dependencies have finished,
+// and Run() executes finish stages as soon as their work is done, so GL creation overlaps the remaining
+// CPU work instead of waiting for it.
+class AssetGraph {
+public:
+    typedef size_t Handle;
+
+    struct Timing {
+        std::string name;
+        double workMs = 0.0;    // on a worker
+        double finishMs = 0.0;  // on the GL thread
+        double doneMs = 0.0;    // since Run() started
+    };
+
+    Handle Add(const std::string &name, std::function<void()> work, std::function<void()> finish,
+               const std::vector<Handle> &dependencies = {});
+
+    // Blocks until every node has finished. Must be called on the GL thread.
+    void Run();
+
+    const std::vector<Timing> &GetTimings() const { return timings; }
+    double GetTotalMs() const { return totalMs; }
+    void PrintTimings() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Node {
+        std::string name;
+        std::function<void()> work;
+        std::function<void()> finish;
+        std::vector<Handle> dependencies;
+
+        bool started = false;
+        bool finished = false;
+        std::future<double> workDone;   // resolves to the work stage's duration in ms
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Timing> timings;
+    double totalMs = 0.0;
+};
+
+#endif
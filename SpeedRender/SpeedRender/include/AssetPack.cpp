@@ -0,0 +1,154 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "CookedAssets.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'P', 'K' };
+
+    uint64_t AlignUp(uint64_t offset) {
+        return (offset + AssetPack::ALIGNMENT - 1) & ~(AssetPack::ALIGNMENT - 1);
+    }
+
+    bool Pad(std::ofstream &out, uint64_t offset) {
+        static const char zeros[AssetPack::ALIGNMENT] = {};
+        uint64_t padding = AlignUp(offset) - offset;
+        return (bool)out.write(zeros, padding);
+    }
+}
+
+AssetPack::AssetPack(const std::string &path) : file(path) {
+    if (!file.IsOpen() || file.Size() < sizeof(Header)) return;
+
+    const Header *candidate = (const Header*)file.Data();
+    if (memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0 || candidate->version != VERSION) {
+        std::cout << "ERROR::ASSET_PACK::VERSION_MISMATCH " << path << std::endl;
+        return;
+    }
+
+    uint64_t entryEnd = candidate->entryOffset + (uint64_t)candidate->entryCount * sizeof(Entry);
+    uint64_t namesEnd = candidate->namesOffset + candidate->namesSize;
+    if (entryEnd > file.Size() || namesEnd > file.Size()) {
+        std::cout << "ERROR::ASSET_PACK::TRUNCATED " << path << std::endl;
+        return;
+    }
+
+    // checked once here, so Find() can hand out views without looking again
+    const Entry *table = (const Entry*)(file.Data() + candidate->entryOffset);
+    for (uint32_t i = 0; i < candidate->entryCount; i++) {
+        if (table[i].offset + table[i].size > file.Size() || (uint64_t)table[i].nameOffset + table[i].nameLength > candidate->namesSize ||
+            (i > 0 && table[i].nameHash < table[i - 1].nameHash)) {
+            std::cout << "ERROR::ASSET_PACK::CORRUPT " << path << std::endl;
+            return;
+        }
+    }
+
+    header = candidate;
+    entries = table;
+    names = (const char*)(file.Data() + candidate->namesOffset);
+}
+
+const AssetPack::Entry *AssetPack::FindEntry(const std::string &name) const {
+    if (!header) return nullptr;
+
+    uint64_t hash = Hash::Fnv1a(name);
+    const Entry *end = entries + header->entryCount;
+    const Entry *it = std::lower_bound(entries, end, hash, [](const Entry &entry, uint64_t value) { return entry.nameHash < value; });
+    for (; it != end && it->nameHash == hash; it++)
+        if (name.compare(0, std::string::npos, names + it->nameOffset, it->nameLength) == 0) return it;
+    return nullptr;
+}
+
+std::unique_ptr<MappedFile> AssetPack::Find(const std::string &path) const {
+    const Entry *entry = FindEntry(CookedAssets::Normalize(path));
+    if (!entry) return nullptr;
+    return std::unique_ptr<MappedFile>(new MappedFile(file.Data() + entry->offset, (size_t)entry->size));
+}
+
+const AssetPack &AssetPack::Global() {
+    static const AssetPack pack(CookedAssets::PackPath());
+    return pack;
+}
+
+std::unique_ptr<MappedFile> AssetPack::Map(const std::string &path) {
+    std::unique_ptr<MappedFile> packed = Global().Find(path);
+    if (packed) return packed;
+    return std::unique_ptr<MappedFile>(new MappedFile(path));
+}
+
+bool AssetPack::Build(const std::string &packPath, const std::vector<std::string> &files) {
+    struct Pending {
+        std::string name;
+        Entry entry;
+    };
+
+    std::vector<Pending> pending;
+    std::string nameBlock;
+    for (const std::string &path : files) {
+        std::string name = CookedAssets::Normalize(path);
+        if (std::any_of(pending.begin(), pending.end(), [&](const Pending &other) { return other.name == name; })) continue;
+
+        std::error_code ec;
+        uint64_t size = fs::file_size(name, ec);
+        if (ec) {
+            std::cout << "Failed to open " << name << std::endl;
+            return false;
+        }
+
+        Entry entry = {};
+        entry.nameHash = Hash::Fnv1a(name);
+        entry.size = size;
+        entry.nameOffset = (uint32_t)nameBlock.size();
+        entry.nameLength = (uint32_t)name.size();
+        nameBlock += name;
+        pending.push_back({ name, entry });
+    }
+    std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) { return a.entry.nameHash < b.entry.nameHash; });
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = (uint32_t)pending.size();
+    header.namesSize = (uint32_t)nameBlock.size();
+    header.entryOffset = sizeof(Header);
+    header.namesOffset = header.entryOffset + pending.size() * sizeof(Entry);
+
+    uint64_t offset = header.namesOffset + nameBlock.size();
+    for (Pending &file : pending) {
+        offset = AlignUp(offset);
+        file.entry.offset = offset;
+        offset += file.entry.size;
+    }
+
+    // a failed pack never replaces a good one
+    return WriteFileAtomically(packPath, [&](std::ofstream &out) {
+        out.write((const char*)&header, sizeof(Header));
+        for (const Pending &file : pending) out.write((const char*)&file.entry, sizeof(Entry));
+        out.write(nameBlock.data(), nameBlock.size());
+
+        uint64_t position = header.namesOffset + nameBlock.size();
+        for (const Pending &file : pending) {
+            if (!Pad(out, position)) return false;
+            position = file.entry.offset;
+
+            if (file.entry.size > 0) {
+                MappedFile source(file.name);
+                if (!source.IsOpen() || source.Size() != file.entry.size) {
+                    std::cout << "Failed to read " << file.name << std::endl;
+                    return false;
+                }
+                out.write((const char*)source.Data(), source.Size());
+            }
+            position += file.entry.size;
+        }
+        return true;
+    });
+}
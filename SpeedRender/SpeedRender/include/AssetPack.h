@@ -0,0 +1,69 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// One .srpak archive holding the cooked files, written by --cook --pack and mapped once. A table of contents
+// sorted by name hash is followed by the files themselves, each 64 byte aligned so the 16 byte aligned
+// arrays inside .srmesh and .srtex stay aligned. Files are handed out as views into the one mapping, so the
+// mesh and texture caches point straight into the pack and their arrays go to glBufferData and
+// glCompressedTexImage2D without being read or copied first.
+class AssetPack {
+public:
+    static const uint32_t VERSION = 1;
+    static const uint64_t ALIGNMENT = 64;
+
+    struct Header {
+        char     magic[4];      // "SRPK"
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t namesSize;
+        uint64_t entryOffset;   // entryCount Entries, sorted by nameHash
+        uint64_t namesOffset;
+    };
+
+    struct Entry {
+        uint64_t nameHash;      // Hash::Fnv1a of the normalized path
+        uint64_t offset;        // from the start of the pack, ALIGNMENT aligned
+        uint64_t size;
+        uint32_t nameOffset;    // into the names block, not null terminated
+        uint32_t nameLength;
+    };
+
+    AssetPack(const std::string &path);
+
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    bool IsOpen() const { return header != nullptr; }
+    size_t Count() const { return header ? header->entryCount : 0; }
+    size_t Size() const { return file.Size(); }
+
+    // The file packed under path as a view into the pack, nullptr if it is not in here
+    std::unique_ptr<MappedFile> Find(const std::string &path) const;
+
+    // The pack next to assets/cooked, mapped on first use and kept for the rest of the run. Safe to call
+    // from any thread.
+    static const AssetPack &Global();
+
+    // path from the global pack if it is in there, otherwise mapped from disk. Check IsOpen().
+    static std::unique_ptr<MappedFile> Map(const std::string &path);
+
+    // Packs files under their normalized paths into packPath
+    static bool Build(const std::string &packPath, const std::vector<std::string> &files);
+
+private:
+    const Entry *FindEntry(const std::string &name) const;
+
+    MappedFile file;
+    const Header *header = nullptr;
+    const Entry *entries = nullptr;
+    const char *names = nullptr;
+};
+
+#endif
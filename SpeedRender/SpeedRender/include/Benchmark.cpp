@@ -0,0 +1,721 @@
+#include "Benchmark.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "cy/cyTriMesh.h"
+
+#include "EquirectConverter.h"
+#include "GLState.h"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MipGenerator.h"
+#include "ObjLoader.h"
+#include "Shader.h"
+#include "StreamingMesh.h"
+#include "TextureCompressor.h"
+#include "UniformBlocks.h"
+#include "VertexFormat.h"
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const int BENCH_RUNS = 3;
+
+    // rolling hills, one terrain cell is one chunk of TERRAIN_CELL_QUADS^2 quads
+    const int TERRAIN_CELL_QUADS = 180;
+    const float TERRAIN_CELL_SIZE = 16.0f;
+
+    float TerrainHeight(float x, float z) {
+        return 6.0f * sinf(x * 0.031f) * cosf(z * 0.027f) + 1.5f * sinf(x * 0.17f + z * 0.11f) + 0.3f * cosf(x * 0.9f - z * 0.7f);
+    }
+
+    // Writes cells x cells terrain chunks one at a time, never holding more than one
+    bool GenerateTerrain(const std::string &path, int cells) {
+        const int side = TERRAIN_CELL_QUADS + 1;
+        const float step = TERRAIN_CELL_SIZE / TERRAIN_CELL_QUADS;
+        AABB bounds = { glm::vec3(0.0f, -8.0f, 0.0f), glm::vec3(cells * TERRAIN_CELL_SIZE, 8.0f, cells * TERRAIN_CELL_SIZE) };
+        StreamingMesh::Writer writer(path, bounds, true, true);
+
+        std::vector<Vertex> vertices(side * side);
+        std::vector<unsigned int> indices;
+        for (int z = 0; z < TERRAIN_CELL_QUADS; z++) {
+            for (int x = 0; x < TERRAIN_CELL_QUADS; x++) {
+                unsigned int i = z * side + x;
+                indices.insert(indices.end(), { i, i + side, i + 1, i + 1, i + side, i + side + 1 });
+            }
+        }
+
+        for (int cellZ = 0; cellZ < cells; cellZ++) {
+            for (int cellX = 0; cellX < cells; cellX++) {
+                for (int z = 0; z < side; z++) {
+                    for (int x = 0; x < side; x++) {
+                        float worldX = cellX * TERRAIN_CELL_SIZE + x * step, worldZ = cellZ * TERRAIN_CELL_SIZE + z * step;
+                        float dx = TerrainHeight(worldX + 0.01f, worldZ) - TerrainHeight(worldX - 0.01f, worldZ);
+                        float dz = TerrainHeight(worldX, worldZ + 0.01f) - TerrainHeight(worldX, worldZ - 0.01f);
+
+                        Vertex &vertex = vertices[z * side + x];
+                        vertex.position = glm::vec3(worldX, TerrainHeight(worldX, worldZ), worldZ);
+                        vertex.normal = glm::normalize(glm::vec3(-dx, 0.02f, -dz));
+                        vertex.texCoords = glm::vec2((float)x / TERRAIN_CELL_QUADS, (float)z / TERRAIN_CELL_QUADS);
+                    }
+                }
+                if (!writer.AddCell(vertices, indices)) return false;
+            }
+        }
+        return writer.Finish();
+    }
+
+    // a hidden window is enough for a context, null if there is none
+    GLFWwindow *CreateHiddenContext() {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        GLFWwindow *window = glfwCreateWindow(800, 600, "Speed Render", NULL, NULL);
+        if (!window) {
+            std::cout << "Failed to create an OpenGL 3.3 context" << std::endl;
+            return nullptr;
+        }
+        glfwMakeContextCurrent(window);
+        gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+        GLState::SetDepthTest(true);
+        return window;
+    }
+}
+
+bool Benchmark::Run(int argc, char **argv) {
+    if (argc < 2) return false;
+
+    if (strcmp(argv[1], "--bench-obj") == 0 && argc >= 3) {
+        ObjLoading(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-bc") == 0 && argc >= 3) {
+        TextureCompression(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-mips") == 0 && argc >= 3) {
+        MipGeneration(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-hdr") == 0 && argc >= 3) {
+        PanoramaConversion(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-vertex") == 0 && argc >= 3) {
+        VertexFormats(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-codec") == 0 && argc >= 3) {
+        MeshCompression(argv[2]);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-stream") == 0) {
+        double gigabytes = argc >= 3 ? atof(argv[2]) : 2.0;
+        size_t vramBudget = (size_t)(argc >= 4 ? atof(argv[3]) : 128.0) * 1024 * 1024;
+        size_t ramBudget = (size_t)(argc >= 5 ? atof(argv[4]) : 32.0) * 1024 * 1024;
+        Streaming(gigabytes, vramBudget, ramBudget);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-state") == 0) {
+        StateChanges(argc >= 3 ? std::max(atoi(argv[2]), 1) : 4096);
+        return true;
+    }
+    if (strcmp(argv[1], "--bench-instances") == 0) {
+        Instancing(argc >= 3 ? std::max(atoi(argv[2]), 1) : 10000);
+        return true;
+    }
+
+    return false;
+}
+
+void Benchmark::ObjLoading(const char *path) {
+    std::error_code ec;
+    double megabytes = std::filesystem::file_size(path, ec) / (1024.0 * 1024.0);
+    if (ec) {
+        std::cout << "Cannot open " << path << std::endl;
+        return;
+    }
+    std::cout << path << ": " << megabytes << " MB, best of " << BENCH_RUNS << " runs" << std::endl;
+
+    // the old path: cy::TriMesh plus the per corner copy Model::LoadModel used to do
+    double best = 1e30;
+    size_t cyCorners = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        Clock::time_point start = Clock::now();
+
+        cy::TriMesh t;
+        t.LoadFromFileObj(path, false, nullptr);
+        std::vector<Vertex> vertices;
+        vertices.reserve(t.NF() * 3);
+        for (unsigned int i = 0; i < t.NF(); i++) {
+            for (int j = 0; j < 3; j++) {
+                cy::Vec3f pos = t.V(t.F(i).v[j]);
+                cy::Vec3f norm = t.HasNormals() ? t.VN(t.FN(i).v[j]) : cy::Vec3f(0.0f);
+                cy::Vec3f uv = t.HasTextureVertices() ? t.VT(t.FT(i).v[j]) : cy::Vec3f(0.0f);
+                vertices.push_back({ glm::vec3(pos.x, pos.y, pos.z), glm::vec3(norm.x, norm.y, norm.z), glm::vec2(uv.x, uv.y) });
+            }
+        }
+
+        best = std::min(best, SecondsSince(start));
+        cyCorners = vertices.size();
+    }
+    double cyThroughput = megabytes / best;
+    std::cout << "  cy::TriMesh  " << best * 1000.0 << " ms, " << cyThroughput << " MB/s" << std::endl;
+
+    best = 1e30;
+    size_t objCorners = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        Clock::time_point start = Clock::now();
+        ObjLoader::Result result;
+        ObjLoader::Load(path, result);
+        best = std::min(best, SecondsSince(start));
+        objCorners = result.vertices.size();
+    }
+    double objThroughput = megabytes / best;
+    std::cout << "  ObjLoader    " << best * 1000.0 << " ms, " << objThroughput << " MB/s ("
+              << objThroughput / cyThroughput << "x)" << std::endl;
+
+    if (cyCorners != objCorners)
+        std::cout << "  corner count mismatch: " << cyCorners << " vs " << objCorners << std::endl;
+}
+
+void Benchmark::TextureCompression(const char *path) {
+    using TextureCompressor::Format;
+
+    int width, height, channels;
+    unsigned char *image = stbi_load(path, &width, &height, &channels, 4);
+    if (!image) {
+        std::cout << "Cannot open " << path << std::endl;
+        return;
+    }
+    double megapixels = (double)width * height / 1e6;
+    std::cout << path << ": " << width << "x" << height << ", " << channels << " channels, best of " << BENCH_RUNS << " runs" << std::endl;
+    std::cout << "  format  bpp   encode ms   MPix/s   PSNR (stored channels)   PSNR (RGB)" << std::endl;
+
+    const Format formats[] = { Format::BC1, Format::BC3, Format::BC4, Format::BC5, Format::BC7 };
+    std::vector<unsigned char> decoded((size_t)width * height * 4);
+    for (Format format : formats) {
+        std::vector<unsigned char> blocks(TextureCompressor::CompressedSize(format, width, height));
+
+        double best = 1e30;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            Clock::time_point start = Clock::now();
+            TextureCompressor::Compress(format, image, width, height, blocks.data());
+            best = std::min(best, SecondsSince(start));
+        }
+        TextureCompressor::Decompress(format, blocks.data(), width, height, decoded.data());
+
+        // error over the channels the format keeps, and over RGB to compare formats for color maps
+        int stored = TextureCompressor::ChannelCount(format);
+        double storedError = 0.0, rgbError = 0.0;
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            for (int c = 0; c < 4; c++) {
+                double d = (double)image[i * 4 + c] - decoded[i * 4 + c];
+                if (c < stored) storedError += d * d;
+                if (c < 3) rgbError += d * d;
+            }
+        }
+        auto psnr = [&](double error, int channelCount) {
+            double mse = error / ((double)width * height * channelCount);
+            return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+        };
+
+        double bitsPerTexel = blocks.size() * 8.0 / ((double)width * height);
+        std::cout << std::fixed << std::setprecision(2)
+                  << "  " << std::left << std::setw(6) << TextureCompressor::FormatName(format) << std::right
+                  << std::setw(5) << bitsPerTexel
+                  << std::setw(12) << best * 1000.0
+                  << std::setw(9) << megapixels / best
+                  << std::setw(25) << psnr(storedError, stored)
+                  << std::setw(13) << psnr(rgbError, 3) << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    stbi_image_free(image);
+}
+
+void Benchmark::MipGeneration(const char *path) {
+    int width, height, channels;
+    if (!stbi_info(path, &width, &height, &channels)) {
+        std::cout << "Cannot open " << path << std::endl;
+        return;
+    }
+    double megapixels = (double)width * height / 1e6;
+    std::cout << path << ": " << width << "x" << height << ", " << channels << " channels, best of " << BENCH_RUNS << " runs" << std::endl;
+    std::cout << "  channels   chain MB   linear ms   sRGB ms   MPix/s (sRGB)   1x1 red (gamma / linear space)" << std::endl;
+
+    // every layout the loader can pick, the file's own channel count is what it uploads
+    for (int layout = 1; layout <= 4; layout++) {
+        unsigned char *image = stbi_load(path, &width, &height, &channels, layout);
+        if (!image) continue;
+
+        double best[2] = { 1e30, 1e30 };
+        std::vector<std::vector<unsigned char>> chains[2];
+        for (int srgb = 0; srgb < 2; srgb++) {
+            for (int run = 0; run < BENCH_RUNS; run++) {
+                chains[srgb].clear();
+                Clock::time_point start = Clock::now();
+                MipGenerator::Generate(image, width, height, layout, srgb != 0, chains[srgb]);
+                best[srgb] = std::min(best[srgb], SecondsSince(start));
+            }
+        }
+
+        size_t bytes = (size_t)width * height * layout;
+        for (const std::vector<unsigned char> &level : chains[0]) bytes += level.size();
+        int gamma = chains[0].empty() ? image[0] : chains[0].back()[0];
+        int linear = chains[1].empty() ? image[0] : chains[1].back()[0];
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << layout << (layout == channels ? "*" : " ")
+                  << std::setw(10) << bytes / (1024.0 * 1024.0)
+                  << std::setw(12) << best[0] * 1000.0
+                  << std::setw(10) << best[1] * 1000.0
+                  << std::setw(16) << megapixels / best[1]
+                  << std::setw(13) << gamma << " / " << linear << std::endl;
+        stbi_image_free(image);
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "  * the file's own layout" << std::endl;
+}
+
+void Benchmark::PanoramaConversion(const char *path) {
+    Clock::time_point start = Clock::now();
+    int width, height, channels;
+    float *panorama = stbi_loadf(path, &width, &height, &channels, 4);
+    if (!panorama) {
+        std::cout << "Cannot open " << path << std::endl;
+        return;
+    }
+    double decode = SecondsSince(start);
+
+    int faceSize = EquirectConverter::FaceSize(width);
+    std::cout << path << ": " << width << "x" << height << " to 6 faces of " << faceSize << "x" << faceSize
+              << ", decoded in " << decode * 1000.0 << " ms, best of " << BENCH_RUNS << " runs" << std::endl;
+
+    for (int mipmaps = 0; mipmaps < 2; mipmaps++) {
+        double best = 1e30;
+        size_t bytes = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            std::vector<std::vector<unsigned char>> faces;
+            start = Clock::now();
+            EquirectConverter::Convert(panorama, width, height, faceSize, mipmaps != 0, faces);
+            best = std::min(best, SecondsSince(start));
+
+            bytes = 0;
+            for (const std::vector<unsigned char> &face : faces) bytes += face.size();
+        }
+        std::cout << (mipmaps ? "  with mips     " : "  level 0 only  ") << best * 1000.0 << " ms, "
+                  << 6.0 * faceSize * faceSize / 1e6 / best << " MPix/s, " << bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+    stbi_image_free(panorama);
+}
+
+void Benchmark::VertexFormats(const char *path) {
+    using VertexFormat::Layout;
+
+    ObjLoader::Result obj;
+    if (!ObjLoader::Load(path, obj)) {
+        std::cout << "Cannot open " << path << std::endl;
+        return;
+    }
+    std::vector<Vertex> &vertices = obj.vertices;
+    MeshOptimizer::WeldVertices(vertices, obj.indices);
+
+    AABB bounds = Mesh::ComputeBounds(vertices.data(), vertices.size());
+    float diagonal = glm::length(bounds.max - bounds.min);
+    std::cout << path << ": " << vertices.size() << " vertices, bounds diagonal " << diagonal << std::endl;
+    std::cout << "  layout           bytes/vertex      KB   pack ms   max position error        max normal error   max uv error" << std::endl;
+
+    const Layout layouts[] = { Layout::Float, Layout::Packed, Layout::PackedUnormUV };
+    std::vector<VertexFormat::PackedVertex> packed(vertices.size());
+    for (Layout layout : layouts) {
+        double best = 0.0;
+        if (layout != Layout::Float) {
+            best = 1e30;
+            for (int run = 0; run < BENCH_RUNS; run++) {
+                Clock::time_point start = Clock::now();
+                VertexFormat::Dequantization dequantization = VertexFormat::ComputeDequantization(layout, vertices.data(), vertices.size(), bounds);
+                VertexFormat::Pack(vertices.data(), vertices.size(), dequantization, layout, packed.data());
+                best = std::min(best, SecondsSince(start));
+            }
+        }
+        VertexFormat::Error error = VertexFormat::Measure(vertices.data(), vertices.size(), bounds, layout);
+
+        size_t stride = VertexFormat::Stride(layout);
+        double relative = diagonal > 0.0f ? error.position / diagonal * 100.0 : 0.0;
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::left << std::setw(16) << VertexFormat::LayoutName(layout) << std::right
+                  << std::setw(13) << stride
+                  << std::setw(8) << (stride * vertices.size()) / 1024.0
+                  << std::setw(10) << best * 1000.0
+                  << std::scientific << std::setprecision(2)
+                  << std::setw(12) << error.position << " (" << relative << "%)"
+                  << std::fixed << std::setprecision(4)
+                  << std::setw(15) << error.normalDegrees << " deg"
+                  << std::scientific << std::setprecision(2)
+                  << std::setw(15) << error.uv << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+bool Benchmark::MeshCompression(const char *path) {
+    using VertexFormat::Layout;
+    using VertexFormat::PackedVertex;
+
+    ObjLoader::Result obj;
+    if (!ObjLoader::Load(path, obj)) {
+        std::cout << "Cannot open " << path << std::endl;
+        return false;
+    }
+
+    // the same processing Model::LoadMeshData does, the codec relies on the fetch order it leaves behind
+    std::vector<Vertex> &vertices = obj.vertices;
+    std::vector<unsigned int> &indices = obj.indices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    std::ostringstream log;
+    MeshOptimizer::Process(path, vertices, indices, lods, meshlets, log);
+    AABB bounds = Mesh::ComputeBounds(vertices.data(), vertices.size());
+
+    size_t rawVertexBytes = vertices.size() * sizeof(Vertex);
+    size_t indexBytes = indices.size() * sizeof(unsigned int);
+    std::cout << path << ": " << vertices.size() << " vertices, " << indices.size() << " indices over " << lods.size() << " LODs, raw "
+              << (rawVertexBytes + indexBytes) / 1024 << " KB" << std::endl;
+    std::cout << "  stream                      raw KB  coded KB  vs float  decode ms   GB/s  round trip" << std::endl;
+
+    auto report = [](const char *name, size_t rawBytes, size_t codedBytes, size_t floatBytes, size_t decodedBytes, double seconds, bool ok) {
+        std::cout << std::fixed << std::setprecision(2)
+                  << "  " << std::left << std::setw(26) << name << std::right
+                  << std::setw(8) << rawBytes / 1024.0
+                  << std::setw(10) << codedBytes / 1024.0
+                  << std::setw(9) << (double)floatBytes / codedBytes << "x"
+                  << std::setprecision(3) << std::setw(11) << seconds * 1000.0
+                  << std::setprecision(2) << std::setw(7) << decodedBytes / seconds / 1e9
+                  << (ok ? "  ok" : "  FAILED") << std::endl;
+    };
+
+    bool ok = true;
+
+    std::vector<unsigned char> indexStream;
+    MeshCodec::EncodeIndices(indices.data(), indices.size(), indexStream);
+    std::vector<unsigned int> decodedIndices(indices.size());
+    double best = 1e30;
+    bool indicesOk = true;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        Clock::time_point start = Clock::now();
+        indicesOk = MeshCodec::DecodeIndices(indexStream.data(), indexStream.size(), decodedIndices.data(), decodedIndices.size()) && indicesOk;
+        best = std::min(best, SecondsSince(start));
+    }
+    indicesOk = indicesOk && decodedIndices == indices;
+    // cutting the stream short has to be caught, not read past
+    indicesOk = indicesOk && !MeshCodec::DecodeIndices(indexStream.data(), indexStream.size() - 1, decodedIndices.data(), decodedIndices.size());
+    report("indices", indexBytes, indexStream.size(), indexBytes, indexBytes, best, indicesOk);
+    ok = ok && indicesOk;
+
+    const Layout layouts[] = { Layout::Packed, Layout::PackedUnormUV };
+    std::vector<PackedVertex> packed(vertices.size()), decoded(vertices.size());
+    for (Layout layout : layouts) {
+        VertexFormat::Dequantization dequantization = VertexFormat::ComputeDequantization(layout, vertices.data(), vertices.size(), bounds);
+        VertexFormat::Pack(vertices.data(), vertices.size(), dequantization, layout, packed.data());
+
+        std::vector<unsigned char> vertexStream;
+        MeshCodec::EncodeVertices(packed.data(), packed.size(), vertexStream);
+
+        size_t packedBytes = packed.size() * sizeof(PackedVertex);
+        best = 1e30;
+        bool verticesOk = true;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            Clock::time_point start = Clock::now();
+            verticesOk = MeshCodec::DecodeVertices(vertexStream.data(), vertexStream.size(), decoded.data(), decoded.size()) && verticesOk;
+            best = std::min(best, SecondsSince(start));
+        }
+        verticesOk = verticesOk && memcmp(decoded.data(), packed.data(), packedBytes) == 0;
+        verticesOk = verticesOk && (packed.empty() || !MeshCodec::DecodeVertices(vertexStream.data(), vertexStream.size() - 1, decoded.data(), decoded.size()));
+
+        std::string name = std::string("vertices ") + VertexFormat::LayoutName(layout);
+        report(name.c_str(), packedBytes, vertexStream.size(), rawVertexBytes, packedBytes, best, verticesOk);
+        ok = ok && verticesOk;
+    }
+
+    // and the whole file through Write and Read
+    std::string filePath = (std::filesystem::temp_directory_path() / "speedrender-bench.srmz").string();
+    MeshCodec::Decoded file;
+    bool fileOk = MeshCodec::Write(filePath, path, vertices.data(), vertices.size(), indices.data(), indices.size(), lods, meshlets, bounds,
+                                   obj.hasNormals, obj.hasUVs) &&
+                  MeshCodec::Read(filePath, path, file);
+    VertexFormat::Dequantization dequantization = VertexFormat::ComputeDequantization(Layout::Packed, vertices.data(), vertices.size(), bounds);
+    VertexFormat::Pack(vertices.data(), vertices.size(), dequantization, Layout::Packed, packed.data());
+    fileOk = fileOk && file.indices == indices && file.lods.size() == lods.size() && file.meshlets.size() == meshlets.size() &&
+             file.vertices.size() == packed.size() && memcmp(file.vertices.data(), packed.data(), packed.size() * sizeof(PackedVertex)) == 0;
+
+    std::error_code ec;
+    uintmax_t fileBytes = std::filesystem::file_size(filePath, ec);
+    std::cout << "  .srmz file " << fileBytes / 1024 << " KB, " << std::setprecision(2)
+              << (double)(rawVertexBytes + indexBytes) / std::max<uintmax_t>(fileBytes, 1) << "x smaller than the raw arrays"
+              << (fileOk ? ", round trip ok" : ", round trip FAILED") << std::endl;
+    std::filesystem::remove(filePath, ec);
+    ok = ok && fileOk;
+
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    return ok;
+}
+
+bool Benchmark::Streaming(double gigabytes, size_t vramBudget, size_t ramBudget) {
+    // generated first, the pool and the reads must not depend on anything but the file
+    const size_t cellBytes = (size_t)(TERRAIN_CELL_QUADS + 1) * (TERRAIN_CELL_QUADS + 1) * sizeof(Vertex) +
+                             (size_t)TERRAIN_CELL_QUADS * TERRAIN_CELL_QUADS * 6 * sizeof(uint16_t);
+    int cells = std::max(1, (int)std::ceil(std::sqrt(gigabytes * 1024.0 * 1024.0 * 1024.0 / cellBytes)));
+    std::string path = (std::filesystem::temp_directory_path() / "speedrender-bench.srstream").string();
+
+    Clock::time_point start = Clock::now();
+    if (!GenerateTerrain(path, cells)) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    std::error_code ec;
+    double fileGigabytes = std::filesystem::file_size(path, ec) / (1024.0 * 1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(2) << "Generated " << cells * cells << " chunks, " << fileGigabytes << " GB in "
+              << SecondsSince(start) << " s, budgets " << vramBudget / (1024.0 * 1024.0) << " MB VRAM, "
+              << ramBudget / (1024.0 * 1024.0) << " MB RAM" << std::endl;
+
+    bool ok = false;
+    GLFWwindow *window = CreateHiddenContext();
+    if (window) {
+        Shader shader("assets/shaders/MainVertex.vert", "assets/shaders/Flat.frag");
+        UniformBuffer<UniformBlocks::Frame> frameBlock;
+        UniformBuffer<UniformBlocks::Object> objectBlock;
+        UniformBuffer<UniformBlocks::Material> materialBlock;
+        objectBlock.Push(UniformBlocks::Object::FromModel(glm::mat4(1.0f)));
+        UniformBlocks::Material material = {};
+        material.flatness = 1.0f;
+        materialBlock.Push(material);
+        StreamingMesh mesh(path, vramBudget);
+        mesh.ramBudget = ramBudget;
+
+        // diagonally across the whole terrain, low over the hills and looking ahead
+        const int FRAMES = 1200;
+        float extent = cells * TERRAIN_CELL_SIZE;
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 800.0f / 600.0f, 0.1f, 300.0f);
+        double totalMs = 0.0, worstMs = 0.0;
+        size_t triangles = 0;
+        for (int frame = 0; frame < FRAMES && mesh.IsOpen(); frame++) {
+            float t = (float)frame / (FRAMES - 1);
+            glm::vec3 eye(t * extent, 0.0f, t * extent);
+            eye.y = TerrainHeight(eye.x, eye.z) + 12.0f;
+            glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(1.0f, -0.35f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            Clock::time_point frameStart = Clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mesh.Update(projection * view, eye);
+            UniformBlocks::Frame block = {};
+            block.view = view;
+            block.projection = projection;
+            block.viewProjection = projection * view;
+            block.cameraPos = eye;
+            frameBlock.Push(block);
+            shader.Use();
+            triangles += mesh.Draw(shader, projection * view);
+            glFinish();
+
+            double ms = SecondsSince(frameStart) * 1000.0;
+            totalMs += ms;
+            worstMs = std::max(worstMs, ms);
+        }
+
+        const StreamingMesh::Stats &stats = mesh.GetStats();
+        bool withinVram = stats.vramBytes <= vramBudget;
+        bool withinRam = stats.peakRamBytes <= std::max(ramBudget, cellBytes);
+        ok = mesh.IsOpen() && withinVram && withinRam && triangles > 0;
+        std::cout << "  " << FRAMES << " frames, " << totalMs / FRAMES << " ms average, " << worstMs << " ms worst, "
+                  << triangles / FRAMES << " triangles per frame" << std::endl;
+        std::cout << "  " << mesh.GetSlotCount() << " slots of " << mesh.GetChunkCount() << " chunks, " << stats.loads << " loads, "
+                  << stats.evictions << " evictions" << std::endl;
+        std::cout << "  VRAM " << stats.vramBytes / (1024.0 * 1024.0) << " MB" << (withinVram ? "" : " OVER BUDGET")
+                  << ", peak RAM in flight " << stats.peakRamBytes / (1024.0 * 1024.0) << " MB" << (withinRam ? "" : " OVER BUDGET")
+                  << ", file " << fileGigabytes * 1024.0 << " MB" << std::endl;
+        std::cout << (ok ? "  ok" : "  FAILED") << std::endl;
+    }
+    if (window) glfwDestroyWindow(window);
+    glfwTerminate();
+    std::filesystem::remove(path, ec);
+
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    return ok;
+}
+
+void Benchmark::StateChanges(int draws) {
+    GLFWwindow *window = CreateHiddenContext();
+    if (window) {
+        // sorted by program like a real scene, the meshes alternate within each run
+        const char *fragments[] = { "assets/shaders/Unlit.frag", "assets/shaders/LOGL_PBR.frag",
+                                    "assets/shaders/TestNormals.frag", "assets/shaders/Placeholder.frag" };
+        std::vector<std::unique_ptr<Shader>> shaders;
+        for (const char *fragment : fragments) shaders.emplace_back(new Shader("assets/shaders/MainVertex.vert", fragment));
+
+        // tiny quads, so the frame time is the CPU side of the draws and not fill rate
+        const int MESHES = 16;
+        std::vector<std::unique_ptr<Mesh>> meshes;
+        const unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < MESHES; i++) {
+            float size = 0.002f * (i + 1);
+            Vertex quad[4] = {
+                { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f) },
+                { glm::vec3(size, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f) },
+                { glm::vec3(size, size, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f) },
+                { glm::vec3(0.0f, size, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f) }
+            };
+            meshes.emplace_back(new Mesh(quad, 4, indices, 6, Mesh::ComputeBounds(quad, 4), true, true));
+        }
+
+        UniformBuffer<UniformBlocks::Frame> frameBlock;
+        UniformBuffer<UniformBlocks::Object> objectBlock(draws);
+        UniformBuffer<UniformBlocks::Material> materialBlock;
+        UniformBlocks::Frame frame = {};
+        frame.view = frame.projection = frame.viewProjection = glm::mat4(1.0f);
+        frameBlock.Push(frame);
+        UniformBlocks::Material material = {};
+        material.color = material.albedo = glm::vec3(1.0f);
+        materialBlock.Push(material);
+
+        const int FRAMES = 200;
+        int side = (int)std::ceil(std::sqrt((double)draws));
+        double totalMs = 0.0;
+        unsigned long long issued = 0, skipped = 0, uniformsIssued = 0, uniformsSkipped = 0;
+        for (int f = 0; f < FRAMES; f++) {
+            GLState::ResetStats();
+            Shader::ResetUniformStats();
+
+            Clock::time_point frameStart = Clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int i = 0; i < draws; i++) {
+                glm::vec3 position(-1.0f + 2.0f * (i % side) / side, -1.0f + 2.0f * (i / side) / side, 0.0f);
+                objectBlock.Push(UniformBlocks::Object::FromModel(glm::translate(glm::mat4(1.0f), position)));
+                meshes[i % MESHES]->Draw(*shaders[(size_t)i * shaders.size() / draws]);
+            }
+            glFinish();
+            totalMs += SecondsSince(frameStart) * 1000.0;
+
+            issued += GLState::GetStats().issued;
+            skipped += GLState::GetStats().skipped;
+            uniformsIssued += Shader::GetUniformStats().issued;
+            uniformsSkipped += Shader::GetUniformStats().skipped;
+        }
+
+        std::cout << std::fixed << std::setprecision(2) << draws << " draws over " << shaders.size() << " programs and " << MESHES
+                  << " meshes, " << totalMs / FRAMES << " ms per frame" << std::endl;
+        std::cout << "  state changes per frame: " << issued / FRAMES << " issued, " << skipped / FRAMES << " dropped" << std::endl;
+        std::cout << "  uniforms per frame: " << uniformsIssued / FRAMES << " issued, " << uniformsSkipped / FRAMES << " dropped" << std::endl;
+    }
+    if (window) glfwDestroyWindow(window);
+    glfwTerminate();
+
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+void Benchmark::Instancing(int count) {
+    GLFWwindow *window = CreateHiddenContext();
+    if (window) {
+        Shader shader("assets/shaders/MainVertex.vert", "assets/shaders/Unlit.frag");
+        Shader instancedShader("assets/shaders/MainVertex.vert", "assets/shaders/Unlit.frag", { "INSTANCED" });
+
+        // a tiny quad, so the frame time is the CPU side of the draws and not fill rate
+        const unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+        const float size = 0.002f;
+        Vertex quad[4] = {
+            { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f) },
+            { glm::vec3(size, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f) },
+            { glm::vec3(size, size, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f) },
+            { glm::vec3(0.0f, size, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f) }
+        };
+        Mesh mesh(quad, 4, indices, 6, Mesh::ComputeBounds(quad, 4), true, true);
+
+        UniformBuffer<UniformBlocks::Frame> frameBlock;
+        UniformBuffer<UniformBlocks::Object> objectBlock(count);
+        UniformBuffer<UniformBlocks::Material> materialBlock;
+        UniformBlocks::Frame frame = {};
+        frame.view = frame.projection = frame.viewProjection = glm::mat4(1.0f);
+        frameBlock.Push(frame);
+        UniformBlocks::Material material = {};
+        material.color = material.albedo = glm::vec3(1.0f);
+        materialBlock.Push(material);
+
+        int side = (int)std::ceil(std::sqrt((double)count));
+        std::vector<glm::mat4> transforms(count);
+        InstanceBuffer instances;
+        for (int i = 0; i < count; i++) {
+            glm::vec3 position(-1.0f + 2.0f * (i % side) / side, -1.0f + 2.0f * (i / side) / side, 0.0f);
+            transforms[i] = glm::translate(glm::mat4(1.0f), position);
+            instances.Add(transforms[i]);
+        }
+
+        // separate draws, one static instanced draw, then an instanced draw with 1% of the instances moving
+        const int FRAMES = 200;
+        const char *names[3] = { "separate draws", "instanced", "instanced, 1% moving" };
+        std::cout << std::fixed << std::setprecision(2) << count << " quads" << std::endl;
+        for (int mode = 0; mode < 3; mode++) {
+            int moving = mode == 2 ? std::max(count / 100, 1) : 0;
+            double totalMs = 0.0;
+            size_t uploadedBytes = 0;
+            for (int f = 0; f < FRAMES; f++) {
+                // scattered through the buffer, so the dirty pages are not one neighbouring run
+                for (int j = 0; j < moving; j++) {
+                    int i = (int)(((long long)j * 7919 + f * 104729LL) % count);
+                    instances.Set(i, glm::translate(transforms[i], glm::vec3(0.0f, 0.001f * (f % 2), 0.0f)));
+                }
+                instances.ResetStats();
+
+                Clock::time_point frameStart = Clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (mode == 0) {
+                    for (int i = 0; i < count; i++) {
+                        objectBlock.Push(UniformBlocks::Object::FromModel(transforms[i]));
+                        mesh.Draw(shader);
+                    }
+                } else {
+                    mesh.DrawInstanced(instancedShader, instances);
+                }
+                glFinish();
+                totalMs += SecondsSince(frameStart) * 1000.0;
+                uploadedBytes += instances.GetStats().bytes;
+            }
+
+            std::cout << "  " << std::left << std::setw(22) << names[mode] << std::right << std::setw(8) << totalMs / FRAMES << " ms per frame";
+            if (mode > 0) std::cout << ", " << uploadedBytes / FRAMES / 1024.0 << " KB of instances uploaded per frame";
+            std::cout << std::endl;
+        }
+    }
+    if (window) glfwDestroyWindow(window);
+    glfwTerminate();
+
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
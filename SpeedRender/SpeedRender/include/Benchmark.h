@@ -0,0 +1,35 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+
+// Command line benchmarks, run instead of the viewer:
+//   SpeedRender --bench-obj <file.obj>    cy::TriMesh vs ObjLoader throughput in MB/s
+//   SpeedRender --bench-bc <image>        PSNR and encode speed of every block compression format
+//   SpeedRender --bench-mips <image>      mip chain size and build time per channel layout, plain and sRGB
+//   SpeedRender --bench-hdr <file.hdr>    decode and cubemap conversion time of an equirectangular panorama
+//   SpeedRender --bench-vertex <file.obj> size and worst case error of every vertex layout
+//   SpeedRender --bench-codec <file.obj>  round trip check, compression ratio and decode speed of MeshCodec
+//   SpeedRender --bench-stream [GB] [VRAM MB] [RAM MB]
+//                                         flies over a generated terrain of that size streamed within the budgets
+//   SpeedRender --bench-state [draws]     GL state changes and uniform uploads per frame that are issued vs dropped
+//   SpeedRender --bench-instances [count] frame time of count separate draws vs one instanced draw, and the
+//                                         instance bytes uploaded when a few of them move
+namespace Benchmark {
+    // Returns true if argv named a benchmark, which has then been run
+    bool Run(int argc, char **argv);
+
+    void ObjLoading(const char *path);
+    void TextureCompression(const char *path);
+    void MipGeneration(const char *path);
+    void PanoramaConversion(const char *path);
+    void VertexFormats(const char *path);
+    // false if a round trip did not reproduce its input
+    bool MeshCompression(const char *path);
+    // false if the streaming mesh went over one of its budgets or never drew anything
+    bool Streaming(double gigabytes, size_t vramBudget, size_t ramBudget);
+    void StateChanges(int draws);
+    void Instancing(int count);
+}
+
+#endif
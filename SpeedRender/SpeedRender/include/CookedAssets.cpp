@@ -0,0 +1,165 @@
+#include "CookedAssets.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "AssetPack.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[] = "SRCOOK";
+
+    bool EndsWith(const std::string &text, const std::string &suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // the rest of the line after the fields already read, for paths with spaces in them
+    std::string Rest(std::istringstream &line) {
+        std::string rest;
+        std::getline(line >> std::ws, rest);
+        return rest;
+    }
+
+    bool ParseManifest(std::istream &file, const std::string &path, std::vector<CookedAssets::Entry> &entries) {
+        std::string line, magic;
+        uint32_t version = 0;
+        if (!std::getline(file, line)) return false;
+        std::istringstream header(line);
+        if (!(header >> magic >> version) || magic != MAGIC || version != CookedAssets::VERSION) return false;
+
+        entries.clear();
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            std::istringstream fields(line);
+            std::string tag;
+            if (!(fields >> tag)) continue;
+
+            if (tag == "asset") {
+                CookedAssets::Entry entry;
+                fields >> entry.kind;
+                entry.source = Rest(fields);
+                entries.push_back(entry);
+            } else if (entries.empty()) {
+                std::cout << "ERROR::COOKED_ASSETS::BAD_MANIFEST " << path << std::endl;
+                entries.clear();
+                return false;
+            } else if (tag == "input") {
+                CookedAssets::Input input;
+                fields >> input.size >> input.time >> std::hex >> input.hash >> std::dec;
+                input.path = Rest(fields);
+                entries.back().inputs.push_back(input);
+            } else if (tag == "output") {
+                entries.back().outputs.push_back(Rest(fields));
+            }
+        }
+        return true;
+    }
+
+    struct Manifest {
+        std::vector<CookedAssets::Entry> entries;
+        std::unordered_map<std::string, size_t> bySource;
+
+        Manifest() {
+            std::string path = CookedAssets::ManifestPath();
+            std::unique_ptr<MappedFile> packed = AssetPack::Global().Find(path);
+            if (packed) {
+                std::istringstream file(std::string((const char*)packed->Data(), packed->Size()));
+                ParseManifest(file, path, entries);
+            } else {
+                CookedAssets::ReadManifest(path, entries);
+            }
+            for (size_t i = 0; i < entries.size(); i++) bySource[entries[i].source] = i;
+        }
+    };
+}
+
+std::string CookedAssets::ManifestPath(const std::string &outputRoot) {
+    return (fs::path(outputRoot) / "manifest.srcook").generic_string();
+}
+
+std::string CookedAssets::PackPath(const std::string &outputRoot) {
+    return Normalize(outputRoot) + ".srpak";
+}
+
+std::string CookedAssets::OutputPath(const std::string &sourcePath, const std::string &extension,
+                                     const std::string &root, const std::string &outputRoot) {
+    fs::path relative = fs::path(Normalize(sourcePath)).lexically_relative(Normalize(root));
+    return (fs::path(outputRoot) / relative).replace_extension(extension).generic_string();
+}
+
+std::string CookedAssets::Normalize(const std::string &path) {
+    std::string generic = path;
+    for (char &c : generic) if (c == '\\') c = '/';
+    return fs::path(generic).lexically_normal().generic_string();
+}
+
+bool CookedAssets::GetStamp(const std::string &path, uint64_t &size, int64_t &time) {
+    std::error_code ec;
+    size = fs::file_size(path, ec);
+    if (ec) return false;
+    time = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+}
+
+bool CookedAssets::HashFile(const std::string &path, uint64_t &hash) {
+    uint64_t size;
+    int64_t time;
+    if (!GetStamp(path, size, time)) return false;
+
+    hash = Hash::Fnv1a(&size, sizeof(size));
+    if (size == 0) return true;
+
+    MappedFile file(path);
+    if (!file.IsOpen()) return false;
+    hash = Hash::Fnv1a(file.Data(), file.Size(), hash);
+    return true;
+}
+
+bool CookedAssets::ReadManifest(const std::string &path, std::vector<Entry> &entries) {
+    std::ifstream file(path);
+    if (!file) return false;
+    return ParseManifest(file, path, entries);
+}
+
+bool CookedAssets::WriteManifest(const std::string &path, const std::vector<Entry> &entries) {
+    // a cook that dies halfway leaves the old manifest in place
+    return WriteFileAtomically(path, [&](std::ofstream &file) {
+        file << MAGIC << " " << VERSION << "\n";
+        for (const Entry &entry : entries) {
+            file << "asset " << entry.kind << " " << entry.source << "\n";
+            for (const Input &input : entry.inputs)
+                file << "input " << input.size << " " << input.time << " " << std::hex << input.hash << std::dec << " " << input.path << "\n";
+            for (const std::string &output : entry.outputs)
+                file << "output " << output << "\n";
+        }
+        return true;
+    }, std::ios::out);
+}
+
+std::string CookedAssets::Find(const std::string &sourcePath, const std::string &suffix, const Entry **found) {
+    static const Manifest manifest;
+
+    auto it = manifest.bySource.find(Normalize(sourcePath));
+    if (it == manifest.bySource.end()) return "";
+    const Entry &entry = manifest.entries[it->second];
+
+    // only stamps here, hashing the sources would cost what cooking saves
+    for (const Input &input : entry.inputs) {
+        uint64_t size;
+        int64_t time;
+        if (GetStamp(input.path, size, time) && (size != input.size || time != input.time)) return "";
+    }
+
+    for (const std::string &output : entry.outputs) {
+        if (!EndsWith(output, suffix)) continue;
+        if (found) *found = &entry;
+        return output;
+    }
+    return "";
+}
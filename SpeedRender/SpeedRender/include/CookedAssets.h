@@ -0,0 +1,58 @@
+#ifndef COOKED_ASSETS_H
+#define COOKED_ASSETS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runtime side of the asset cooker (SpeedRender --cook). The cooker mirrors assets/ into assets/cooked/ and records
+// every cooked asset in assets/cooked/manifest.srcook: its kind, the inputs it was built from (the source
+// plus dependencies such as shader includes or the other cubemap faces) with their size, modification time
+// and content hash, and the files it produced. The loaders ask Find() for a cooked form first and fall back
+// to their own caches and the sources when there is none or it is out of date.
+namespace CookedAssets {
+    const uint32_t VERSION = 3;
+
+    const char *const ROOT = "assets";
+    const char *const OUTPUT_ROOT = "assets/cooked";
+
+    struct Input {
+        std::string path;
+        uint64_t size = 0;
+        int64_t time = 0;
+        uint64_t hash = 0;
+    };
+
+    struct Entry {
+        std::string kind;       // "mesh", "texture", "cubemap" or "shader"
+        std::string source;     // generic, normalized path under ROOT
+        std::vector<Input> inputs;
+        std::vector<std::string> outputs;
+    };
+
+    std::string ManifestPath(const std::string &outputRoot = OUTPUT_ROOT);
+    // assets/cooked -> assets/cooked.srpak, the AssetPack --cook --pack writes
+    std::string PackPath(const std::string &outputRoot = OUTPUT_ROOT);
+
+    // assets/models/bunny.obj, ".srmz" -> assets/cooked/models/bunny.srmz
+    std::string OutputPath(const std::string &sourcePath, const std::string &extension,
+                           const std::string &root = ROOT, const std::string &outputRoot = OUTPUT_ROOT);
+
+    // "assets\\shaders/../shaders/a.frag" -> "assets/shaders/a.frag", the form paths are kept in
+    std::string Normalize(const std::string &path);
+
+    // size and modification time, false if path does not exist
+    bool GetStamp(const std::string &path, uint64_t &size, int64_t &time);
+    // FNV-1a of the contents, false if path cannot be read
+    bool HashFile(const std::string &path, uint64_t &hash);
+
+    bool ReadManifest(const std::string &path, std::vector<Entry> &entries);
+    bool WriteManifest(const std::string &path, const std::vector<Entry> &entries);
+
+    // The output of sourcePath ending in suffix, or "" if the asset was not cooked or one of its inputs has
+    // changed since. Inputs that no longer exist are fine, shipped builds only carry the cooked files.
+    // The manifest is read on first use, from the asset pack if there is one, safe to call from any thread.
+    std::string Find(const std::string &sourcePath, const std::string &suffix, const Entry **entry = nullptr);
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+#include <memory>
+
 #include "Texture.h"
 
 #include <iostream>
@@ -19,9 +21,14 @@ struct Transform {
 
 typedef glm::vec3 Color;
 
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
 struct Material {
-    Texture diffuseMap;
-    Texture specularMap;
+    std::shared_ptr<Texture> diffuseMap;
+    std::shared_ptr<Texture> specularMap;
     float shininess;
 };
 
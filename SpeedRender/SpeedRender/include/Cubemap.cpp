@@ -1,25 +1,34 @@
 #include "Cubemap.h"
+#include "GLState.h"
+#include "TextureLoader.h"
+
+Cubemap::~Cubemap() {
+    TextureLoader::Get().Cancel(id);
+    GLState::ForgetTexture(id);
+    glDeleteTextures(1, &id);
+}
 
 void Cubemap::LoadCubeMap(const std::vector<std::string> &faces) {
     glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, id);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
-        } else {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+    // grey placeholder faces until the loader has decoded and uploaded the images
+    const unsigned char grey[3] = { 128, 128, 128 };
+    for (unsigned int i = 0; i < 6; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
+                     0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey
+        );
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    if (faces.size() != 6 && faces.size() != 1) {
+        std::cout << "Cubemap needs 6 faces or one panorama, got " << faces.size() << std::endl;
+        return;
+    }
+    hdr = faces.size() == 1;
+    TextureLoader::Get().Request(id, GL_TEXTURE_CUBE_MAP, faces, true, !hdr);
 }  
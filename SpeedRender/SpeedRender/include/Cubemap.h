@@ -14,10 +14,16 @@ public:
 	Cubemap(const std::vector<std::string> &faces) {
 		LoadCubeMap(faces);
 	}
+	~Cubemap();
 
+	Cubemap(const Cubemap &) = delete;
+	Cubemap &operator=(const Cubemap &) = delete;
+
+	// six faces (+X, -X, +Y, -Y, +Z, -Z) or one equirectangular .hdr panorama
 	void LoadCubeMap(const std::vector<std::string> &faces);
 
 	unsigned int id;
+	bool hdr = false;	// linear half float faces from a panorama, to be tone mapped
 };
 
 #endif
\ No newline at end of file
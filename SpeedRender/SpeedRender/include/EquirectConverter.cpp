@@ -0,0 +1,185 @@
+#include "EquirectConverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EQUIRECT_CONVERTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+namespace {
+    const float PI = 3.14159265358979f;
+
+    // one RGBA float texel
+#ifdef EQUIRECT_CONVERTER_SSE2
+    typedef __m128 Texel;
+
+    inline Texel Load(const float *texel) { return _mm_loadu_ps(texel); }
+    inline void Store(float *texel, Texel value) { _mm_storeu_ps(texel, value); }
+    inline Texel Add(Texel a, Texel b) { return _mm_add_ps(a, b); }
+    inline Texel Scale(Texel a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+    inline Texel Lerp(Texel a, Texel b, float t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t))); }
+
+    // the same steps as FloatToHalf, four lanes at a time
+    inline void StoreHalf(uint16_t *rgb, Texel value) {
+        __m128i bits = _mm_castps_si128(value);
+        __m128i sign = _mm_and_si128(bits, _mm_set1_epi32((int)0x80000000));
+        bits = _mm_xor_si128(bits, sign);
+
+        const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denormMagic))), denormMagic);
+        __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        // FloatToHalf's unsigned wrap around as a negative, shifting the negative itself would be undefined
+        const int exponentRebias = -((127 - 15) << 23);
+        __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(exponentRebias + 0xfff)), odd), 13);
+        __m128i isSubnormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+        __m128i half = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+
+        __m128i isNaN = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x7f800000));
+        __m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(isNaN, _mm_set1_epi32(0x0200)));
+        __m128i isOverflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+        half = _mm_or_si128(_mm_and_si128(isOverflow, special), _mm_andnot_si128(isOverflow, half));
+        half = _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+
+        // sign extended first so the saturating pack keeps all 16 bits
+        alignas(16) uint16_t halves[8];
+        half = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+        _mm_store_si128((__m128i*)halves, _mm_packs_epi32(half, half));
+        memcpy(rgb, halves, 3 * sizeof(uint16_t));
+    }
+#else
+    struct Texel {
+        float v[4];
+    };
+
+    inline Texel Load(const float *texel) { return { { texel[0], texel[1], texel[2], texel[3] } }; }
+    inline void Store(float *texel, Texel value) { memcpy(texel, value.v, sizeof(value.v)); }
+    inline Texel Add(Texel a, Texel b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    inline Texel Scale(Texel a, float s) { return { { a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s } }; }
+    inline Texel Lerp(Texel a, Texel b, float t) { return Add(a, Scale(Add(b, Scale(a, -1.0f)), t)); }
+
+    inline void StoreHalf(uint16_t *rgb, Texel value) {
+        for (int c = 0; c < 3; c++) rgb[c] = EquirectConverter::FloatToHalf(value.v[c]);
+    }
+#endif
+
+    // direction through (s, t) in [-1, 1] on a face, t pointing down the rows, laid out like GL cube maps
+    glm::vec3 FaceDirection(int face, float s, float t) {
+        switch (face) {
+        case 0: return glm::vec3(1.0f, -t, -s);
+        case 1: return glm::vec3(-1.0f, -t, s);
+        case 2: return glm::vec3(s, 1.0f, t);
+        case 3: return glm::vec3(s, -1.0f, -t);
+        case 4: return glm::vec3(s, -t, 1.0f);
+        default: return glm::vec3(-s, -t, -1.0f);
+        }
+    }
+
+    // bilinear, wrapping around horizontally and clamped at the poles
+    Texel Sample(const float *rgba, int width, int height, float u, float v) {
+        float x = u * width - 0.5f, y = v * height - 0.5f;
+        int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+        float fx = x - x0, fy = y - y0;
+
+        int x1 = ((x0 + 1) % width + width) % width;
+        x0 = (x0 % width + width) % width;
+        int y1 = std::min(std::max(y0 + 1, 0), height - 1);
+        y0 = std::min(std::max(y0, 0), height - 1);
+
+        Texel top = Lerp(Load(rgba + ((size_t)y0 * width + x0) * 4), Load(rgba + ((size_t)y0 * width + x1) * 4), fx);
+        Texel bottom = Lerp(Load(rgba + ((size_t)y1 * width + x0) * 4), Load(rgba + ((size_t)y1 * width + x1) * 4), fx);
+        return Lerp(top, bottom, fy);
+    }
+
+    // rows of a square level on the pool, small levels on the calling thread
+    template <typename F>
+    void ForRows(int size, F &&body) {
+        if (size < 64) body(0, (size_t)size);
+        else ThreadPool::Global().ParallelFor(size, body);
+    }
+}
+
+int EquirectConverter::FaceSize(int width) {
+    return std::max(width / 4, 1);
+}
+
+uint16_t EquirectConverter::FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t half;
+    if (bits >= (127u + 16u) << 23) {
+        half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < 113u << 23) {
+        // below the smallest normal half, adding the magic number shifts the half's bits into place
+        const uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+        float denormMagic, shifted;
+        memcpy(&denormMagic, &denormMagicBits, sizeof(denormMagic));
+        memcpy(&shifted, &bits, sizeof(shifted));
+        shifted += denormMagic;
+        memcpy(&half, &shifted, sizeof(half));
+        half -= denormMagicBits;
+    } else {
+        // rebias the exponent and round the 13 dropped mantissa bits to even
+        half = (bits + ((uint32_t)(15 - 127) << 23) + 0xfff + ((bits >> 13) & 1)) >> 13;
+    }
+    return (uint16_t)(half | (sign >> 16));
+}
+
+void EquirectConverter::Convert(const float *rgba, int width, int height, int faceSize, bool mipmaps,
+                                std::vector<std::vector<unsigned char>> &faces) {
+    int levelCount = mipmaps ? MipGenerator::LevelCount(faceSize, faceSize) : 1;
+
+    // one face at a time in float, only its half float levels are kept
+    std::vector<float> level, next;
+    for (int face = 0; face < 6; face++) {
+        level.resize((size_t)faceSize * faceSize * 4);
+        ForRows(faceSize, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                for (int x = 0; x < faceSize; x++) {
+                    glm::vec3 direction = glm::normalize(FaceDirection(face, 2.0f * (x + 0.5f) / faceSize - 1.0f,
+                                                                       2.0f * (y + 0.5f) / faceSize - 1.0f));
+                    float u = 0.5f + std::atan2(direction.z, direction.x) / (2.0f * PI);
+                    float v = 0.5f - std::asin(std::min(std::max(direction.y, -1.0f), 1.0f)) / PI;
+                    Store(&level[(y * faceSize + x) * 4], Sample(rgba, width, height, u, v));
+                }
+            }
+        });
+
+        for (int i = 0; i < levelCount; i++) {
+            int size = std::max(faceSize >> i, 1);
+            if (i > 0) {
+                int above = std::max(faceSize >> (i - 1), 1);
+                next.resize((size_t)size * size * 4);
+                ForRows(size, [&](size_t begin, size_t end) {
+                    for (size_t y = begin; y < end; y++) {
+                        const float *row0 = &level[(size_t)std::min((int)y * 2, above - 1) * above * 4];
+                        const float *row1 = &level[(size_t)std::min((int)y * 2 + 1, above - 1) * above * 4];
+                        for (int x = 0; x < size; x++) {
+                            size_t x0 = (size_t)std::min(x * 2, above - 1) * 4, x1 = (size_t)std::min(x * 2 + 1, above - 1) * 4;
+                            Texel sum = Add(Add(Load(row0 + x0), Load(row0 + x1)), Add(Load(row1 + x0), Load(row1 + x1)));
+                            Store(&next[(y * size + x) * 4], Scale(sum, 0.25f));
+                        }
+                    }
+                });
+                level.swap(next);
+            }
+
+            faces.emplace_back((size_t)size * size * 3 * sizeof(uint16_t));
+            uint16_t *halves = (uint16_t*)faces.back().data();
+            ForRows(size, [&](size_t begin, size_t end) {
+                for (size_t texel = begin * size; texel < end * size; texel++)
+                    StoreHalf(halves + texel * 3, Load(&level[texel * 4]));
+            });
+        }
+    }
+}
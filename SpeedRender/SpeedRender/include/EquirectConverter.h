@@ -0,0 +1,25 @@
+#ifndef EQUIRECT_CONVERTER_H
+#define EQUIRECT_CONVERTER_H
+
+#include <cstdint>
+#include <vector>
+
+// Resamples an equirectangular (latitude/longitude) HDR panorama into the six faces of a half float cubemap.
+// Every face texel takes a bilinear sample of the panorama in the direction it covers. Rows are spread over
+// the thread pool, and the filtering, mip reduction and float to half conversion handle a whole RGBA texel
+// per SSE2 register.
+namespace EquirectConverter {
+    // a quarter of the panorama's width, so texels at the equator keep their size
+    int FaceSize(int width);
+
+    // rgba is width x height RGBA floats as from stbi_loadf, row 0 at the top. Appends 6 * levelCount RGB
+    // half float images to faces, face major in the GL order +X, -X, +Y, -Y, +Z, -Z, with mipmaps every
+    // level down to 1x1 box filtered from the float level above it.
+    void Convert(const float *rgba, int width, int height, int faceSize, bool mipmaps,
+                 std::vector<std::vector<unsigned char>> &faces);
+
+    // rounded to nearest even, too large for a half becomes infinity
+    uint16_t FloatToHalf(float value);
+}
+
+#endif
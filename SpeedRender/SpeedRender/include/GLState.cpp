@@ -0,0 +1,204 @@
+#include "GLState.h"
+
+namespace {
+    // state nobody has set through here yet, never equal to a real value
+    const unsigned int UNKNOWN = ~0u;
+
+    const unsigned int TEXTURE_UNITS = 32;
+    const unsigned int UNIFORM_BINDINGS = 16;
+
+    struct UniformRange {
+        unsigned int buffer;
+        size_t offset, size;
+    };
+
+    struct State {
+        unsigned int program;
+        unsigned int vao;
+        unsigned int arrayBuffer, elementBuffer, uniformBuffer, unpackBuffer;
+        UniformRange uniformRanges[UNIFORM_BINDINGS];
+        unsigned int activeUnit;
+        unsigned int textures2D[TEXTURE_UNITS], texturesCube[TEXTURE_UNITS];
+
+        unsigned int depthTest, depthWrite, depthFunc;
+        unsigned int blend, blendSource, blendDestination;
+        unsigned int cullFace;
+        unsigned int polygonMode;
+
+        State() { Invalidate(); }
+
+        void Invalidate() {
+            program = vao = UNKNOWN;
+            arrayBuffer = elementBuffer = uniformBuffer = unpackBuffer = UNKNOWN;
+            for (UniformRange &range : uniformRanges) range = { UNKNOWN, 0, 0 };
+            activeUnit = UNKNOWN;
+            for (unsigned int unit = 0; unit < TEXTURE_UNITS; unit++) textures2D[unit] = texturesCube[unit] = UNKNOWN;
+            depthTest = depthWrite = depthFunc = UNKNOWN;
+            blend = blendSource = blendDestination = UNKNOWN;
+            cullFace = UNKNOWN;
+            polygonMode = UNKNOWN;
+        }
+    };
+
+    State state;
+    GLState::Stats stats;
+
+    // true if current has to change to value, which it is afterwards
+    inline bool Change(unsigned int &current, unsigned int value) {
+        if (current == value) {
+            stats.skipped++;
+            return false;
+        }
+        current = value;
+        stats.issued++;
+        return true;
+    }
+
+    unsigned int *BufferBinding(GLenum target) {
+        switch (target) {
+        case GL_ARRAY_BUFFER: return &state.arrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return &state.elementBuffer;
+        case GL_UNIFORM_BUFFER: return &state.uniformBuffer;
+        case GL_PIXEL_UNPACK_BUFFER: return &state.unpackBuffer;
+        default: return nullptr;
+        }
+    }
+
+    unsigned int *TextureBinding(GLenum target, unsigned int unit) {
+        if (unit >= TEXTURE_UNITS) return nullptr;
+        if (target == GL_TEXTURE_2D) return &state.textures2D[unit];
+        if (target == GL_TEXTURE_CUBE_MAP) return &state.texturesCube[unit];
+        return nullptr;
+    }
+
+    void SetCapability(unsigned int &current, GLenum capability, bool enabled) {
+        if (!Change(current, enabled)) return;
+        if (enabled) glEnable(capability);
+        else glDisable(capability);
+    }
+
+    // unknown rather than 0, a deleted program stays in use until another one is
+    void ForgetName(unsigned int &binding, unsigned int name) {
+        if (binding == name) binding = UNKNOWN;
+    }
+}
+
+void GLState::UseProgram(unsigned int program) {
+    if (Change(state.program, program)) glUseProgram(program);
+}
+
+void GLState::BindVertexArray(unsigned int vao) {
+    if (!Change(state.vao, vao)) return;
+    glBindVertexArray(vao);
+    state.elementBuffer = UNKNOWN;
+}
+
+void GLState::BindBuffer(GLenum target, unsigned int buffer) {
+    unsigned int *binding = BufferBinding(target);
+    if (!binding) {
+        stats.issued++;
+        glBindBuffer(target, buffer);
+    } else if (Change(*binding, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLState::BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    if (target == GL_UNIFORM_BUFFER && index < UNIFORM_BINDINGS) {
+        UniformRange &range = state.uniformRanges[index];
+        if (range.buffer == buffer && range.offset == offset && range.size == size) {
+            stats.skipped++;
+            return;
+        }
+        range = { buffer, offset, size };
+    }
+    stats.issued++;
+    glBindBufferRange(target, index, buffer, (GLintptr)offset, (GLsizeiptr)size);
+    if (unsigned int *binding = BufferBinding(target)) *binding = buffer;
+}
+
+void GLState::BindTexture(GLenum target, unsigned int texture, unsigned int unit) {
+    // the unit is selected even when the bind is skipped, callers edit the texture through it afterwards
+    if (Change(state.activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+
+    unsigned int *binding = TextureBinding(target, unit);
+    if (binding && *binding == texture) {
+        stats.skipped++;
+        return;
+    }
+
+    stats.issued++;
+    glBindTexture(target, texture);
+    if (binding) *binding = texture;
+}
+
+void GLState::SetDepthTest(bool enabled) {
+    SetCapability(state.depthTest, GL_DEPTH_TEST, enabled);
+}
+
+void GLState::SetDepthWrite(bool enabled) {
+    if (Change(state.depthWrite, enabled)) glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::SetDepthFunc(GLenum func) {
+    if (Change(state.depthFunc, func)) glDepthFunc(func);
+}
+
+void GLState::SetBlend(bool enabled) {
+    SetCapability(state.blend, GL_BLEND, enabled);
+}
+
+void GLState::SetBlendFunc(GLenum source, GLenum destination) {
+    if (state.blendSource == source && state.blendDestination == destination) {
+        stats.skipped++;
+        return;
+    }
+    state.blendSource = source;
+    state.blendDestination = destination;
+    stats.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLState::SetCullFace(bool enabled) {
+    SetCapability(state.cullFace, GL_CULL_FACE, enabled);
+}
+
+void GLState::SetPolygonMode(GLenum mode) {
+    if (Change(state.polygonMode, mode)) glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLState::ForgetProgram(unsigned int program) {
+    ForgetName(state.program, program);
+}
+
+void GLState::ForgetVertexArray(unsigned int vao) {
+    if (state.vao == vao) state.vao = state.elementBuffer = UNKNOWN;
+}
+
+void GLState::ForgetBuffer(unsigned int buffer) {
+    ForgetName(state.arrayBuffer, buffer);
+    ForgetName(state.elementBuffer, buffer);
+    ForgetName(state.uniformBuffer, buffer);
+    ForgetName(state.unpackBuffer, buffer);
+    for (UniformRange &range : state.uniformRanges)
+        if (range.buffer == buffer) range = { UNKNOWN, 0, 0 };
+}
+
+void GLState::ForgetTexture(unsigned int texture) {
+    for (unsigned int unit = 0; unit < TEXTURE_UNITS; unit++) {
+        ForgetName(state.textures2D[unit], texture);
+        ForgetName(state.texturesCube[unit], texture);
+    }
+}
+
+void GLState::Invalidate() {
+    state.Invalidate();
+}
+
+const GLState::Stats &GLState::GetStats() {
+    return stats;
+}
+
+void GLState::ResetStats() {
+    stats = Stats();
+}
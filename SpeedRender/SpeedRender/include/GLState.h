@@ -0,0 +1,52 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Remembers the GL state the renderer sets and drops changes to what is already current, so draws can state
+// everything they need without paying for it. Only right as long as every change goes through here: raw
+// binds elsewhere have to be followed by Invalidate. Deleting an object bound here has to be reported with
+// the Forget calls, GL unbinds it and may hand its name out again. ImGui's backend restores what it changes.
+namespace GLState {
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vao);
+    // array, element array, uniform and pixel unpack buffers are tracked, others go straight through.
+    // The element array binding is part of the VAO and is forgotten whenever the VAO changes.
+    void BindBuffer(GLenum target, unsigned int buffer);
+    // for uniform buffers, also binds buffer to the generic target like GL does
+    void BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+    // 2D and cube map textures are tracked per unit. unit is active afterwards, even if the bind was skipped,
+    // so glTex* calls that follow edit texture.
+    void BindTexture(GLenum target, unsigned int texture, unsigned int unit = 0);
+
+    void SetDepthTest(bool enabled);
+    void SetDepthWrite(bool enabled);
+    void SetDepthFunc(GLenum func);
+    void SetBlend(bool enabled);
+    void SetBlendFunc(GLenum source, GLenum destination);
+    void SetCullFace(bool enabled);
+    void SetPolygonMode(GLenum mode);
+
+    // call before deleting an object, its name may come back for a new one
+    void ForgetProgram(unsigned int program);
+    void ForgetVertexArray(unsigned int vao);
+    void ForgetBuffer(unsigned int buffer);
+    void ForgetTexture(unsigned int texture);
+
+    // after code that changes state behind this cache, everything is set again on the next call
+    void Invalidate();
+
+    // calls since the last ResetStats
+    struct Stats {
+        unsigned int issued = 0;    // reached GL
+        unsigned int skipped = 0;   // already current
+    };
+
+    const Stats &GetStats();
+    // once per frame, like Shader::ResetUniformStats
+    void ResetStats();
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a, for cache keys and content hashes. Chain calls by passing the previous result as seed.
+namespace Hash {
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    inline uint64_t Fnv1a(const void *data, size_t size, uint64_t seed = FNV_OFFSET) {
+        const unsigned char *bytes = (const unsigned char*)data;
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    inline uint64_t Fnv1a(const std::string &text, uint64_t seed = FNV_OFFSET) {
+        // the length goes in too, so "ab" + "c" and "a" + "bc" chain to different keys
+        uint64_t size = text.size();
+        return Fnv1a(text.data(), text.size(), Fnv1a(&size, sizeof(size), seed));
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "InstanceBuffer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+#include "GLState.h"
+
+namespace {
+    InstanceBuffer::Instance MakeInstance(const glm::mat4 &model, const glm::vec4 &color) {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        return { model, color, { glm::vec4(normalMatrix[0], 0.0f), glm::vec4(normalMatrix[1], 0.0f), glm::vec4(normalMatrix[2], 0.0f) } };
+    }
+}
+
+InstanceBuffer::InstanceBuffer() {
+    glGenBuffers(1, &id);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    GLState::ForgetBuffer(id);
+    glDeleteBuffers(1, &id);
+}
+
+size_t InstanceBuffer::Add(const glm::mat4 &model, const glm::vec4 &color) {
+    instances.push_back(MakeInstance(model, color));
+    dirtyPages.resize((instances.size() + PAGE_SIZE - 1) / PAGE_SIZE);
+    MarkDirty(instances.size() - 1);
+    return instances.size() - 1;
+}
+
+void InstanceBuffer::Set(size_t index, const glm::mat4 &model) {
+    instances[index] = MakeInstance(model, instances[index].color);
+    MarkDirty(index);
+}
+
+void InstanceBuffer::SetColor(size_t index, const glm::vec4 &color) {
+    instances[index].color = color;
+    MarkDirty(index);
+}
+
+void InstanceBuffer::Resize(size_t count) {
+    size_t previous = instances.size();
+    instances.resize(count, MakeInstance(glm::mat4(1.0f), glm::vec4(1.0f)));
+    dirtyPages.resize((count + PAGE_SIZE - 1) / PAGE_SIZE);
+    for (size_t i = previous; i < count; i += PAGE_SIZE) MarkDirty(i);
+}
+
+void InstanceBuffer::MarkDirty(size_t index) {
+    dirtyPages[index / PAGE_SIZE] = true;
+    dirty = true;
+}
+
+void InstanceBuffer::Upload() {
+    GLState::BindBuffer(GL_ARRAY_BUFFER, id);
+
+    if (instances.size() > capacity) {
+        capacity = std::max(instances.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance), instances.data());
+        stats.uploads++;
+        stats.bytes += instances.size() * sizeof(Instance);
+        std::fill(dirtyPages.begin(), dirtyPages.end(), false);
+        dirty = false;
+        return;
+    }
+    if (!dirty) return;
+
+    for (size_t page = 0; page < dirtyPages.size();) {
+        if (!dirtyPages[page]) {
+            page++;
+            continue;
+        }
+
+        size_t end = page;
+        while (end < dirtyPages.size() && dirtyPages[end]) dirtyPages[end++] = false;
+
+        size_t first = page * PAGE_SIZE, last = std::min(end * PAGE_SIZE, instances.size());
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Instance), (last - first) * sizeof(Instance), &instances[first]);
+        stats.uploads++;
+        stats.bytes += (last - first) * sizeof(Instance);
+        page = end;
+    }
+    dirty = false;
+}
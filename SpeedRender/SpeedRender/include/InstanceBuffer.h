@@ -0,0 +1,70 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Per instance transforms and colors of an instanced draw, see Mesh::DrawInstanced. MainVertex.vert built
+// with INSTANCED reads them as attributes that advance once per instance instead of from the Object block.
+// Changes stay on the CPU and mark their page of PAGE_SIZE instances dirty, Upload sends only the dirty
+// pages, one glBufferSubData per run of neighbouring ones. Outgrowing the GL buffer reallocates it at twice
+// the size, which uploads everything once.
+class InstanceBuffer {
+public:
+    // attribute locations, after the mesh's position, normal and UVs. The matrices take one per column.
+    static const unsigned int MODEL_LOCATION = 3;
+    static const unsigned int COLOR_LOCATION = 7;
+    static const unsigned int NORMAL_MATRIX_LOCATION = 8;
+
+    struct Instance {
+        glm::mat4 model;
+        glm::vec4 color;            // multiplies the material's color
+        // columns of the inverse transpose of model, once per Set instead of per vertex, w unused
+        glm::vec4 normalMatrix[3];
+    };
+
+    // uploads since the last ResetStats
+    struct Stats {
+        unsigned int uploads = 0;   // glBufferData and glBufferSubData calls
+        size_t bytes = 0;
+    };
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer&) = delete;
+
+    // index of the new instance
+    size_t Add(const glm::mat4 &model, const glm::vec4 &color = glm::vec4(1.0f));
+    void Set(size_t index, const glm::mat4 &model);
+    void SetColor(size_t index, const glm::vec4 &color);
+    // new instances are identity transforms in white
+    void Resize(size_t count);
+
+    const Instance &Get(size_t index) const { return instances[index]; }
+    size_t Size() const { return instances.size(); }
+
+    // sends the dirty pages and leaves the buffer bound to GL_ARRAY_BUFFER, called by Mesh::DrawInstanced
+    void Upload();
+    unsigned int GetID() const { return id; }
+
+    const Stats &GetStats() const { return stats; }
+    void ResetStats() { stats = Stats(); }
+
+private:
+    static const size_t PAGE_SIZE = 64;
+
+    void MarkDirty(size_t index);
+
+    unsigned int id = 0;
+    size_t capacity = 0;    // instances the GL buffer has room for
+    std::vector<Instance> instances;
+    std::vector<bool> dirtyPages;
+    bool dirty = false;
+    Stats stats;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "Lighting.h"
+#include "GLState.h"
+#include "ResourceManager.h"
 
 float vertices[] = {
     -0.5f, -0.5f, -0.5f,
@@ -58,13 +60,13 @@ PointLight::PointLight(const glm::vec3& position, const glm::vec3 &scale, const
     this->attenuationProfile = attenuationProfile;
 
 	// create shader
-    shader = *(new Shader("assets/shaders/Light.vs", "assets/shaders/Light.fs"));
+    shader = ResourceManager::GetShader("assets/shaders/Light.vs", "assets/shaders/Light.fs");
 
 	// create vao, vbo
     glGenVertexArrays(1, &VAO);  
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -75,13 +77,13 @@ void PointLight::Draw(const glm::mat4 &view, const glm::mat4 &projection) const
     model = glm::translate(model, position);
     model = glm::scale(model, scale);
     
-    shader.Use();
-    shader.SetMat4("model", model);
-    shader.SetMat4("view", view);
-    shader.SetMat4("projection", projection);
-    shader.SetVec3("color", color);
+    shader->Use();
+    shader->SetMat4("model", model);
+    shader->SetMat4("view", view);
+    shader->SetMat4("projection", projection);
+    shader->SetVec3("color", color);
 
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 }
 
@@ -97,13 +99,13 @@ SpotLight::SpotLight(const glm::vec3 &position, const glm::vec3 &direction, floa
     this->attenuationProfile = attenuationProfile;
 
 	// create shader
-    shader = *(new Shader("assets/shaders/Light.vs", "assets/shaders/Light.fs"));
+    shader = ResourceManager::GetShader("assets/shaders/Light.vs", "assets/shaders/Light.fs");
 
 	// create vao, vbo
     glGenVertexArrays(1, &VAO);  
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -114,12 +116,12 @@ void SpotLight::Draw(const glm::mat4 &view, const glm::mat4 &projection) const {
     model = glm::translate(model, position);
     model = glm::scale(model, scale);
     
-    shader.Use();
-    shader.SetMat4("model", model);
-    shader.SetMat4("view", view);
-    shader.SetMat4("projection", projection);
-    shader.SetVec3("color", color);
+    shader->Use();
+    shader->SetMat4("model", model);
+    shader->SetMat4("view", view);
+    shader->SetMat4("projection", projection);
+    shader->SetVec3("color", color);
 
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 }
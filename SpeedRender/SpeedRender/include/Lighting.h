@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
   
+#include <memory>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -48,7 +49,7 @@ public:
     AttenuationProfile attenuationProfile;
 private:
     unsigned int VAO, VBO;
-    Shader shader;
+    std::shared_ptr<Shader> shader;
 };
 
 class SpotLight {
@@ -67,7 +68,7 @@ public:
 	AttenuationProfile attenuationProfile;
 private:
     unsigned int VAO, VBO;
-    Shader shader;
+    std::shared_ptr<Shader> shader;
 };
   
 #endif
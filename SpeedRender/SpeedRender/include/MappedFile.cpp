@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const unsigned char*)view;
+    size = (size_t)fileSize.QuadPart;
+    owned = true;
+}
+
+MappedFile::~MappedFile() {
+    if (owned) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file
+    if (view == MAP_FAILED) return;
+
+    data = (const unsigned char*)view;
+    size = (size_t)st.st_size;
+    owned = true;
+}
+
+MappedFile::~MappedFile() {
+    if (owned) munmap((void*)data, size);
+}
+#endif
+
+bool WriteFileAtomically(const std::string &path, const std::function<bool(std::ofstream &)> &write, std::ios::openmode mode) {
+    std::string tempPath = path + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tempPath, mode | std::ios::trunc);
+        if (!out) return false;
+        written = write(out) && out;
+    }
+
+    // the stream is closed by now, Windows won't rename or remove an open file
+    std::error_code ec;
+    if (written) std::filesystem::rename(tempPath, path, ec);
+    if (!written || ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
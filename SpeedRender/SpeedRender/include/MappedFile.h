@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fstream>
+#include <functional>
+#include <string>
+
+// Read-only memory mapping of a whole file. The view stays valid until the object is destroyed.
+class MappedFile {
+public:
+    MappedFile(const std::string &path);
+    // A file that lives inside memory mapped elsewhere, e.g. in an AssetPack. Nothing is unmapped, the
+    // owner of the memory has to outlive the view.
+    MappedFile(const unsigned char *data, size_t size) : data(data), size(size) {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool IsOpen() const { return data != nullptr; }
+    const unsigned char *Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    bool owned = false;
+
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+// Writes path through path.tmp and a rename, so a crash or failed write never leaves a half written file
+// where readers look and keeps the previous one. write fills the stream and returns false to give up. False
+// if anything failed, the temp file is removed either way.
+bool WriteFileAtomically(const std::string &path, const std::function<bool(std::ofstream &)> &write,
+                         std::ios::openmode mode = std::ios::binary);
+
+#endif
@@ -1,6 +1,12 @@
 #include "Mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, bool hasNormals, bool hasUVs) {
+#include <algorithm>
+
+#include "GLState.h"
+
+static VertexFormat::Layout defaultLayout = VertexFormat::Layout::Float;
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<std::shared_ptr<Texture>> textures, bool hasNormals, bool hasUVs) {
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
@@ -9,7 +15,13 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std:
 
     this->hasIndices = true;
 
-    SetupMesh();
+    this->vertexCount = (unsigned int)this->vertices.size();
+    this->indexCount = (unsigned int)this->indices.size();
+    this->bounds = ComputeBounds(this->vertices.data(), this->vertices.size());
+
+    this->lods = { { 0, this->indexCount, 0.0f, 0, 0 } };
+
+    SetupMesh(this->vertices.data(), this->indices.data());
 }
 
 Mesh::Mesh(std::vector<float> vertexPositions) {
@@ -20,87 +32,260 @@ Mesh::Mesh(std::vector<float> vertexPositions) {
             glm::vec2(0.0f),
         });
 
-        indices.push_back(i);
-        indices.push_back(i+1);
-        indices.push_back(i+2);
+        indices.push_back((unsigned int)indices.size());
     }
 
     hasNormals = false;
     hasUVs = false;
     hasIndices = true;
 
-    SetupMesh();
+    vertexCount = (unsigned int)vertices.size();
+    indexCount = (unsigned int)indices.size();
+    bounds = ComputeBounds(vertices.data(), vertices.size());
+    lods = { { 0, indexCount, 0.0f, 0, 0 } };
+
+    SetupMesh(vertices.data(), indices.data());
+}
+
+Mesh::Mesh(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount, const AABB &bounds, bool hasNormals, bool hasUVs,
+           VertexFormat::Layout layout, const std::vector<MeshLod> &lods, const std::vector<Meshlet> &meshlets) {
+    this->layout = layout;
+    this->lods = lods;
+    this->meshlets = meshlets;
+    if (this->lods.empty()) this->lods = { { 0, (uint32_t)indexCount, 0.0f, 0, 0 } };
+    this->vertexCount = (unsigned int)vertexCount;
+    this->indexCount = (unsigned int)indexCount;
+    this->bounds = bounds;
+    this->hasNormals = hasNormals;
+    this->hasUVs = hasUVs;
+    this->hasIndices = indices != nullptr;
+
+    dequantization = VertexFormat::ComputeDequantization(layout, vertices, vertexCount, bounds);
+    dequantization.octNormals = dequantization.octNormals && hasNormals;
+    if (layout == VertexFormat::Layout::Float) {
+        SetupMesh(vertices, indices);
+    } else {
+        std::vector<VertexFormat::PackedVertex> packed(vertexCount);
+        VertexFormat::Pack(vertices, vertexCount, dequantization, layout, packed.data());
+        SetupMesh(packed.data(), indices);
+    }
 }
 
-void Mesh::SetupMesh() {
+Mesh::Mesh(const VertexFormat::PackedVertex *vertices, size_t vertexCount, VertexFormat::Layout layout, const VertexFormat::Dequantization &dequantization,
+           const unsigned int *indices, size_t indexCount, const AABB &bounds, bool hasNormals, bool hasUVs,
+           const std::vector<MeshLod> &lods, const std::vector<Meshlet> &meshlets) {
+    this->layout = layout;
+    this->dequantization = dequantization;
+    this->dequantization.octNormals = hasNormals;
+    this->lods = lods;
+    this->meshlets = meshlets;
+    if (this->lods.empty()) this->lods = { { 0, (uint32_t)indexCount, 0.0f, 0, 0 } };
+    this->vertexCount = (unsigned int)vertexCount;
+    this->indexCount = (unsigned int)indexCount;
+    this->bounds = bounds;
+    this->hasNormals = hasNormals;
+    this->hasUVs = hasUVs;
+    this->hasIndices = indices != nullptr;
+
+    SetupMesh(vertices, indices);
+}
+
+Mesh::~Mesh() {
+    GLState::ForgetVertexArray(VAO);
+    GLState::ForgetBuffer(VBO);
+    GLState::ForgetBuffer(EBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+AABB Mesh::ComputeBounds(const Vertex *vertices, size_t vertexCount) {
+    if (vertexCount == 0) return { glm::vec3(0.0f), glm::vec3(0.0f) };
+
+    AABB bounds = { vertices[0].position, vertices[0].position };
+    for (size_t i = 1; i < vertexCount; i++) {
+        bounds.min = glm::min(bounds.min, vertices[i].position);
+        bounds.max = glm::max(bounds.max, vertices[i].position);
+    }
+    return bounds;
+}
+
+void Mesh::SetDefaultLayout(VertexFormat::Layout layout) {
+    defaultLayout = layout;
+}
+
+VertexFormat::Layout Mesh::GetDefaultLayout() {
+    return defaultLayout;
+}
+
+void Mesh::SetupMesh(const void *vertexData, const unsigned int *indexData) {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
   
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+    GLState::BindVertexArray(VAO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * VertexFormat::Stride(layout), vertexData, GL_STATIC_DRAW);
 
     if (hasIndices) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
     }
 
+    // packed attributes are normalized to [0, 1] or [-1, 1] (half floats as is), MainVertex.vert
+    // scales them back with the mesh's dequantization uniforms
+    bool packed = layout != VertexFormat::Layout::Float;
+    GLsizei stride = (GLsizei)VertexFormat::Stride(layout);
+
     int attribArray = 0;
     glEnableVertexAttribArray(attribArray);
-    glVertexAttribPointer(attribArray, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    if (packed) glVertexAttribPointer(attribArray, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedVertex, position));
+    else glVertexAttribPointer(attribArray, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
     attribArray++;
 
     if (hasNormals) {
         glEnableVertexAttribArray(attribArray);	
-        glVertexAttribPointer(attribArray, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        if (packed) glVertexAttribPointer(attribArray, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedVertex, normal));
+        else glVertexAttribPointer(attribArray, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal));
         attribArray++;
     }
 
     if (hasUVs) {
         glEnableVertexAttribArray(attribArray);	
-        glVertexAttribPointer(attribArray, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+        if (layout == VertexFormat::Layout::PackedUnormUV)
+            glVertexAttribPointer(attribArray, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedVertex, texCoords));
+        else if (packed)
+            glVertexAttribPointer(attribArray, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexFormat::PackedVertex, texCoords));
+        else
+            glVertexAttribPointer(attribArray, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, texCoords));
         attribArray++;
     } 
 
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
-void Mesh::Draw(Shader& shader) {
-    shader.Use();
+void Mesh::Draw(Shader& shader, size_t lod) {
+    Bind(shader);
 
-    if (shader.depthTest) glEnable(GL_DEPTH_TEST);
-    else glDisable(GL_DEPTH_TEST);
+    if (hasIndices) {
+        const MeshLod &range = lods[std::min(lod, lods.size() - 1)];
+        glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.indexOffset * sizeof(unsigned int)));
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    }
+}
+
+size_t Mesh::DrawVisible(Shader &shader, size_t lod, const glm::mat4 &modelViewProjection, const glm::vec3 &eye) {
+    const MeshLod &range = lods[std::min(lod, lods.size() - 1)];
+    if (!hasIndices || range.meshletCount == 0) {
+        Draw(shader, lod);
+        return (hasIndices ? range.indexCount : vertexCount) / 3;
+    }
+
+    // frustum planes in model space (Gribb & Hartmann), normalized so they measure distances
+    glm::mat4 m = glm::transpose(modelViewProjection);
+    glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+    for (glm::vec4 &plane : planes) plane /= glm::length(glm::vec3(plane));
+
+    drawCounts.clear();
+    drawOffsets.clear();
+    size_t triangles = 0;
+    unsigned int end = ~0u;
+    for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++) {
+        const Meshlet &meshlet = meshlets[i];
+
+        bool outside = false;
+        for (const glm::vec4 &plane : planes)
+            outside = outside || glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius;
+        if (outside) continue;
+
+        glm::vec3 toCenter = meshlet.center - eye;
+        if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) continue;
+
+        // neighbouring meshlets are neighbouring ranges, merge them into one draw
+        if (meshlet.indexOffset == end) {
+            drawCounts.back() += meshlet.indexCount;
+        } else {
+            drawCounts.push_back(meshlet.indexCount);
+            drawOffsets.push_back((const void*)(meshlet.indexOffset * sizeof(unsigned int)));
+        }
+        end = meshlet.indexOffset + meshlet.indexCount;
+        triangles += meshlet.indexCount / 3;
+    }
+
+    if (!drawCounts.empty()) {
+        Bind(shader);
+        glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), (GLsizei)drawCounts.size());
+    }
+    return triangles;
+}
 
-    if (shader.depthWrite) glDepthMask(GL_TRUE); 
-    else glDepthMask(GL_FALSE); 
+size_t Mesh::DrawInstanced(Shader &shader, InstanceBuffer &instances, size_t lod) {
+    if (instances.Size() == 0) return 0;
+    instances.Upload();
+    Bind(shader);
 
-    glDepthFunc(shader.depthFunc);
+    // pointed at the instance buffer on every draw and switched off again afterwards, so Draw on the same VAO
+    // never reads per instance attributes from a buffer that may have been deleted since
+    GLState::BindBuffer(GL_ARRAY_BUFFER, instances.GetID());
+    GLsizei stride = (GLsizei)sizeof(InstanceBuffer::Instance);
+    for (unsigned int column = 0; column < 4; column++) {
+        unsigned int location = InstanceBuffer::MODEL_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceBuffer::Instance, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+    glEnableVertexAttribArray(InstanceBuffer::COLOR_LOCATION);
+    glVertexAttribPointer(InstanceBuffer::COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceBuffer::Instance, color));
+    glVertexAttribDivisor(InstanceBuffer::COLOR_LOCATION, 1);
+    for (unsigned int column = 0; column < 3; column++) {
+        unsigned int location = InstanceBuffer::NORMAL_MATRIX_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceBuffer::Instance, normalMatrix) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    GLsizei count = (GLsizei)instances.Size();
+    size_t triangles;
+    if (hasIndices) {
+        const MeshLod &range = lods[std::min(lod, lods.size() - 1)];
+        glDrawElementsInstanced(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.indexOffset * sizeof(unsigned int)), count);
+        triangles = (size_t)range.indexCount / 3 * count;
+    } else {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, count);
+        triangles = (size_t)vertexCount / 3 * count;
+    }
+
+    for (unsigned int location = InstanceBuffer::MODEL_LOCATION; location < InstanceBuffer::NORMAL_MATRIX_LOCATION + 3; location++) {
+        glDisableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 0);
+    }
+    return triangles;
+}
+
+void Mesh::Bind(Shader &shader) {
+    shader.Use();
 
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     for(unsigned int i = 0; i < textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
         // retrieve texture number (the N in diffuse_textureN)
         std::string number;
-        std::string name = textures[i].type;
+        std::string name = textures[i]->type;
         if(name == "texture_diffuse")
             number = std::to_string(diffuseNr++);
         else if(name == "texture_specular")
             number = std::to_string(specularNr++);
 
-        shader.SetFloat(("material." + name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        shader.SetInt("material." + name + number, i);
+        GLState::BindTexture(GL_TEXTURE_2D, textures[i]->id, i);
     }
-    glActiveTexture(GL_TEXTURE0);
 
-    // draw mesh
-    glBindVertexArray(VAO);
-    if (hasIndices) {
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    } else {
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-    }
-    glBindVertexArray(0);
+    shader.SetVec3("positionOffset", dequantization.positionOffset);
+    shader.SetVec3("positionScale", dequantization.positionScale);
+    shader.SetVec2("uvOffset", dequantization.uvOffset);
+    shader.SetVec2("uvScale", dequantization.uvScale);
+    shader.SetBool("octNormals", dequantization.octNormals);
+
+    GLState::BindVertexArray(VAO);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "Core.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "VertexFormat.h"
+#include "InstanceBuffer.h"
 
 struct Vertex {
     glm::vec3 position;
@@ -11,28 +13,91 @@ struct Vertex {
     glm::vec2 texCoords;
 };
 
+// One level of detail, a range of the mesh's index buffer over the shared vertices
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;    // how far the surface moved from the full mesh, in model units
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+};
+
+// A cluster of at most 64 vertices and 124 triangles, a contiguous run of its LOD's index range
+struct Meshlet {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    glm::vec3 center;       // bounding sphere
+    float radius;
+    // normal cone, every triangle faces away from eye if dot(center - eye, coneAxis) >= coneCutoff * |center - eye| + radius
+    glm::vec3 coneAxis;
+    float coneCutoff;       // 1 when the triangles spread too far to ever cull the cluster
+};
+
 class Mesh {
     public:
-        // mesh data
+        // mesh data, vertices and indices stay empty when the mesh was uploaded from external memory
         std::vector<Vertex>       vertices;
         std::vector<unsigned int> indices;
-        std::vector<Texture>      textures;
+        std::vector<std::shared_ptr<Texture>> textures;
+        unsigned int vertexCount;
+        unsigned int indexCount;
+        AABB bounds;
         bool hasNormals;
         bool hasUVs;
         bool hasIndices;
+        // how the vertex buffer is laid out on the GPU, see VertexFormat
+        VertexFormat::Layout layout = VertexFormat::Layout::Float;
+        VertexFormat::Dequantization dequantization;
+        // lods[0] is the full mesh, later levels are coarser
+        std::vector<MeshLod> lods;
+        std::vector<Meshlet> meshlets;
 
-        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, bool hasNormals, bool hasUVs);
+        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<std::shared_ptr<Texture>> textures, bool hasNormals, bool hasUVs);
         Mesh(std::vector<float> vertexPositions);
-        void Draw(Shader &shader);
+        // uploads straight from caller owned memory (e.g. a mapped cache file) without keeping a CPU copy
+        Mesh(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount, const AABB &bounds, bool hasNormals, bool hasUVs,
+             VertexFormat::Layout layout = VertexFormat::Layout::Float, const std::vector<MeshLod> &lods = {},
+             const std::vector<Meshlet> &meshlets = {});
+        // uploads vertices that are already packed in layout, as decoded from a compressed mesh
+        Mesh(const VertexFormat::PackedVertex *vertices, size_t vertexCount, VertexFormat::Layout layout, const VertexFormat::Dequantization &dequantization,
+             const unsigned int *indices, size_t indexCount, const AABB &bounds, bool hasNormals, bool hasUVs,
+             const std::vector<MeshLod> &lods, const std::vector<Meshlet> &meshlets);
+        ~Mesh();
+        void Draw(Shader &shader, size_t lod = 0);
+        // Draws the meshlets of lod that are inside the frustum of modelViewProjection and not facing away
+        // from eye (in model space) with one glMultiDrawElements. Returns the number of triangles drawn.
+        size_t DrawVisible(Shader &shader, size_t lod, const glm::mat4 &modelViewProjection, const glm::vec3 &eye);
+        // Draws lod once per instance with a single call, shader has to be built with INSTANCED. Uploads the
+        // instances that changed first. Returns the number of triangles drawn.
+        size_t DrawInstanced(Shader &shader, InstanceBuffer &instances, size_t lod = 0);
+
+        // owns its GL buffers, share it through ResourceManager instead of copying
+        Mesh(const Mesh &) = delete;
+        Mesh &operator=(const Mesh &) = delete;
 
-        void AddTexture(Texture tex) {
+        static AABB ComputeBounds(const Vertex *vertices, size_t vertexCount);
+
+        // layout for meshes loaded from files afterwards, Float by default
+        static void SetDefaultLayout(VertexFormat::Layout layout);
+        static VertexFormat::Layout GetDefaultLayout();
+
+        void AddTexture(std::shared_ptr<Texture> tex) {
             textures.push_back(tex);
         }
+
+        // identifies the mesh in render queue keys
+        unsigned int GetVAO() const { return VAO; }
     private:
         //  render data
         unsigned int VAO, VBO, EBO;
 
-        void SetupMesh();
+        // visible index ranges of the last DrawVisible, kept to avoid allocating every frame
+        std::vector<GLsizei> drawCounts;
+        std::vector<const void*> drawOffsets;
+
+        // vertexData is in layout already
+        void SetupMesh(const void *vertexData, const unsigned int *indexData);
+        void Bind(Shader &shader);
 };  
 
 #endif
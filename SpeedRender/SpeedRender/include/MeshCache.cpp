@@ -0,0 +1,123 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "AssetPack.h"
+#include "CookedAssets.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'M', 'S' };
+
+    uint64_t AlignUp(uint64_t offset) {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+}
+
+std::string MeshCache::CachePath(const std::string &sourcePath) {
+    return fs::path(sourcePath).replace_extension(".srmesh").string();
+}
+
+bool MeshCache::ReadBounds(const std::string &cachePath, AABB &bounds) {
+    // only the header page is touched
+    std::unique_ptr<MappedFile> file = AssetPack::Map(cachePath);
+    if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, file->Data(), sizeof(Header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+
+    memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+    return true;
+}
+
+bool MeshCache::Load(const std::string &cachePath, const std::string &sourcePath, View &view) {
+    std::unique_ptr<MappedFile> file = AssetPack::Map(cachePath);
+    if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+    const Header *header = (const Header*)file->Data();
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) return false;
+
+    // a missing source is fine, shipped builds only carry the caches
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (CookedAssets::GetStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != header->sourceSize || sourceTime != header->sourceTime)) return false;
+
+    uint64_t vertexEnd = header->vertexOffset + (uint64_t)header->vertexCount * sizeof(Vertex);
+    uint64_t indexEnd = header->indexOffset + (uint64_t)header->indexCount * sizeof(unsigned int);
+    uint64_t lodEnd = header->lodOffset + (uint64_t)header->lodCount * sizeof(MeshLod);
+    uint64_t meshletEnd = header->meshletOffset + (uint64_t)header->meshletCount * sizeof(Meshlet);
+    if (vertexEnd > file->Size() || indexEnd > file->Size() || lodEnd > file->Size() || meshletEnd > file->Size()) {
+        std::cout << "ERROR::MESH_CACHE::TRUNCATED " << cachePath << std::endl;
+        return false;
+    }
+
+    const MeshLod *lods = (const MeshLod*)(file->Data() + header->lodOffset);
+    const Meshlet *meshlets = (const Meshlet*)(file->Data() + header->meshletOffset);
+    for (uint32_t i = 0; i < header->lodCount; i++) {
+        const MeshLod &lod = lods[i];
+        if ((uint64_t)lod.indexOffset + lod.indexCount > header->indexCount ||
+            (uint64_t)lod.meshletOffset + lod.meshletCount > header->meshletCount) {
+            std::cout << "ERROR::MESH_CACHE::BAD_LOD " << cachePath << std::endl;
+            return false;
+        }
+        // DrawVisible hands these ranges straight to GL
+        for (uint32_t j = lod.meshletOffset; j < lod.meshletOffset + lod.meshletCount; j++) {
+            if (meshlets[j].indexOffset < lod.indexOffset ||
+                (uint64_t)meshlets[j].indexOffset + meshlets[j].indexCount > (uint64_t)lod.indexOffset + lod.indexCount) {
+                std::cout << "ERROR::MESH_CACHE::BAD_MESHLET " << cachePath << std::endl;
+                return false;
+            }
+        }
+    }
+
+    view.header = header;
+    view.vertices = (const Vertex*)(file->Data() + header->vertexOffset);
+    view.indices = (const unsigned int*)(file->Data() + header->indexOffset);
+    view.lods = lods;
+    view.meshlets = meshlets;
+    view.file = std::move(file);
+    return true;
+}
+
+bool MeshCache::Write(const std::string &cachePath, const std::string &sourcePath,
+                      const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                      const std::vector<MeshLod> &lods, const std::vector<Meshlet> &meshlets, const AABB &bounds, bool hasNormals, bool hasUVs) {
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (hasNormals ? FLAG_NORMALS : 0) | (hasUVs ? FLAG_UVS : 0);
+    header.vertexCount = (uint32_t)vertices.size();
+    header.indexCount = (uint32_t)indices.size();
+    header.lodCount = (uint32_t)lods.size();
+    header.meshletCount = (uint32_t)meshlets.size();
+    memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+    if (!CookedAssets::GetStamp(sourcePath, header.sourceSize, header.sourceTime)) return false;
+    header.vertexOffset = AlignUp(sizeof(Header));
+    header.indexOffset = AlignUp(header.vertexOffset + vertices.size() * sizeof(Vertex));
+    header.lodOffset = AlignUp(header.indexOffset + indices.size() * sizeof(unsigned int));
+    header.meshletOffset = AlignUp(header.lodOffset + lods.size() * sizeof(MeshLod));
+
+    bool written = WriteFileAtomically(cachePath, [&](std::ofstream &out) {
+        const char padding[16] = {};
+        out.write((const char*)&header, sizeof(Header));
+        out.write(padding, header.vertexOffset - sizeof(Header));
+        out.write((const char*)vertices.data(), vertices.size() * sizeof(Vertex));
+        out.write(padding, header.indexOffset - (header.vertexOffset + vertices.size() * sizeof(Vertex)));
+        out.write((const char*)indices.data(), indices.size() * sizeof(unsigned int));
+        out.write(padding, header.lodOffset - (header.indexOffset + indices.size() * sizeof(unsigned int)));
+        out.write((const char*)lods.data(), lods.size() * sizeof(MeshLod));
+        out.write(padding, header.meshletOffset - (header.lodOffset + lods.size() * sizeof(MeshLod)));
+        out.write((const char*)meshlets.data(), meshlets.size() * sizeof(Meshlet));
+        return true;
+    });
+    if (!written) std::cout << "ERROR::MESH_CACHE::WRITE_FAILED " << cachePath << std::endl;
+    return written;
+}
@@ -0,0 +1,64 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Core.h"
+#include "Mesh.h"
+#include "MappedFile.h"
+
+// Binary .srmesh files hold the final, optimized vertex and index arrays of a model so later runs
+// can map them and hand them to glBufferData without parsing the source OBJ again.
+namespace MeshCache {
+    const uint32_t VERSION = 3;
+
+    const uint32_t FLAG_NORMALS = 1 << 0;
+    const uint32_t FLAG_UVS = 1 << 1;
+
+    struct Header {
+        char     magic[4];      // "SRMS"
+        uint32_t version;
+        uint32_t flags;
+        uint32_t vertexCount;
+        uint32_t indexCount;    // every LOD, back to back
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint64_t sourceSize;    // size and modification time of the source the cache was built from
+        int64_t  sourceTime;
+        uint64_t vertexOffset;  // byte offsets from the start of the file, 16 byte aligned
+        uint64_t indexOffset;
+        uint64_t lodOffset;     // lodCount MeshLods, the first one is the full mesh
+        uint64_t meshletOffset;
+    };
+
+    // A validated cache file kept mapped while the arrays are in use
+    struct View {
+        std::unique_ptr<MappedFile> file;
+        const Header *header = nullptr;
+        const Vertex *vertices = nullptr;
+        const unsigned int *indices = nullptr;
+        const MeshLod *lods = nullptr;
+        const Meshlet *meshlets = nullptr;
+    };
+
+    // bunny.obj -> bunny.srmesh next to the source
+    std::string CachePath(const std::string &sourcePath);
+
+    // Maps cachePath and checks it against the current source file. Returns false when the cache
+    // is missing, from another version or stale, in which case the source has to be loaded.
+    bool Load(const std::string &cachePath, const std::string &sourcePath, View &view);
+
+    // Reads the bounds from the header alone, e.g. to draw something before the mesh is loaded
+    bool ReadBounds(const std::string &cachePath, AABB &bounds);
+
+    bool Write(const std::string &cachePath, const std::string &sourcePath,
+               const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+               const std::vector<MeshLod> &lods, const std::vector<Meshlet> &meshlets, const AABB &bounds, bool hasNormals, bool hasUVs);
+}
+
+#endif
@@ -0,0 +1,405 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "AssetPack.h"
+#include "CookedAssets.h"
+#include "MeshCache.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'M', 'Z' };
+
+    // vertices are coded in blocks of 16, one group of 16 bytes per byte of PackedVertex
+    const size_t BLOCK_VERTICES = 16;
+    const size_t PLANES = sizeof(VertexFormat::PackedVertex);
+    const size_t WORDS = PLANES / 2;
+    const size_t BLOCK_HEADER_BYTES = PLANES / 4;   // 2 bit selector per plane
+    const int SELECTOR_BITS[4] = { 0, 2, 4, 8 };
+
+    uint16_t ZigZag16(uint16_t delta) {
+        return (uint16_t)((delta << 1) ^ (uint16_t)((int16_t)delta >> 15));
+    }
+
+    // bytes a group of 16 values takes with selector
+    size_t GroupBytes(int selector) {
+        return SELECTOR_BITS[selector] * BLOCK_VERTICES / 8;
+    }
+
+#ifdef MESH_CODEC_SSE2
+    __m128i DecodeGroupSSE2(int selector, const unsigned char *data) {
+        switch (selector) {
+            case 0:
+                return _mm_setzero_si128();
+            case 1: {
+                int word;
+                memcpy(&word, data, 4);
+                __m128i packed = _mm_cvtsi32_si128(word);
+                __m128i mask = _mm_set1_epi8(3);
+                __m128i a = _mm_and_si128(packed, mask);
+                __m128i b = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+                __m128i c = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+                __m128i d = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+                return _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+            }
+            case 2: {
+                __m128i packed = _mm_loadl_epi64((const __m128i*)data);
+                __m128i mask = _mm_set1_epi8(15);
+                __m128i low = _mm_and_si128(packed, mask);
+                __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+                return _mm_unpacklo_epi8(low, high);
+            }
+            default:
+                return _mm_loadu_si128((const __m128i*)data);
+        }
+    }
+
+    // rows[p] holds byte p of 16 vertices, out[v] receives the 16 bytes of vertex v
+    void Transpose16x16(const __m128i rows[16], __m128i out[16]) {
+        __m128i b[16], c[16];
+        for (int i = 0; i < 8; i++) {
+            b[i] = _mm_unpacklo_epi8(rows[2 * i], rows[2 * i + 1]);
+            b[8 + i] = _mm_unpackhi_epi8(rows[2 * i], rows[2 * i + 1]);
+        }
+        for (int g = 0; g < 16; g += 8) {
+            for (int i = 0; i < 4; i++) {
+                c[g + i] = _mm_unpacklo_epi16(b[g + 2 * i], b[g + 2 * i + 1]);
+                c[g + 4 + i] = _mm_unpackhi_epi16(b[g + 2 * i], b[g + 2 * i + 1]);
+            }
+        }
+        for (int q = 0; q < 16; q += 4) {
+            __m128i low01 = _mm_unpacklo_epi32(c[q], c[q + 1]);
+            __m128i high01 = _mm_unpackhi_epi32(c[q], c[q + 1]);
+            __m128i low23 = _mm_unpacklo_epi32(c[q + 2], c[q + 3]);
+            __m128i high23 = _mm_unpackhi_epi32(c[q + 2], c[q + 3]);
+            out[q] = _mm_unpacklo_epi64(low01, low23);
+            out[q + 1] = _mm_unpackhi_epi64(low01, low23);
+            out[q + 2] = _mm_unpacklo_epi64(high01, high23);
+            out[q + 3] = _mm_unpackhi_epi64(high01, high23);
+        }
+    }
+#else
+    uint16_t UnZigZag16(uint16_t value) {
+        return (uint16_t)((value >> 1) ^ (uint16_t)-(int16_t)(value & 1));
+    }
+
+    void DecodeGroup(int selector, const unsigned char *data, unsigned char values[16]) {
+        switch (selector) {
+            case 0:
+                memset(values, 0, 16);
+                break;
+            case 1:
+                for (int i = 0; i < 16; i++) values[i] = (data[i / 4] >> ((i % 4) * 2)) & 3;
+                break;
+            case 2:
+                for (int i = 0; i < 16; i++) values[i] = (data[i / 2] >> ((i % 2) * 4)) & 15;
+                break;
+            default:
+                memcpy(values, data, 16);
+                break;
+        }
+    }
+#endif
+}
+
+std::string MeshCodec::CachePath(const std::string &sourcePath) {
+    return fs::path(sourcePath).replace_extension(".srmz").string();
+}
+
+void MeshCodec::EncodeVertices(const VertexFormat::PackedVertex *vertices, size_t count, std::vector<unsigned char> &out) {
+    uint16_t previous[WORDS] = {};
+    for (size_t block = 0; block < count; block += BLOCK_VERTICES) {
+        // zigzagged deltas, plane by plane. The tail of the last block repeats the previous vertex.
+        unsigned char planes[PLANES][BLOCK_VERTICES];
+        for (size_t v = 0; v < BLOCK_VERTICES; v++) {
+            uint16_t words[WORDS];
+            if (block + v < count) memcpy(words, &vertices[block + v], sizeof(words));
+            else memcpy(words, previous, sizeof(words));
+
+            for (size_t w = 0; w < WORDS; w++) {
+                uint16_t value = ZigZag16((uint16_t)(words[w] - previous[w]));
+                previous[w] = words[w];
+                planes[w * 2][v] = (unsigned char)(value & 0xff);
+                planes[w * 2 + 1][v] = (unsigned char)(value >> 8);
+            }
+        }
+
+        // narrowest selector per plane
+        size_t headerAt = out.size();
+        out.resize(out.size() + BLOCK_HEADER_BYTES, 0);
+        for (size_t p = 0; p < PLANES; p++) {
+            unsigned char largest = 0;
+            for (size_t v = 0; v < BLOCK_VERTICES; v++) largest = std::max(largest, planes[p][v]);
+            int selector = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+            out[headerAt + p / 4] |= (unsigned char)(selector << ((p % 4) * 2));
+
+            size_t at = out.size();
+            out.resize(at + GroupBytes(selector), 0);
+            for (size_t v = 0; v < BLOCK_VERTICES; v++) {
+                if (selector == 1) out[at + v / 4] |= (unsigned char)(planes[p][v] << ((v % 4) * 2));
+                else if (selector == 2) out[at + v / 2] |= (unsigned char)(planes[p][v] << ((v % 2) * 4));
+                else if (selector == 3) out[at + v] = planes[p][v];
+            }
+        }
+    }
+}
+
+bool MeshCodec::DecodeVertices(const unsigned char *data, size_t size, VertexFormat::PackedVertex *out, size_t count) {
+    const unsigned char *end = data + size;
+
+#ifdef MESH_CODEC_SSE2
+    __m128i previous = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi16(1);
+    for (size_t block = 0; block < count; block += BLOCK_VERTICES) {
+        if ((size_t)(end - data) < BLOCK_HEADER_BYTES) return false;
+        const unsigned char *header = data;
+        data += BLOCK_HEADER_BYTES;
+
+        __m128i rows[PLANES], deltas[BLOCK_VERTICES];
+        for (size_t p = 0; p < PLANES; p++) {
+            int selector = (header[p / 4] >> ((p % 4) * 2)) & 3;
+            size_t bytes = GroupBytes(selector);
+            if ((size_t)(end - data) < bytes) return false;
+            rows[p] = DecodeGroupSSE2(selector, data);
+            data += bytes;
+        }
+        Transpose16x16(rows, deltas);
+
+        size_t blockCount = std::min(BLOCK_VERTICES, count - block);
+        for (size_t v = 0; v < blockCount; v++) {
+            __m128i zigzag = deltas[v];
+            __m128i delta = _mm_xor_si128(_mm_srli_epi16(zigzag, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+            previous = _mm_add_epi16(previous, delta);
+            _mm_storeu_si128((__m128i*)&out[block + v], previous);
+        }
+    }
+#else
+    uint16_t previous[WORDS] = {};
+    for (size_t block = 0; block < count; block += BLOCK_VERTICES) {
+        if ((size_t)(end - data) < BLOCK_HEADER_BYTES) return false;
+        const unsigned char *header = data;
+        data += BLOCK_HEADER_BYTES;
+
+        unsigned char planes[PLANES][BLOCK_VERTICES];
+        for (size_t p = 0; p < PLANES; p++) {
+            int selector = (header[p / 4] >> ((p % 4) * 2)) & 3;
+            size_t bytes = GroupBytes(selector);
+            if ((size_t)(end - data) < bytes) return false;
+            DecodeGroup(selector, data, planes[p]);
+            data += bytes;
+        }
+
+        size_t blockCount = std::min(BLOCK_VERTICES, count - block);
+        for (size_t v = 0; v < blockCount; v++) {
+            uint16_t words[WORDS];
+            for (size_t w = 0; w < WORDS; w++) {
+                uint16_t value = (uint16_t)(planes[w * 2][v] | (planes[w * 2 + 1][v] << 8));
+                previous[w] = (uint16_t)(previous[w] + UnZigZag16(value));
+                words[w] = previous[w];
+            }
+            memcpy(&out[block + v], words, sizeof(words));
+        }
+    }
+#endif
+    return true;
+}
+
+void MeshCodec::EncodeIndices(const unsigned int *indices, size_t count, std::vector<unsigned char> &out) {
+    unsigned int previous = 0;
+    for (size_t group = 0; group < count; group += 4) {
+        size_t control = out.size();
+        out.push_back(0);
+        for (size_t i = group; i < std::min(group + 4, count); i++) {
+            int32_t delta = (int32_t)(indices[i] - previous);
+            uint32_t value = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+            previous = indices[i];
+
+            int bytes = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+            out[control] |= (unsigned char)((bytes - 1) << ((i - group) * 2));
+            for (int b = 0; b < bytes; b++) out.push_back((unsigned char)(value >> (b * 8)));
+        }
+    }
+}
+
+bool MeshCodec::DecodeIndices(const unsigned char *data, size_t size, unsigned int *out, size_t count) {
+    static const uint32_t MASKS[4] = { 0xffu, 0xffffu, 0xffffffu, 0xffffffffu };
+
+    const unsigned char *end = data + size;
+    unsigned int previous = 0;
+    size_t i = 0;
+
+    // whole groups with room for a 4 byte load at every value, no branches on the lengths
+    while (count - i >= 4 && end - data >= 17) {
+        unsigned int control = *data++;
+        for (int k = 0; k < 4; k++) {
+            int length = (control >> (k * 2)) & 3;
+            uint32_t value;
+            memcpy(&value, data, 4);
+            value &= MASKS[length];
+            data += length + 1;
+
+            previous += (value >> 1) ^ (0u - (value & 1));
+            out[i++] = previous;
+        }
+    }
+
+    // the last few groups byte by byte
+    while (i < count) {
+        if (data == end) return false;
+        unsigned int control = *data++;
+        for (int k = 0; k < 4 && i < count; k++) {
+            int length = ((control >> (k * 2)) & 3) + 1;
+            if (end - data < length) return false;
+            uint32_t value = 0;
+            for (int b = 0; b < length; b++) value |= (uint32_t)data[b] << (b * 8);
+            data += length;
+
+            previous += (value >> 1) ^ (0u - (value & 1));
+            out[i++] = previous;
+        }
+    }
+    return true;
+}
+
+bool MeshCodec::ReadBounds(const std::string &path, AABB &bounds) {
+    std::unique_ptr<MappedFile> file = AssetPack::Map(path);
+    if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, file->Data(), sizeof(Header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+
+    memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+    return true;
+}
+
+bool MeshCodec::Read(const std::string &path, const std::string &sourcePath, Decoded &mesh) {
+    std::unique_ptr<MappedFile> file = AssetPack::Map(path);
+    if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, file->Data(), sizeof(Header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (CookedAssets::GetStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != header.sourceSize || sourceTime != header.sourceTime)) return false;
+
+    uint64_t lodBytes = (uint64_t)header.lodCount * sizeof(MeshLod);
+    uint64_t meshletBytes = (uint64_t)header.meshletCount * sizeof(Meshlet);
+    if (sizeof(Header) + header.vertexBytes + header.indexBytes + lodBytes + meshletBytes > file->Size()) {
+        std::cout << "ERROR::MESH_CODEC::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    // Unpack and the shaders only know the packed layouts
+    if (header.layout != (uint32_t)VertexFormat::Layout::Packed && header.layout != (uint32_t)VertexFormat::Layout::PackedUnormUV) {
+        std::cout << "ERROR::MESH_CODEC::CORRUPT " << path << std::endl;
+        return false;
+    }
+
+    const unsigned char *data = file->Data() + sizeof(Header);
+    mesh.vertices.resize(header.vertexCount);
+    mesh.indices.resize(header.indexCount);
+    if (!DecodeVertices(data, header.vertexBytes, mesh.vertices.data(), header.vertexCount) ||
+        !DecodeIndices(data + header.vertexBytes, header.indexBytes, mesh.indices.data(), header.indexCount)) {
+        std::cout << "ERROR::MESH_CODEC::CORRUPT " << path << std::endl;
+        return false;
+    }
+    data += header.vertexBytes + header.indexBytes;
+
+    mesh.lods.resize(header.lodCount);
+    memcpy(mesh.lods.data(), data, lodBytes);
+    mesh.meshlets.resize(header.meshletCount);
+    memcpy(mesh.meshlets.data(), data + lodBytes, meshletBytes);
+
+    for (unsigned int index : mesh.indices) {
+        if (index >= header.vertexCount) {
+            std::cout << "ERROR::MESH_CODEC::CORRUPT " << path << std::endl;
+            return false;
+        }
+    }
+    for (const MeshLod &lod : mesh.lods) {
+        if ((uint64_t)lod.indexOffset + lod.indexCount > header.indexCount ||
+            (uint64_t)lod.meshletOffset + lod.meshletCount > header.meshletCount) {
+            std::cout << "ERROR::MESH_CODEC::BAD_LOD " << path << std::endl;
+            return false;
+        }
+        // DrawVisible hands these ranges straight to GL
+        for (uint32_t i = lod.meshletOffset; i < lod.meshletOffset + lod.meshletCount; i++) {
+            const Meshlet &meshlet = mesh.meshlets[i];
+            if (meshlet.indexOffset < lod.indexOffset || (uint64_t)meshlet.indexOffset + meshlet.indexCount > (uint64_t)lod.indexOffset + lod.indexCount) {
+                std::cout << "ERROR::MESH_CODEC::BAD_MESHLET " << path << std::endl;
+                return false;
+            }
+        }
+    }
+
+    mesh.layout = (VertexFormat::Layout)header.layout;
+    memcpy(&mesh.bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&mesh.bounds.max, header.boundsMax, sizeof(header.boundsMax));
+    memcpy(&mesh.dequantization.positionOffset, header.positionOffset, sizeof(header.positionOffset));
+    memcpy(&mesh.dequantization.positionScale, header.positionScale, sizeof(header.positionScale));
+    memcpy(&mesh.dequantization.uvOffset, header.uvOffset, sizeof(header.uvOffset));
+    memcpy(&mesh.dequantization.uvScale, header.uvScale, sizeof(header.uvScale));
+    mesh.hasNormals = (header.flags & MeshCache::FLAG_NORMALS) != 0;
+    mesh.hasUVs = (header.flags & MeshCache::FLAG_UVS) != 0;
+    mesh.dequantization.octNormals = mesh.hasNormals;
+    return true;
+}
+
+bool MeshCodec::Write(const std::string &path, const std::string &sourcePath, const Vertex *vertices, size_t vertexCount,
+                      const unsigned int *indices, size_t indexCount, const std::vector<MeshLod> &lods,
+                      const std::vector<Meshlet> &meshlets, const AABB &bounds, bool hasNormals, bool hasUVs,
+                      VertexFormat::Layout layout) {
+    if (layout == VertexFormat::Layout::Float) return false;
+
+    VertexFormat::Dequantization dequantization = VertexFormat::ComputeDequantization(layout, vertices, vertexCount, bounds);
+    std::vector<VertexFormat::PackedVertex> packed(vertexCount);
+    VertexFormat::Pack(vertices, vertexCount, dequantization, layout, packed.data());
+
+    std::vector<unsigned char> vertexStream, indexStream;
+    EncodeVertices(packed.data(), packed.size(), vertexStream);
+    EncodeIndices(indices, indexCount, indexStream);
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (hasNormals ? MeshCache::FLAG_NORMALS : 0) | (hasUVs ? MeshCache::FLAG_UVS : 0);
+    header.layout = (uint32_t)layout;
+    header.vertexCount = (uint32_t)vertexCount;
+    header.indexCount = (uint32_t)indexCount;
+    header.lodCount = (uint32_t)lods.size();
+    header.meshletCount = (uint32_t)meshlets.size();
+    memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+    memcpy(header.positionOffset, &dequantization.positionOffset, sizeof(header.positionOffset));
+    memcpy(header.positionScale, &dequantization.positionScale, sizeof(header.positionScale));
+    memcpy(header.uvOffset, &dequantization.uvOffset, sizeof(header.uvOffset));
+    memcpy(header.uvScale, &dequantization.uvScale, sizeof(header.uvScale));
+    if (!CookedAssets::GetStamp(sourcePath, header.sourceSize, header.sourceTime)) return false;
+    header.vertexBytes = vertexStream.size();
+    header.indexBytes = indexStream.size();
+
+    bool written = WriteFileAtomically(path, [&](std::ofstream &out) {
+        out.write((const char*)&header, sizeof(Header));
+        out.write((const char*)vertexStream.data(), vertexStream.size());
+        out.write((const char*)indexStream.data(), indexStream.size());
+        out.write((const char*)lods.data(), lods.size() * sizeof(MeshLod));
+        out.write((const char*)meshlets.data(), meshlets.size() * sizeof(Meshlet));
+        return true;
+    });
+    if (!written) std::cout << "ERROR::MESH_CODEC::WRITE_FAILED " << path << std::endl;
+    return written;
+}
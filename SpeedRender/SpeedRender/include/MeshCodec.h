@@ -0,0 +1,77 @@
+#ifndef MESH_CODEC_H
+#define MESH_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "VertexFormat.h"
+
+// Compressed meshes for when loading is bound by disk I/O rather than parsing. .srmz files hold the same
+// data as a .srmesh cache, with the vertices packed (see VertexFormat) and both buffers compressed:
+//  - vertices are delta coded per 16 bit word against the previous vertex, zigzag mapped and split into
+//    byte planes, each group of 16 bytes stored with 0, 2, 4 or 8 bits per byte
+//  - indices are delta coded against the previous index, zigzag mapped and written in groups of four
+//    behind a control byte holding each one's length in bytes
+// The vertex stream decodes straight into the buffer that goes to glBufferData.
+namespace MeshCodec {
+    const uint32_t VERSION = 1;
+
+    struct Header {
+        char     magic[4];      // "SRMZ"
+        uint32_t version;
+        uint32_t flags;         // MeshCache::FLAG_*
+        uint32_t layout;        // VertexFormat::Layout of the packed vertices
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        float    boundsMin[3];
+        float    boundsMax[3];
+        float    positionOffset[3];
+        float    positionScale[3];
+        float    uvOffset[2];
+        float    uvScale[2];
+        uint64_t sourceSize;    // of the source the file was built from, as in MeshCache
+        int64_t  sourceTime;
+        uint64_t vertexBytes;   // the encoded streams follow the header in this order, then the raw lods and meshlets
+        uint64_t indexBytes;
+    };
+
+    // A decoded .srmz
+    struct Decoded {
+        VertexFormat::Layout layout = VertexFormat::Layout::Packed;
+        VertexFormat::Dequantization dequantization;
+        std::vector<VertexFormat::PackedVertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<MeshLod> lods;
+        std::vector<Meshlet> meshlets;
+        AABB bounds;
+        bool hasNormals = false;
+        bool hasUVs = false;
+    };
+
+    // bunny.obj -> bunny.srmz next to the source
+    std::string CachePath(const std::string &sourcePath);
+
+    // Decodes path, false if it is missing, from another version, stale against sourcePath or corrupt
+    bool Read(const std::string &path, const std::string &sourcePath, Decoded &mesh);
+
+    // Reads the bounds from the header alone, e.g. to draw something before the mesh is loaded
+    bool ReadBounds(const std::string &path, AABB &bounds);
+
+    // Packs vertices in layout (Packed or PackedUnormUV) and writes the compressed file
+    bool Write(const std::string &path, const std::string &sourcePath, const Vertex *vertices, size_t vertexCount,
+               const unsigned int *indices, size_t indexCount, const std::vector<MeshLod> &lods,
+               const std::vector<Meshlet> &meshlets, const AABB &bounds, bool hasNormals, bool hasUVs,
+               VertexFormat::Layout layout = VertexFormat::Layout::Packed);
+
+    // The two streams on their own. Decoders return false instead of reading past the end of data.
+    void EncodeVertices(const VertexFormat::PackedVertex *vertices, size_t count, std::vector<unsigned char> &out);
+    bool DecodeVertices(const unsigned char *data, size_t size, VertexFormat::PackedVertex *out, size_t count);
+    void EncodeIndices(const unsigned int *indices, size_t count, std::vector<unsigned char> &out);
+    bool DecodeIndices(const unsigned char *data, size_t size, unsigned int *out, size_t count);
+}
+
+#endif
@@ -0,0 +1,713 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <unordered_set>
+
+namespace {
+    const unsigned int EMPTY_SLOT = ~0u;
+    const int FORSYTH_CACHE_SIZE = 32;
+    const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+    // -0.0 and 0.0 compare equal but hash differently, so fold them before welding
+    Vertex Canonicalize(const Vertex &v) {
+        return {
+            v.position + glm::vec3(0.0f),
+            v.normal + glm::vec3(0.0f),
+            v.texCoords + glm::vec2(0.0f)
+        };
+    }
+
+    uint32_t HashVertex(const Vertex &v) {
+        uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+        memcpy(words, &v, sizeof(Vertex));
+
+        // murmur3 style mixing of each 32 bit word
+        uint32_t h = 0x9747b28c;
+        for (uint32_t k : words) {
+            k *= 0xcc9e2d51;
+            k = (k << 15) | (k >> 17);
+            k *= 0x1b873593;
+            h ^= k;
+            h = (h << 13) | (h >> 19);
+            h = h * 5 + 0xe6546b64;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        return h;
+    }
+
+    float ForsythScore(int cachePosition, unsigned int remainingTriangles) {
+        if (remainingTriangles == 0) return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 3) {
+            score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+        } else if (cachePosition >= 0) {
+            // the last triangle's vertices get a fixed score so its neighbours are not favoured over a strip
+            score = 0.75f;
+        }
+
+        // boost vertices with few triangles left so they get finished off instead of lingering
+        return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+    }
+
+    // FIFO post-transform cache, returns true on a miss
+    struct FifoCache {
+        std::vector<unsigned int> timestamps;
+        unsigned int time;
+        unsigned int size;
+
+        FifoCache(size_t vertexCount, unsigned int size) : timestamps(vertexCount, 0), time(size + 1), size(size) {}
+
+        bool Access(unsigned int v) {
+            if (time - timestamps[v] > size) {
+                timestamps[v] = time++;
+                return true;
+            }
+            return false;
+        }
+        void Reset() { time += size + 1; }
+    };
+
+    // Garland & Heckbert plane quadric, error(p) = p^T A p + 2 b.p + c summed over area weighted planes.
+    // Doubles because c and the A terms cancel out badly in float for meshes away from the origin.
+    struct Quadric {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+        double weight = 0.0;
+
+        void AddPlane(const glm::dvec3 &n, double d, double w) {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric &q) {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+            weight += q.weight;
+        }
+
+        double Evaluate(const glm::vec3 &p) const {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                     + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::abs(e);
+        }
+    };
+
+    // Half edge collapses driven by quadric error, the collapsed vertex moves onto its neighbour so the
+    // result always indexes the original vertices. The state carries over between Run calls, which lets
+    // a whole LOD chain come out of one pass over the mesh with errors measured against the original.
+    class Simplifier {
+    public:
+        std::vector<unsigned int> indices;
+
+        Simplifier(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+            : indices(indices), vertices(vertices), remap(vertices.size()), locked(vertices.size(), false),
+              quadrics(vertices.size()), collapseTo(vertices.size()) {
+            // vertices split by UV or normal seams share a position, simplify the positions
+            std::vector<unsigned int> order(vertices.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = (unsigned int)i;
+            auto less = [&](unsigned int a, unsigned int b) {
+                const glm::vec3 &pa = vertices[a].position, &pb = vertices[b].position;
+                if (pa.x != pb.x) return pa.x < pb.x;
+                if (pa.y != pb.y) return pa.y < pb.y;
+                return pa.z < pb.z;
+            };
+            std::sort(order.begin(), order.end(), less);
+            for (size_t i = 0; i < order.size(); i++) {
+                bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+                remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+                // a second vertex on the same position is a seam, moving either would tear it open
+                if (same) locked[remap[order[i]]] = true;
+            }
+
+            // open borders stay where they are too, an edge is on the border if no triangle has it reversed
+            std::unordered_set<uint64_t> edges;
+            auto edgeKey = [](unsigned int a, unsigned int b) { return ((uint64_t)a << 32) | b; };
+            for (size_t i = 0; i < indices.size(); i += 3)
+                for (int e = 0; e < 3; e++)
+                    edges.insert(edgeKey(remap[indices[i + e]], remap[indices[i + (e + 1) % 3]]));
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int e = 0; e < 3; e++) {
+                    unsigned int a = remap[indices[i + e]], b = remap[indices[i + (e + 1) % 3]];
+                    if (!edges.count(edgeKey(b, a))) locked[a] = locked[b] = true;
+                }
+            }
+
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                glm::dvec3 p0 = vertices[indices[i]].position, p1 = vertices[indices[i + 1]].position, p2 = vertices[indices[i + 2]].position;
+                glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+                double doubleArea = glm::length(normal);
+                if (doubleArea <= 0.0) continue;
+                normal /= doubleArea;
+                for (int k = 0; k < 3; k++)
+                    quadrics[remap[indices[i + k]]].AddPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+            }
+
+            for (size_t i = 0; i < collapseTo.size(); i++) collapseTo[i] = (unsigned int)i;
+        }
+
+        // Collapses until at most targetIndexCount indices are left or the next collapse would move the
+        // surface by more than maxError. Returns the error reached so far, in model units.
+        float Run(size_t targetIndexCount, float maxError) {
+            double maxCost = (double)maxError * maxError;
+
+            while (indices.size() > targetIndexCount) {
+                // every directed edge whose start vertex may move, cheapest first
+                std::vector<Collapse> collapses;
+                collapses.reserve(indices.size() * 2);
+                for (size_t i = 0; i < indices.size(); i += 3) {
+                    for (int e = 0; e < 3; e++) {
+                        unsigned int a = indices[i + e], b = indices[i + (e + 1) % 3];
+                        if (!locked[remap[a]]) collapses.push_back({ a, b, Cost(a, b) });
+                        if (!locked[remap[b]]) collapses.push_back({ b, a, Cost(b, a) });
+                    }
+                }
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+                BuildAdjacency();
+
+                // a collapse locks the ring around it for the rest of the pass, so the flip checks see current positions
+                std::vector<bool> touched(vertices.size(), false);
+                size_t triangleCount = indices.size() / 3, targetTriangles = targetIndexCount / 3;
+                size_t applied = 0;
+                for (const Collapse &collapse : collapses) {
+                    if (triangleCount <= targetTriangles || collapse.cost > maxCost) break;
+
+                    unsigned int from = remap[collapse.from], to = remap[collapse.to];
+                    if (touched[from] || touched[to] || Flips(collapse.from, collapse.to)) continue;
+
+                    collapseTo[collapse.from] = collapse.to;
+                    quadrics[to].Add(quadrics[from]);
+                    for (unsigned int t = adjacencyOffsets[collapse.from]; t < adjacencyOffsets[collapse.from + 1]; t++)
+                        for (int k = 0; k < 3; k++) touched[remap[indices[adjacency[t] * 3 + k]]] = true;
+                    error = std::max(error, collapse.cost);
+                    triangleCount -= SharedTriangles(collapse.from, to);
+                    applied++;
+                }
+                if (applied == 0) break;
+
+                // move the collapsed corners and drop the triangles that became degenerate
+                size_t write = 0;
+                for (size_t i = 0; i < indices.size(); i += 3) {
+                    unsigned int a = collapseTo[indices[i]], b = collapseTo[indices[i + 1]], c = collapseTo[indices[i + 2]];
+                    if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) continue;
+                    indices[write++] = a;
+                    indices[write++] = b;
+                    indices[write++] = c;
+                }
+                indices.resize(write);
+            }
+
+            return (float)std::sqrt(error);
+        }
+
+    private:
+        struct Collapse {
+            unsigned int from, to;
+            double cost;    // mean squared distance to the planes of both vertices
+        };
+
+        const std::vector<Vertex> &vertices;
+        std::vector<unsigned int> remap;    // first vertex with the same position
+        std::vector<bool> locked;           // by position, seams and borders
+        std::vector<Quadric> quadrics;      // by position
+        std::vector<unsigned int> collapseTo;
+        std::vector<unsigned int> adjacencyOffsets, adjacency;  // triangles around each vertex
+        double error = 0.0;
+
+        double Cost(unsigned int from, unsigned int to) const {
+            const Quadric &q0 = quadrics[remap[from]], &q1 = quadrics[remap[to]];
+            double weight = q0.weight + q1.weight;
+            if (weight <= 0.0) return 0.0;
+            const glm::vec3 &p = vertices[to].position;
+            return (q0.Evaluate(p) + q1.Evaluate(p)) / weight;
+        }
+
+        void BuildAdjacency() {
+            adjacencyOffsets.assign(vertices.size() + 1, 0);
+            for (unsigned int index : indices) adjacencyOffsets[index + 1]++;
+            for (size_t i = 1; i < adjacencyOffsets.size(); i++) adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+            adjacency.resize(indices.size());
+            std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+        }
+
+        bool HasPosition(unsigned int triangle, unsigned int position) const {
+            for (int k = 0; k < 3; k++)
+                if (remap[indices[triangle * 3 + k]] == position) return true;
+            return false;
+        }
+
+        size_t SharedTriangles(unsigned int from, unsigned int toPosition) const {
+            size_t count = 0;
+            for (unsigned int t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; t++)
+                if (HasPosition(adjacency[t], toPosition)) count++;
+            return count;
+        }
+
+        // true if moving from onto to turns any surviving triangle around from over or makes it degenerate
+        bool Flips(unsigned int from, unsigned int to) const {
+            const glm::vec3 &target = vertices[to].position;
+            for (unsigned int t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; t++) {
+                unsigned int triangle = adjacency[t];
+                if (HasPosition(triangle, remap[to])) continue;
+
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    unsigned int index = indices[triangle * 3 + k];
+                    p[k] = vertices[index].position;
+                    q[k] = index == from ? target : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                // small rotations add up over many collapses, so anything past ~75 degrees counts as a flip
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) return true;
+            }
+            return false;
+        }
+    };
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize) {
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, uniqueVertices = 0;
+
+    for (unsigned int index : indices) {
+        if (cache.Access(index)) misses++;
+        if (!used[index]) {
+            used[index] = true;
+            uniqueVertices++;
+        }
+    }
+
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indices.size() >= 3) stats.acmr = (float)misses / (indices.size() / 3);
+    if (uniqueVertices > 0) stats.atvr = (float)misses / uniqueVertices;
+    return stats;
+}
+
+size_t MeshOptimizer::WeldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must not contain padding to be hashed bytewise");
+
+    // open addressing table of indices into the welded pool, kept at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertices.size() * 2) tableSize *= 2;
+    std::vector<unsigned int> table(tableSize, EMPTY_SLOT);
+
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    std::vector<unsigned int> remap(vertices.size(), EMPTY_SLOT);
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        Vertex v = Canonicalize(vertices[i]);
+        size_t slot = HashVertex(v) & (tableSize - 1);
+
+        while (table[slot] != EMPTY_SLOT && memcmp(&welded[table[slot]], &v, sizeof(Vertex)) != 0)
+            slot = (slot + 1) & (tableSize - 1); // linear probe
+
+        if (table[slot] == EMPTY_SLOT) {
+            table[slot] = (unsigned int)welded.size();
+            welded.push_back(v);
+        }
+        remap[i] = table[slot];
+    }
+
+    for (unsigned int &index : indices)
+        index = remap[index];
+
+    welded.shrink_to_fit();
+    vertices.swap(welded);
+    return vertices.size();
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // vertex -> triangle adjacency, packed per vertex
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices) remaining[index]++;
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = ForsythScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t scanPosition = 0;
+    long long best = 0;
+    while (best >= 0) {
+        const unsigned int *tri = &indices[best * 3];
+        emitted[best] = true;
+        result.insert(result.end(), tri, tri + 3);
+
+        // detach the triangle from its vertices
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = tri[k];
+            unsigned int *list = &adjacency[offsets[v]];
+            unsigned int *end = list + remaining[v];
+            unsigned int *it = std::find(list, end, (unsigned int)best);
+            if (it != end) {
+                std::swap(*it, *(end - 1));
+                remaining[v]--;
+            }
+        }
+
+        // the triangle's vertices move to the front of the LRU cache
+        nextCache.clear();
+        for (int k = 0; k < 3; k++)
+            if (std::find(nextCache.begin(), nextCache.end(), tri[k]) == nextCache.end()) nextCache.push_back(tri[k]);
+        for (unsigned int v : cache)
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+
+        // rescore everything that moved, including vertices that just fell out of the cache
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            unsigned int v = nextCache[i];
+            float score = ForsythScore(i < FORSYTH_CACHE_SIZE ? (int)i : -1, remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            for (unsigned int j = offsets[v]; j < offsets[v] + remaining[v]; j++)
+                triangleScore[adjacency[j]] += delta;
+        }
+
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) nextCache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        // next triangle is the best one touching the cache
+        best = -1;
+        float bestScore = 0.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int j = offsets[v]; j < offsets[v] + remaining[v]; j++) {
+                unsigned int t = adjacency[j];
+                if (best < 0 || triangleScore[t] > bestScore) {
+                    best = t;
+                    bestScore = triangleScore[t];
+                }
+            }
+        }
+
+        // dead end, restart from the next triangle that hasn't been emitted yet
+        if (best < 0) {
+            while (scanPosition < triangleCount && emitted[scanPosition]) scanPosition++;
+            if (scanPosition < triangleCount) best = (long long)scanPosition;
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    float meshAcmr = AnalyzeVertexCache(indices, vertices.size(), OVERDRAW_CACHE_SIZE).acmr;
+
+    // cluster boundaries: hard ones where the cache optimizer restarted (all three vertices miss),
+    // soft ones once a cluster has amortized its cold cache cost down to threshold * meshAcmr
+    std::vector<size_t> clusters;
+    FifoCache cache(vertices.size(), OVERDRAW_CACHE_SIZE);
+    size_t clusterStart = 0, clusterMisses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++) misses += cache.Access(indices[t * 3 + k]);
+
+        bool hardBoundary = misses == 3;
+        bool softBoundary = t > clusterStart && (float)clusterMisses / (t - clusterStart) <= threshold * meshAcmr;
+
+        if (t == 0 || hardBoundary || softBoundary) {
+            clusters.push_back(t);
+            clusterStart = t;
+            clusterMisses = 0;
+
+            // every cluster has to stand on its own once reordered, so measure it from a cold cache
+            if (!hardBoundary) {
+                cache.Reset();
+                misses = 0;
+                for (int k = 0; k < 3; k++) misses += cache.Access(indices[t * 3 + k]);
+            }
+        }
+        clusterMisses += misses;
+    }
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCentroid(0.0f);
+    for (const Vertex &v : vertices) meshCentroid += v.position;
+    meshCentroid /= (float)std::max<size_t>(vertices.size(), 1);
+
+    // clusters that face away from the mesh center occlude the rest, draw them first
+    std::vector<float> sortKeys(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3 &p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        if (area > 0.0f) centroid /= area;
+        float normalLength = glm::length(normal);
+        sortKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<unsigned int> order(sortKeys.size());
+    for (size_t c = 0; c < order.size(); c++) order[c] = (unsigned int)c;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    std::vector<unsigned int> remap(vertices.size(), EMPTY_SLOT);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (unsigned int &index : indices) {
+        if (remap[index] == EMPTY_SLOT) {
+            remap[index] = (unsigned int)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+float MeshOptimizer::Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, size_t targetIndexCount,
+                              std::vector<unsigned int> &result, float maxError) {
+    Simplifier simplifier(vertices, indices);
+    float error = simplifier.Run(targetIndexCount, maxError);
+    result.swap(simplifier.indices);
+    return error;
+}
+
+void MeshOptimizer::GenerateLods(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<MeshLod> &lods) {
+    const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+
+    lods.clear();
+    lods.push_back({ 0, (uint32_t)indices.size(), 0.0f, 0, 0 });
+
+    size_t fullIndexCount = indices.size();
+    Simplifier simplifier(vertices, indices);
+    for (float ratio : LOD_RATIOS) {
+        size_t target = (size_t)(fullIndexCount / 3 * ratio) * 3;
+        float error = simplifier.Run(target, FLT_MAX);
+
+        // locked seams can stall the simplifier, a level that barely shrank is not worth its memory
+        const MeshLod &previous = lods.back();
+        if (simplifier.indices.empty() || simplifier.indices.size() > previous.indexCount * 0.8f) break;
+
+        std::vector<unsigned int> lod = simplifier.indices;
+        OptimizeVertexCache(lod, vertices.size());
+        lods.push_back({ (uint32_t)indices.size(), (uint32_t)lod.size(), error, 0, 0 });
+        indices.insert(indices.end(), lod.begin(), lod.end());
+    }
+}
+
+void MeshOptimizer::BuildMeshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                                  std::vector<MeshLod> &lods, std::vector<Meshlet> &meshlets) {
+    meshlets.clear();
+
+    // finishes the meshlet made of the triangles in [begin, end) of indices
+    auto finish = [&](uint32_t begin, uint32_t end) {
+        Meshlet meshlet = {};
+        meshlet.indexOffset = begin;
+        meshlet.indexCount = end - begin;
+
+        // bounding sphere around the center of the box, good enough for clusters this small
+        glm::vec3 boundsMin = vertices[indices[begin]].position, boundsMax = boundsMin;
+        for (uint32_t i = begin; i < end; i++) {
+            boundsMin = glm::min(boundsMin, vertices[indices[i]].position);
+            boundsMax = glm::max(boundsMax, vertices[indices[i]].position);
+        }
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        for (uint32_t i = begin; i < end; i++)
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+
+        // the cone of face normals, widened by 90 degrees into the cone of directions the faces can't be seen from
+        glm::vec3 axis(0.0f);
+        for (uint32_t i = begin; i < end; i += 3) {
+            const glm::vec3 &p0 = vertices[indices[i]].position, &p1 = vertices[indices[i + 1]].position, &p2 = vertices[indices[i + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f) axis += normal / length;
+        }
+        float axisLength = glm::length(axis);
+        float minDot = -1.0f;
+        if (axisLength > 0.0f) {
+            axis /= axisLength;
+            minDot = 1.0f;
+            for (uint32_t i = begin; i < end; i += 3) {
+                const glm::vec3 &p0 = vertices[indices[i]].position, &p1 = vertices[indices[i + 1]].position, &p2 = vertices[indices[i + 2]].position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float length = glm::length(normal);
+                if (length > 0.0f) minDot = std::min(minDot, glm::dot(axis, normal / length));
+            }
+        }
+
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = minDot > 0.1f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+        meshlets.push_back(meshlet);
+    };
+
+    std::vector<unsigned int> lastUse(vertices.size(), EMPTY_SLOT);
+    unsigned int meshletId = 0;
+    for (MeshLod &lod : lods) {
+        lod.meshletOffset = (uint32_t)meshlets.size();
+        uint32_t begin = lod.indexOffset;
+        size_t triangleCount = lod.indexCount / 3;
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++) {
+            const unsigned int *corner = &indices[begin + t * 3];
+            glm::vec3 normal = glm::cross(vertices[corner[1]].position - vertices[corner[0]].position,
+                                          vertices[corner[2]].position - vertices[corner[0]].position);
+            float length = glm::length(normal);
+            normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        }
+
+        // triangles around each vertex
+        std::vector<unsigned int> offsets(vertices.size() + 1, 0), adjacency(triangleCount * 3);
+        for (size_t i = 0; i < triangleCount * 3; i++) offsets[indices[begin + i] + 1]++;
+        for (size_t v = 1; v < offsets.size(); v++) offsets[v] += offsets[v - 1];
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) adjacency[fill[indices[begin + i]]++] = (unsigned int)(i / 3);
+
+        // Grow each meshlet from the first unused triangle in cache order over its neighbours, preferring
+        // triangles that add no vertices and then those closest to the meshlet's average normal. Compact,
+        // flat meshlets fill the vertex budget better and get tight cones.
+        std::vector<bool> used(triangleCount, false);
+        std::vector<unsigned int> order, candidates, meshletVertices;
+        std::vector<size_t> meshletEnds;
+        order.reserve(triangleCount);
+        size_t seed = 0;
+        while (order.size() < triangleCount) {
+            while (used[seed]) seed++;
+
+            meshletId++;
+            size_t meshletBegin = order.size();
+            meshletVertices.clear();
+            candidates.clear();
+            glm::vec3 normalSum(0.0f);
+
+            unsigned int next = (unsigned int)seed;
+            while (next != EMPTY_SLOT) {
+                used[next] = true;
+                order.push_back(next);
+                normalSum += normals[next];
+                for (int k = 0; k < 3; k++) {
+                    unsigned int v = indices[begin + next * 3 + k];
+                    if (lastUse[v] == meshletId) continue;
+                    lastUse[v] = meshletId;
+                    meshletVertices.push_back(v);
+                    for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++)
+                        if (!used[adjacency[a]]) candidates.push_back(adjacency[a]);
+                }
+                if (order.size() - meshletBegin >= MESHLET_MAX_TRIANGLES) break;
+
+                next = EMPTY_SLOT;
+                int bestNew = 4;
+                float bestDot = -2.0f;
+                size_t write = 0;
+                for (unsigned int candidate : candidates) {
+                    if (used[candidate]) continue;
+                    candidates[write++] = candidate;
+
+                    int newVertices = 0;
+                    for (int k = 0; k < 3; k++)
+                        if (lastUse[indices[begin + candidate * 3 + k]] != meshletId) newVertices++;
+                    if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES) continue;
+
+                    float alignment = glm::dot(normals[candidate], normalSum);
+                    if (newVertices < bestNew || (newVertices == bestNew && alignment > bestDot)) {
+                        next = candidate;
+                        bestNew = newVertices;
+                        bestDot = alignment;
+                    }
+                }
+                candidates.resize(write);
+            }
+
+            // keep the cache order inside the meshlet
+            std::sort(order.begin() + meshletBegin, order.end());
+            meshletEnds.push_back(order.size());
+        }
+
+        std::vector<unsigned int> reordered(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++) reordered[t * 3 + k] = indices[begin + order[t] * 3 + k];
+        std::copy(reordered.begin(), reordered.end(), indices.begin() + begin);
+
+        size_t meshletBegin = 0;
+        for (size_t meshletEnd : meshletEnds) {
+            finish(begin + (uint32_t)meshletBegin * 3, begin + (uint32_t)meshletEnd * 3);
+            meshletBegin = meshletEnd;
+        }
+        lod.meshletCount = (uint32_t)meshlets.size() - lod.meshletOffset;
+    }
+}
+
+void MeshOptimizer::Process(const std::string &name, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                            std::vector<MeshLod> &lods, std::vector<Meshlet> &meshlets, std::ostream &report) {
+    // one vertex per face corner so far, share the duplicates through the index buffer
+    size_t cornerCount = vertices.size();
+    WeldVertices(vertices, indices);
+    report << "Welded " << name << ": " << cornerCount << " -> " << vertices.size() << " vertices" << std::endl;
+
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices);
+    OptimizeVertexFetch(vertices, indices);
+    VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+    report << "Optimized " << name << ": ACMR " << before.acmr << " -> " << after.acmr
+           << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+    GenerateLods(vertices, indices, lods);
+    report << "LODs " << name << ":";
+    for (const MeshLod &lod : lods) report << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+    report << " triangles (error)" << std::endl;
+
+    BuildMeshlets(vertices, indices, lods, meshlets);
+    report << "Meshlets " << name << ": " << meshlets.size() << " over " << lods.size() << " LODs" << std::endl;
+}
@@ -0,0 +1,61 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cfloat>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+namespace MeshOptimizer {
+    struct VertexCacheStats {
+        float acmr; // average cache miss ratio, vertex shader invocations per triangle
+        float atvr; // average transformed vertex ratio, vertex shader invocations per unique vertex
+    };
+
+    // Simulates a FIFO post-transform cache over the index buffer
+    VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+    // Collapses bitwise identical vertices into a shared pool and rewrites indices to point into it.
+    // Returns the number of unique vertices.
+    size_t WeldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+    // Reorders triangles for post-transform cache locality (Tom Forsyth's linear-speed vertex cache optimisation)
+    void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount);
+
+    // Splits a cache optimized index buffer into clusters and sorts them so outward facing clusters are drawn first.
+    // threshold bounds how much ACMR the extra cluster boundaries may cost, 1.05 allows 5%.
+    void OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, float threshold = 1.05f);
+
+    // Renumbers vertices in order of first use so vertex fetch walks memory linearly. Drops unreferenced vertices.
+    void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+    // Quadric error metric simplification (Garland & Heckbert) by half edge collapses, so result indexes the
+    // same vertex buffer. Vertices on UV or normal seams and on open borders never move, which keeps texture
+    // seams and hard edges intact. Stops at targetIndexCount or when the next collapse would move the surface
+    // by more than maxError. Returns the error reached, in model units.
+    float Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, size_t targetIndexCount,
+                   std::vector<unsigned int> &result, float maxError = FLT_MAX);
+
+    // Appends simplified levels with 50, 25, 12.5 and 6.25% of the triangles to indices, each cache optimized
+    // and sharing the vertices, and describes every level including the full mesh in lods. Stops early once
+    // seams keep a level from shrinking.
+    void GenerateLods(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<MeshLod> &lods);
+
+    const size_t MESHLET_MAX_VERTICES = 64;
+    const size_t MESHLET_MAX_TRIANGLES = 124;
+
+    // Cuts every LOD into meshlets for Mesh::DrawVisible and fills in the lods' meshlet ranges. Each LOD's
+    // triangles are regrouped so every meshlet is a contiguous index range, keeping the cache optimized
+    // order inside each meshlet.
+    void BuildMeshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                       std::vector<MeshLod> &lods, std::vector<Meshlet> &meshlets);
+
+    // Everything above in the order models are loaded with: weld, cache, overdraw and fetch optimization, then
+    // the LOD chain and its meshlets. One line per step goes to report, prefixed with name.
+    void Process(const std::string &name, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                 std::vector<MeshLod> &lods, std::vector<Meshlet> &meshlets, std::ostream &report);
+}
+
+#endif
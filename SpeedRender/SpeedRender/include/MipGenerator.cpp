@@ -0,0 +1,177 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "ThreadPool.h"
+
+namespace {
+    // steps of the linear to sRGB table, fine enough for the steep part of the curve near black
+    const int ENCODE_STEPS = 16384;
+
+    // levels smaller than this are filtered on the calling thread
+    const size_t PARALLEL_TEXELS = 128 * 128;
+
+    struct Tables {
+        float decode[2][256];       // [alpha][byte], alpha is only scaled
+        unsigned char encode[ENCODE_STEPS + 1];
+
+        Tables() {
+            for (int i = 0; i < 256; i++) {
+                float value = i / 255.0f;
+                decode[0][i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                decode[1][i] = value;
+            }
+            for (int i = 0; i <= ENCODE_STEPS; i++) {
+                float value = (float)i / ENCODE_STEPS;
+                float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                encode[i] = (unsigned char)std::min(std::max((int)std::lround(encoded * 255.0f), 0), 255);
+            }
+        }
+    };
+
+    const Tables &GetTables() {
+        static const Tables tables;
+        return tables;
+    }
+
+    bool IsAlpha(int channel, int channels) {
+        return (channels == 4 && channel == 3) || (channels == 2 && channel == 1);
+    }
+
+    // One output row from input rows a and b. step is the distance between the two texels averaged
+    // horizontally, 0 when the input is a single column wide.
+    void FilterRow(const unsigned char *a, const unsigned char *b, int width, int outWidth, int channels, size_t step,
+                   unsigned char *out, std::vector<uint16_t> &sums) {
+        size_t count = (size_t)width * channels, outCount = (size_t)outWidth * channels;
+        sums.resize(count);
+
+        size_t i = 0;
+#ifdef MIP_GENERATOR_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i)), y = _mm_loadu_si128((const __m128i*)(b + i));
+            _mm_storeu_si128((__m128i*)(sums.data() + i), _mm_add_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero)));
+            _mm_storeu_si128((__m128i*)(sums.data() + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero)));
+        }
+#endif
+        for (; i < count; i++) sums[i] = (uint16_t)(a[i] + b[i]);
+
+        const uint16_t *s = sums.data();
+        size_t o = 0;
+#ifdef MIP_GENERATOR_SSE2
+        // 8 outputs from 16 sums, neighbouring texels are 64, 32 or 16 bits apart
+        if (step == (size_t)channels && channels != 3) {
+            const __m128i ones = _mm_set1_epi16(1), two = _mm_set1_epi16(2);
+            for (; o + 8 <= outCount; o += 8) {
+                __m128i x = _mm_loadu_si128((const __m128i*)(s + 2 * o)), y = _mm_loadu_si128((const __m128i*)(s + 2 * o + 8));
+                __m128i pairs;
+                if (channels == 4) {
+                    pairs = _mm_add_epi16(_mm_unpacklo_epi64(x, y), _mm_unpackhi_epi64(x, y));
+                } else if (channels == 2) {
+                    __m128 fx = _mm_castsi128_ps(x), fy = _mm_castsi128_ps(y);
+                    pairs = _mm_add_epi16(_mm_castps_si128(_mm_shuffle_ps(fx, fy, _MM_SHUFFLE(2, 0, 2, 0))),
+                                          _mm_castps_si128(_mm_shuffle_ps(fx, fy, _MM_SHUFFLE(3, 1, 3, 1))));
+                } else {
+                    pairs = _mm_packs_epi32(_mm_madd_epi16(x, ones), _mm_madd_epi16(y, ones));
+                }
+                __m128i average = _mm_srli_epi16(_mm_add_epi16(pairs, two), 2);
+                _mm_storel_epi64((__m128i*)(out + o), _mm_packus_epi16(average, zero));
+            }
+        }
+#endif
+        for (size_t x = o / channels; x < (size_t)outWidth; x++) {
+            const uint16_t *texel = s + x * 2 * channels;
+            for (int c = 0; c < channels; c++) out[x * channels + c] = (unsigned char)((texel[c] + texel[c + step] + 2) >> 2);
+        }
+    }
+
+    // FilterRow for sRGB data, summed as linear floats and encoded again at the end
+    void FilterRowSRGB(const unsigned char *a, const unsigned char *b, int width, int outWidth, int channels, size_t step,
+                       unsigned char *out, std::vector<float> &sums) {
+        const Tables &tables = GetTables();
+        size_t count = (size_t)width * channels;
+        // padded so a 4 wide load at the last RGB texel stays inside
+        sums.resize(count + 4);
+
+        for (size_t i = 0; i < count; ) {
+            for (int c = 0; c < channels; c++, i++) {
+                const float *decode = tables.decode[IsAlpha(c, channels)];
+                sums[i] = decode[a[i]] + decode[b[i]];
+            }
+        }
+
+        int x = 0;
+#ifdef MIP_GENERATOR_SSE2
+        // one texel per register for RGB and RGBA, the 4th lane of RGB belongs to the next texel and is ignored
+        if (channels >= 3) {
+            const __m128 quarter = _mm_set1_ps(0.25f), half = _mm_set1_ps(0.5f);
+            const __m128 scale = _mm_setr_ps(ENCODE_STEPS, ENCODE_STEPS, ENCODE_STEPS, channels == 4 ? 255.0f : ENCODE_STEPS);
+            alignas(16) int32_t indices[4];
+            for (; x < outWidth; x++) {
+                const float *texel = sums.data() + (size_t)x * 2 * channels;
+                __m128 average = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(texel), _mm_loadu_ps(texel + step)), quarter);
+                // rounded half up like lround, the conversion's own rounding is to even
+                _mm_store_si128((__m128i*)indices, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(average, scale), half)));
+
+                unsigned char *dst = out + (size_t)x * channels;
+                for (int c = 0; c < 3; c++) dst[c] = tables.encode[std::min(std::max(indices[c], 0), ENCODE_STEPS)];
+                if (channels == 4) dst[3] = (unsigned char)std::min(std::max(indices[3], 0), 255);
+            }
+        }
+#endif
+        for (; x < outWidth; x++) {
+            for (int c = 0; c < channels; c++) {
+                size_t source = (size_t)x * 2 * channels + c;
+                float average = (sums[source] + sums[source + step]) * 0.25f;
+                out[(size_t)x * channels + c] = IsAlpha(c, channels)
+                    ? (unsigned char)std::min(std::max((int)std::lround(average * 255.0f), 0), 255)
+                    : tables.encode[std::min(std::max((int)std::lround(average * ENCODE_STEPS), 0), ENCODE_STEPS)];
+            }
+        }
+    }
+}
+
+int MipGenerator::LevelCount(int width, int height) {
+    return (int)std::floor(std::log2((double)std::max(std::max(width, height), 1))) + 1;
+}
+
+void MipGenerator::Downsample(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                              std::vector<unsigned char> &out) {
+    int outWidth = std::max(width / 2, 1), outHeight = std::max(height / 2, 1);
+    out.resize((size_t)outWidth * outHeight * channels);
+
+    size_t rowBytes = (size_t)width * channels, step = width > 1 ? channels : 0;
+    unsigned char *dst = out.data();
+    auto filterRows = [&](size_t begin, size_t end) {
+        std::vector<uint16_t> sums;
+        std::vector<float> linearSums;
+        for (size_t y = begin; y < end; y++) {
+            const unsigned char *a = pixels + std::min((int)y * 2, height - 1) * rowBytes;
+            const unsigned char *b = pixels + std::min((int)y * 2 + 1, height - 1) * rowBytes;
+            unsigned char *row = dst + y * outWidth * channels;
+            if (srgb) FilterRowSRGB(a, b, width, outWidth, channels, step, row, linearSums);
+            else FilterRow(a, b, width, outWidth, channels, step, row, sums);
+        }
+    };
+
+    if ((size_t)outWidth * outHeight < PARALLEL_TEXELS) filterRows(0, outHeight);
+    else ThreadPool::Global().ParallelFor(outHeight, filterRows);
+}
+
+void MipGenerator::Generate(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                            std::vector<std::vector<unsigned char>> &levels) {
+    int levelCount = LevelCount(width, height);
+    for (int level = 1; level < levelCount; level++) {
+        const unsigned char *above = level == 1 ? pixels : levels.back().data();
+        std::vector<unsigned char> next;
+        Downsample(above, std::max(width >> (level - 1), 1), std::max(height >> (level - 1), 1), channels, srgb, next);
+        levels.push_back(std::move(next));
+    }
+}
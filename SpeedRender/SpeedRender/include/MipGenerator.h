@@ -0,0 +1,24 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+
+// Builds mip chains on the CPU instead of glGenerateMipmap, so every driver gets the same filter and the
+// chain can be cached next to the texture. Each level is a 2x2 box filter of the one above it, run on SSE2
+// where available. sRGB color is averaged in linear space: averaging the encoded values darkens every level
+// and smears bright details into the dark around them. Alpha is linear either way.
+namespace MipGenerator {
+    // levels in a full chain down to 1x1, level 0 included
+    int LevelCount(int width, int height);
+
+    // Next level of a tightly packed image with 1 to 4 channels, sizes round down and stop at 1. With srgb
+    // every channel but alpha (the 4th of four, the 2nd of two) is decoded before filtering.
+    void Downsample(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                    std::vector<unsigned char> &out);
+
+    // Appends levels 1 to LevelCount - 1 of pixels to levels, each filtered from the one before
+    void Generate(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                  std::vector<std::vector<unsigned char>> &levels);
+}
+
+#endif
@@ -1,55 +1,225 @@
 #include "Model.h"
+#include "Camera.h"
+#include "CookedAssets.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "ResourceManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+static float lodThreshold = 1.0f;
+static bool meshletCulling = true;
 
 Model::Model(std::string path) {
-    LoadModel(path);
+    std::shared_ptr<Mesh> mesh = ResourceManager::GetMesh(path);
+    if (mesh) meshes.push_back(mesh);
 }
 
-Model::Model(Mesh mesh) {
+Model::Model(std::shared_ptr<Mesh> mesh) {
     meshes.push_back(mesh);
 }
 
-void Model::LoadModel(std::string path) {
-    cy::TriMesh t;
-    t.LoadFromFileObj(path.c_str());
-
-    // loop over vertices
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    int index = 0;
-    for (int i = 0; i < t.NF(); i++) {
-        cy::TriMesh::TriFace f = t.F(i);
-        cy::TriMesh::TriFace fn;
-        if (t.HasNormals()) fn = t.FN(i);
-        cy::TriMesh::TriFace ft;
-        if (t.HasTextureVertices()) ft = t.FT(i);
-
-        for (int j = 0; j < 3; j++) {
-            cy::Vec3f pos = t.V(f.v[j]); // position
-            cy::Vec3f norm(0.0f);
-            cy::Vec3f uv(0.0f);
-
-            if (t.HasNormals()) norm = t.VN(fn.v[j]);       // normal
-            if (t.HasTextureVertices()) uv = t.VT(ft.v[j]); // uv
-
-            vertices.push_back(
-                {
-                    glm::vec3(pos.x, pos.y, pos.z),
-                    glm::vec3(norm.x, norm.y, norm.z),
-                    glm::vec2(uv.x, uv.y)
-                }
-            );
-
-            indices.push_back(index++);
-        }
+std::shared_ptr<Mesh> Model::LoadMesh(const std::string &path) {
+    MeshData data;
+    if (!LoadMeshData(path, data)) return nullptr;
+    return CreateMesh(data);
+}
+
+bool Model::LoadMeshData(const std::string &path, MeshData &data) {
+    std::string compressedPath = MeshCodec::CachePath(path);
+    std::string cachePath = MeshCache::CachePath(path);
+
+    // Smallest on disk, the vertices decode straight into the buffer CreateMesh uploads. A cooked mesh was
+    // checked against its source by the manifest already.
+    std::string cookedPath = CookedAssets::Find(path, ".srmz");
+    if ((!cookedPath.empty() && MeshCodec::Read(cookedPath, "", data.compressed)) ||
+        MeshCodec::Read(compressedPath, path, data.compressed)) {
+        MeshCodec::Decoded &mesh = data.compressed;
+        data.packedVertices = mesh.vertices.data();
+        data.packedLayout = mesh.layout;
+        data.dequantization = mesh.dequantization;
+        data.vertexCount = mesh.vertices.size();
+        data.indices = mesh.indices.data();
+        data.indexCount = mesh.indices.size();
+        data.lods = mesh.lods.data();
+        data.lodCount = mesh.lods.size();
+        data.meshlets = mesh.meshlets.data();
+        data.meshletCount = mesh.meshlets.size();
+        data.bounds = mesh.bounds;
+        data.hasNormals = mesh.hasNormals;
+        data.hasUVs = mesh.hasUVs;
+        return true;
     }
 
-	std::vector<Texture> textures;
-	Mesh mesh(vertices, indices, textures, t.HasNormals(), t.HasTextureVertices());
-    meshes.push_back(mesh);
+    // fast path, the mapped arrays go straight to the GPU. Cooked into an asset pack they are mapped from it.
+    std::string cookedCachePath = CookedAssets::Find(path, ".srmesh");
+    if ((!cookedCachePath.empty() && MeshCache::Load(cookedCachePath, "", data.cache)) || MeshCache::Load(cachePath, path, data.cache)) {
+        const MeshCache::Header &header = *data.cache.header;
+        data.vertices = data.cache.vertices;
+        data.vertexCount = header.vertexCount;
+        data.indices = data.cache.indices;
+        data.indexCount = header.indexCount;
+        data.lods = data.cache.lods;
+        data.lodCount = header.lodCount;
+        data.meshlets = data.cache.meshlets;
+        data.meshletCount = header.meshletCount;
+        data.bounds = {
+            glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+            glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2])
+        };
+        data.hasNormals = (header.flags & MeshCache::FLAG_NORMALS) != 0;
+        data.hasUVs = (header.flags & MeshCache::FLAG_UVS) != 0;
+        return true;
+    }
+
+    ObjLoader::Result obj;
+    if (!ObjLoader::Load(path, obj)) return false;
+    std::vector<Vertex> &vertices = obj.vertices;
+    std::vector<unsigned int> &indices = obj.indices;
+
+    // several models may be processed at once, collect the report and print it in one go
+    std::ostringstream report;
+
+    MeshOptimizer::Process(path, vertices, indices, data.ownedLods, data.ownedMeshlets, report);
+    std::cout << report.str();
+
+    data.ownedVertices = std::move(vertices);
+    data.ownedIndices = std::move(indices);
+    data.vertices = data.ownedVertices.data();
+    data.vertexCount = data.ownedVertices.size();
+    data.indices = data.ownedIndices.data();
+    data.indexCount = data.ownedIndices.size();
+    data.lods = data.ownedLods.data();
+    data.lodCount = data.ownedLods.size();
+    data.meshlets = data.ownedMeshlets.data();
+    data.meshletCount = data.ownedMeshlets.size();
+    data.bounds = Mesh::ComputeBounds(data.vertices, data.vertexCount);
+    data.hasNormals = obj.hasNormals;
+    data.hasUVs = obj.hasUVs;
 
+    // packed meshes lose nothing more by being compressed, float meshes keep the exact cache
+    VertexFormat::Layout layout = Mesh::GetDefaultLayout();
+    if (layout != VertexFormat::Layout::Float) {
+        if (!MeshCodec::Write(compressedPath, path, data.vertices, data.vertexCount, data.indices, data.indexCount, data.ownedLods,
+                              data.ownedMeshlets, data.bounds, data.hasNormals, data.hasUVs, layout))
+            std::cout << "Failed to write compressed mesh " << compressedPath << std::endl;
+    } else if (!MeshCache::Write(cachePath, path, data.ownedVertices, data.ownedIndices, data.ownedLods, data.ownedMeshlets, data.bounds, data.hasNormals, data.hasUVs)) {
+        std::cout << "Failed to write mesh cache " << cachePath << std::endl;
+    }
+    return true;
+}
+
+std::shared_ptr<Mesh> Model::CreateMesh(const MeshData &data) {
+    std::vector<MeshLod> lods(data.lods, data.lods + data.lodCount);
+    std::vector<Meshlet> meshlets(data.meshlets, data.meshlets + data.meshletCount);
+
+    if (data.packedVertices) {
+        if (data.packedLayout == Mesh::GetDefaultLayout())
+            return std::make_shared<Mesh>(data.packedVertices, data.vertexCount, data.packedLayout, data.dequantization, data.indices,
+                                          data.indexCount, data.bounds, data.hasNormals, data.hasUVs, lods, meshlets);
+
+        // compressed in another layout than the one asked for, go through floats
+        std::vector<Vertex> vertices(data.vertexCount);
+        VertexFormat::Unpack(data.packedVertices, data.vertexCount, data.dequantization, data.packedLayout, vertices.data());
+        return std::make_shared<Mesh>(vertices.data(), vertices.size(), data.indices, data.indexCount, data.bounds,
+                                      data.hasNormals, data.hasUVs, Mesh::GetDefaultLayout(), lods, meshlets);
+    }
+
+    return std::make_shared<Mesh>(data.vertices, data.vertexCount, data.indices, data.indexCount, data.bounds,
+                                  data.hasNormals, data.hasUVs, Mesh::GetDefaultLayout(), lods, meshlets);
+}
+
+bool Model::ReadBounds(const std::string &path, AABB &bounds) {
+    std::string cookedPath = CookedAssets::Find(path, ".srmz"), cookedCachePath = CookedAssets::Find(path, ".srmesh");
+    return (!cookedPath.empty() && MeshCodec::ReadBounds(cookedPath, bounds)) ||
+           (!cookedCachePath.empty() && MeshCache::ReadBounds(cookedCachePath, bounds)) ||
+           MeshCodec::ReadBounds(MeshCodec::CachePath(path), bounds) || MeshCache::ReadBounds(MeshCache::CachePath(path), bounds);
 }
 
 void Model::Draw(Shader &shader) {
-    for(unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+    trianglesDrawn = 0;
+    for(unsigned int i = 0; i < meshes.size(); i++) {
+        meshes[i]->Draw(shader);
+        trianglesDrawn += meshes[i]->lods[0].indexCount / 3;
+    }
+}
+
+size_t Model::DrawInstanced(Shader &shader, InstanceBuffer &instances, size_t lod) {
+    size_t triangles = 0;
+    for (const std::shared_ptr<Mesh> &mesh : meshes) triangles += mesh->DrawInstanced(shader, instances, lod);
+    return triangles;
+}
+
+size_t Model::SelectLod(const Mesh &mesh, const glm::mat4 &model, const Camera &camera) const {
+    float scale = std::max(std::abs(transform.scale.x), std::max(std::abs(transform.scale.y), std::abs(transform.scale.z)));
+
+    // world space size of one pixel at distance 1
+    float pixelsPerUnit = camera.GetHeight() / (2.0f * std::tan(glm::radians(camera.GetFov()) * 0.5f));
+
+    // distance to the closest point of the bounding sphere, errors are projected as if they sat there
+    glm::vec3 center = glm::vec3(model * glm::vec4((mesh.bounds.min + mesh.bounds.max) * 0.5f, 1.0f));
+    float radius = glm::length(mesh.bounds.max - mesh.bounds.min) * 0.5f * scale;
+    float distance = std::max(glm::length(camera.position - center) - radius, camera.GetNearClip());
+
+    size_t lod = 0;
+    for (size_t i = 1; i < mesh.lods.size(); i++) {
+        float pixels = mesh.lods[i].error * scale / distance * pixelsPerUnit;
+        if (pixels > lodThreshold) break;
+        lod = i;
+    }
+    return lod;
+}
+
+void Model::Draw(Shader &shader, Camera &camera) {
+    glm::mat4 model = GetModelMatrix();
+    glm::mat4 modelViewProjection = camera.GetProjectionMatrix() * camera.GetViewMatrix() * model;
+    glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(camera.position, 1.0f));
+
+    trianglesDrawn = 0;
+    for (const std::shared_ptr<Mesh> &mesh : meshes) {
+        size_t lod = SelectLod(*mesh, model, camera);
+        if (meshletCulling) {
+            trianglesDrawn += mesh->DrawVisible(shader, lod, modelViewProjection, eye);
+        } else {
+            mesh->Draw(shader, lod);
+            trianglesDrawn += mesh->lods[lod].indexCount / 3;
+        }
+    }
+}
+
+void Model::Submit(RenderQueue &queue, Shader &shader, Camera &camera) {
+    glm::mat4 model = GetModelMatrix();
+    uint32_t transform = queue.AddTransform(model);
+    RenderQueue::Pass pass = shader.blend ? RenderQueue::Pass::Transparent : RenderQueue::Pass::Opaque;
+    for (const std::shared_ptr<Mesh> &mesh : meshes) {
+        glm::vec3 center = glm::vec3(model * glm::vec4((mesh->bounds.min + mesh->bounds.max) * 0.5f, 1.0f));
+        queue.Submit(pass, shader, *mesh, transform, SelectLod(*mesh, model, camera), meshletCulling, center);
+    }
+}
+
+void Model::SetLodThreshold(float pixels) {
+    lodThreshold = pixels;
+}
+
+float Model::GetLodThreshold() {
+    return lodThreshold;
+}
+
+void Model::SetMeshletCulling(bool enabled) {
+    meshletCulling = enabled;
+}
+
+bool Model::GetMeshletCulling() {
+    return meshletCulling;
+}
+
+bool Model::HasTexture(const std::string &type) const {
+    for (const std::shared_ptr<Mesh> &mesh : meshes)
+        for (const std::shared_ptr<Texture> &texture : mesh->textures)
+            if (texture->type == type) return true;
+    return false;
 }  
\ No newline at end of file
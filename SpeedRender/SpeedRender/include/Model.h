@@ -1,21 +1,76 @@
 #ifndef MODEL_H
 #define MODEL_H
 
-#include "cy/cyTriMesh.h"
-
 #include "Core.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
+
+// CPU side of a model's mesh, filled by Model::LoadMeshData on any thread and turned into GL buffers by
+// Model::CreateMesh on the GL thread
+struct MeshData {
+    // float vertices, or packedVertices in packedLayout when loaded from a compressed mesh
+    const Vertex *vertices = nullptr;
+    const VertexFormat::PackedVertex *packedVertices = nullptr;
+    VertexFormat::Layout packedLayout = VertexFormat::Layout::Float;
+    VertexFormat::Dequantization dequantization;
+    size_t vertexCount = 0;
+    const unsigned int *indices = nullptr;
+    size_t indexCount = 0;
+    const MeshLod *lods = nullptr;
+    size_t lodCount = 0;
+    const Meshlet *meshlets = nullptr;
+    size_t meshletCount = 0;
+    AABB bounds;
+    bool hasNormals = false;
+    bool hasUVs = false;
+
+    // backing storage for the arrays above, the mapped cache, the decoded compressed mesh or the freshly
+    // processed mesh
+    MeshCache::View cache;
+    MeshCodec::Decoded compressed;
+    std::vector<Vertex> ownedVertices;
+    std::vector<unsigned int> ownedIndices;
+    std::vector<MeshLod> ownedLods;
+    std::vector<Meshlet> ownedMeshlets;
+};
+
+class Camera;
 
 class Model {
 public:
+    Model() {}
     Model(std::string path);
-    Model(Mesh mesh);
+    Model(std::shared_ptr<Mesh> mesh);
     void Draw(Shader &shader);	
+    // Draws the coarsest LOD of each mesh whose error stays under the LOD threshold on screen, skipping
+    // meshlets outside the view or facing away from the camera when meshlet culling is on
+    void Draw(Shader &shader, Camera &camera);
+    // Submit's counterpart of Draw, the same LOD and meshlet choices in the pass matching the shader's blending
+    void Submit(RenderQueue &queue, Shader &shader, Camera &camera);
+    // Every mesh once per instance in one draw each, placed by the instances' transforms instead of the
+    // model's. shader has to be built with INSTANCED. Returns the number of triangles drawn.
+    size_t DrawInstanced(Shader &shader, InstanceBuffer &instances, size_t lod = 0);
+
+    // projected error in pixels a LOD may have, applies to every model
+    static void SetLodThreshold(float pixels);
+    static float GetLodThreshold();
+
+    static void SetMeshletCulling(bool enabled);
+    static bool GetMeshletCulling();
+
+    // triangles submitted by the last Draw, for the stats overlay
+    size_t trianglesDrawn = 0;
+
+    // true if any mesh has a texture of this type, used to pick the matching shader permutation
+    bool HasTexture(const std::string &type) const;
 
     Transform transform = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f) };
 
-    glm::mat4 GetModelMatrix() {
+    glm::mat4 GetModelMatrix() const {
         glm::mat4 model(1.0f);
         model = glm::translate(model, transform.position);
         model = glm::rotate(model, transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
@@ -25,9 +80,23 @@ public:
         return model;
     }
 
-    std::vector<Mesh> meshes;
+    // meshes are shared between every model created from the same file
+    std::vector<std::shared_ptr<Mesh>> meshes;
+
+    // Loads path from its cooked mesh, compressed mesh, mesh cache or the OBJ, nullptr on failure. Use ResourceManager::GetMesh instead.
+    static std::shared_ptr<Mesh> LoadMesh(const std::string &path);
+
+    // The two halves of LoadMesh. LoadMeshData does the file I/O and mesh processing and is safe to call
+    // from a worker, CreateMesh uploads the result and needs the GL context.
+    static bool LoadMeshData(const std::string &path, MeshData &data);
+    static std::shared_ptr<Mesh> CreateMesh(const MeshData &data);
+
+    // Bounds of path from the header of its cooked mesh, compressed mesh or mesh cache, false if none exists yet
+    static bool ReadBounds(const std::string &path, AABB &bounds);
+
 private:
-    void LoadModel(std::string path);
+    // coarsest LOD of mesh whose error stays under the threshold on screen
+    size_t SelectLod(const Mesh &mesh, const glm::mat4 &model, const Camera &camera) const;
 };
 
 #endif
@@ -0,0 +1,152 @@
+#include "ModelLibrary.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "ResourceManager.h"
+#include "ThreadPool.h"
+
+namespace {
+    // the 12 triangles of an axis aligned box
+    std::shared_ptr<Mesh> CreateBox(const AABB &bounds) {
+        static const int corners[36] = {
+            0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,
+            0, 1, 4, 1, 5, 4,   2, 6, 3, 3, 6, 7,
+            0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5
+        };
+
+        std::vector<float> positions;
+        for (int corner : corners) {
+            positions.push_back(corner & 1 ? bounds.max.x : bounds.min.x);
+            positions.push_back(corner & 2 ? bounds.max.y : bounds.min.y);
+            positions.push_back(corner & 4 ? bounds.max.z : bounds.min.z);
+        }
+        return std::make_shared<Mesh>(positions);
+    }
+
+    size_t GpuBytes(const Mesh &mesh) {
+        return mesh.vertexCount * VertexFormat::Stride(mesh.layout) + (mesh.hasIndices ? mesh.indexCount * sizeof(unsigned int) : 0);
+    }
+}
+
+ModelLibrary::~ModelLibrary() {
+    // the loads only touch their own MeshData, but don't leave them running past the GL resources
+    for (std::unique_ptr<Entry> &entry : entries)
+        if (entry->loading) entry->loaded.wait();
+}
+
+ModelLibrary::Handle ModelLibrary::Register(const std::string &path, const Transform &transform, std::function<void(Model &)> onLoaded) {
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->path = path;
+    entry->onLoaded = onLoaded;
+    entry->model.transform = transform;
+    entry->placeholder.transform = transform;
+    entries.push_back(std::move(entry));
+    return entries.size() - 1;
+}
+
+void ModelLibrary::Request(Handle handle) {
+    Entry &entry = *entries[handle];
+    if (entry.resident || entry.loading || entry.failed) return;
+
+    // only the header is read here, the unit cube stands in until the first load has written a cache
+    if (entry.placeholder.meshes.empty()) {
+        AABB bounds = { glm::vec3(-0.5f), glm::vec3(0.5f) };
+        Model::ReadBounds(entry.path, bounds);
+        entry.placeholder.meshes.push_back(CreateBox(bounds));
+    }
+
+    entry.loading = true;
+    entry.data = std::make_shared<MeshData>();
+    std::shared_ptr<MeshData> data = entry.data;
+    std::string path = entry.path;
+    entry.loaded = ThreadPool::Global().Submit([data, path]() { return Model::LoadMeshData(path, *data); });
+}
+
+void ModelLibrary::Prefetch(Handle handle) {
+    Entry &entry = *entries[handle];
+    if (entry.resident || entry.loading || entry.failed || entry.evicted) return;
+    if (residentBytes + entry.knownBytes > memoryBudget) return;
+
+    entry.prefetched = true;
+    Request(handle);
+}
+
+Model &ModelLibrary::Get(Handle handle) {
+    Entry &entry = *entries[handle];
+    entry.lastUsed = frame;
+    entry.prefetched = false;
+    entry.evicted = false;
+    if (entry.resident) return entry.model;
+
+    Request(handle);
+    return entry.placeholder;
+}
+
+void ModelLibrary::Update() {
+    for (std::unique_ptr<Entry> &entry : entries)
+        if (entry->loading && entry->loaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) Finish(*entry);
+
+    // evict the least recently used until the rest fits, never anything used this frame
+    while (residentBytes > memoryBudget) {
+        Entry *oldest = nullptr;
+        for (std::unique_ptr<Entry> &entry : entries)
+            if (entry->resident && entry->lastUsed < frame && (!oldest || entry->lastUsed < oldest->lastUsed)) oldest = entry.get();
+        if (!oldest) break;
+        Evict(*oldest);
+    }
+
+    frame++;
+}
+
+void ModelLibrary::Finish(Entry &entry) {
+    entry.loading = false;
+    bool ok = entry.loaded.get();
+    std::shared_ptr<MeshData> data = std::move(entry.data);
+    if (!ok || data->vertexCount == 0) {
+        std::cout << "Failed to load model " << entry.path << std::endl;
+        entry.failed = true;
+        return;
+    }
+
+    std::shared_ptr<Mesh> mesh = ResourceManager::GetMesh(entry.path, *data);
+    entry.model.meshes = { mesh };
+    entry.resident = true;
+    entry.bytes = entry.knownBytes = GpuBytes(*mesh);
+    residentBytes += entry.bytes;
+
+    // a prefetched model counts as used from the moment it arrives
+    entry.lastUsed = std::max(entry.lastUsed, frame);
+
+    // the cache exists now, so later placeholders get the real bounds
+    entry.placeholder.meshes = { CreateBox(mesh->bounds) };
+
+    // the budget filled up while it loaded, it must not push out what is in use
+    if (entry.prefetched && residentBytes > memoryBudget) {
+        Evict(entry);
+        return;
+    }
+
+    if (entry.onLoaded) entry.onLoaded(entry.model);
+}
+
+void ModelLibrary::Evict(Entry &entry) {
+    // the mesh is freed once ResourceManager's last handle to it goes
+    entry.model.meshes.clear();
+    entry.resident = false;
+    residentBytes -= entry.bytes;
+    entry.bytes = 0;
+    entry.evicted = true;
+}
+
+size_t ModelLibrary::GetResidentCount() const {
+    size_t count = 0;
+    for (const std::unique_ptr<Entry> &entry : entries) count += entry->resident;
+    return count;
+}
+
+size_t ModelLibrary::GetLoadingCount() const {
+    size_t count = 0;
+    for (const std::unique_ptr<Entry> &entry : entries) count += entry->loading;
+    return count;
+}
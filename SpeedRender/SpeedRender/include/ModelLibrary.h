@@ -0,0 +1,87 @@
+#ifndef MODEL_LIBRARY_H
+#define MODEL_LIBRARY_H
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Model.h"
+
+// Models known by path that are only loaded once something asks for them. A request parses the model on
+// the thread pool and Update() uploads it on the GL thread, until then Get() hands out a placeholder box
+// around the bounds in the mesh's cache header. Resident models that were not used for a while are dropped
+// again, least recently used first, whenever their GPU memory adds up to more than memoryBudget.
+class ModelLibrary {
+public:
+    typedef size_t Handle;
+
+    ModelLibrary() {}
+    ~ModelLibrary();
+
+    ModelLibrary(const ModelLibrary &) = delete;
+    ModelLibrary &operator=(const ModelLibrary &) = delete;
+
+    // Nothing is read yet. onLoaded runs on the GL thread every time the model becomes resident, e.g. to
+    // attach textures to its meshes.
+    Handle Register(const std::string &path, const Transform &transform, std::function<void(Model &)> onLoaded = nullptr);
+
+    // Starts loading handle in the background unless it is resident or on its way
+    void Request(Handle handle);
+    // Request for a model that may be wanted soon. Skipped if it was evicted since it was last used, or its
+    // size from an earlier load doesn't fit in what is left of the budget. A prefetch never evicts anything,
+    // one that doesn't fit once it is loaded is dropped again.
+    void Prefetch(Handle handle);
+
+    // The model if it is resident, otherwise requests it and returns its placeholder. Marks it as used
+    // this frame, so it is not evicted.
+    Model &Get(Handle handle);
+
+    bool IsResident(Handle handle) const { return entries[handle]->resident; }
+    bool IsLoading(Handle handle) const { return entries[handle]->loading; }
+    // the load failed, it is not retried and the placeholder stays
+    bool IsFailed(Handle handle) const { return entries[handle]->failed; }
+    const std::string &GetPath(Handle handle) const { return entries[handle]->path; }
+    size_t Count() const { return entries.size(); }
+
+    // Call once per frame on the GL thread
+    void Update();
+
+    size_t GetResidentBytes() const { return residentBytes; }
+    size_t GetResidentCount() const;
+    size_t GetLoadingCount() const;
+
+    // GPU memory resident models may take before the least recently used ones are evicted
+    size_t memoryBudget = 256 * 1024 * 1024;
+
+private:
+    struct Entry {
+        std::string path;
+        std::function<void(Model &)> onLoaded;
+        Model model;
+        Model placeholder;
+
+        bool loading = false;
+        bool resident = false;
+        bool failed = false;
+        bool prefetched = false;    // loaded ahead, not used since
+        bool evicted = false;       // for the budget, not prefetched again until it is used
+        std::shared_ptr<MeshData> data;
+        std::future<bool> loaded;
+
+        size_t bytes = 0;
+        size_t knownBytes = 0;      // of the last load, kept after eviction
+        uint64_t lastUsed = 0;
+    };
+
+    void Finish(Entry &entry);
+    void Evict(Entry &entry);
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    size_t residentBytes = 0;
+    uint64_t frame = 0;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "ObjLoader.h"
+
+#include <charconv>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace {
+    enum CornerFlags : unsigned char {
+        HAS_UV       = 1 << 0,
+        HAS_NORMAL   = 1 << 1,
+        REL_POSITION = 1 << 2, // negative OBJ index, relative to the chunk until the merge knows its base
+        REL_UV       = 1 << 3,
+        REL_NORMAL   = 1 << 4
+    };
+
+    struct Corner {
+        long long position, uv, normal;
+        unsigned char flags;
+    };
+
+    struct Chunk {
+        const char *begin, *end;
+        size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+        std::vector<float> positions, uvs, normals;
+        std::vector<Corner> corners;
+    };
+
+    inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+    inline const char *SkipBlanks(const char *p, const char *end) {
+        while (p < end && IsBlank(*p)) p++;
+        return p;
+    }
+
+    inline const char *NextLine(const char *p, const char *end) {
+        while (p < end && *p != '\n') p++;
+        return p < end ? p + 1 : end;
+    }
+
+    inline const char *ParseFloat(const char *p, const char *end, float &value) {
+        p = SkipBlanks(p, end);
+        if (p < end && *p == '+') p++; // from_chars does not accept an explicit plus sign
+        std::from_chars_result r = std::from_chars(p, end, value);
+        if (r.ec != std::errc()) value = 0.0f;
+        return r.ptr;
+    }
+
+    // OBJ indices are one based, negative ones count back from the last element seen so far
+    inline bool ParseIndex(const char *&p, const char *end, size_t seen, long long &index, bool &relative) {
+        long long value = 0;
+        std::from_chars_result r = std::from_chars(p, end, value);
+        if (r.ec != std::errc() || value == 0) return false;
+        p = r.ptr;
+        relative = value < 0;
+        index = relative ? (long long)seen + value : value - 1;
+        return true;
+    }
+
+    // cheap first pass so every array can be reserved exactly once
+    void CountChunk(Chunk &chunk) {
+        for (const char *p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end)) {
+            p = SkipBlanks(p, chunk.end);
+            if (chunk.end - p < 2) continue;
+
+            if (p[0] == 'v' && IsBlank(p[1])) chunk.positionCount++;
+            else if (p[0] == 'v' && p[1] == 't') chunk.uvCount++;
+            else if (p[0] == 'v' && p[1] == 'n') chunk.normalCount++;
+            else if (p[0] == 'f' && IsBlank(p[1])) {
+                size_t tokens = 0;
+                for (const char *q = p + 1; q < chunk.end && *q != '\n' && *q != '#'; ) {
+                    q = SkipBlanks(q, chunk.end);
+                    if (q >= chunk.end || *q == '\n' || *q == '\r' || *q == '#') break;
+                    tokens++;
+                    while (q < chunk.end && !IsBlank(*q) && *q != '\n' && *q != '\r') q++;
+                }
+                if (tokens >= 3) chunk.cornerCount += (tokens - 2) * 3;
+            }
+        }
+    }
+
+    void ParseChunk(Chunk &chunk) {
+        CountChunk(chunk);
+        chunk.positions.reserve(chunk.positionCount * 3);
+        chunk.uvs.reserve(chunk.uvCount * 2);
+        chunk.normals.reserve(chunk.normalCount * 3);
+        chunk.corners.reserve(chunk.cornerCount);
+
+        const char *end = chunk.end;
+        for (const char *p = chunk.begin; p < end; p = NextLine(p, end)) {
+            p = SkipBlanks(p, end);
+            if (end - p < 2) continue;
+
+            if (p[0] == 'v' && IsBlank(p[1])) {
+                float x, y, z;
+                p = ParseFloat(p + 1, end, x);
+                p = ParseFloat(p, end, y);
+                p = ParseFloat(p, end, z);
+                chunk.positions.insert(chunk.positions.end(), { x, y, z });
+            } else if (p[0] == 'v' && p[1] == 't') {
+                float u, v;
+                p = ParseFloat(p + 2, end, u);
+                p = ParseFloat(p, end, v);
+                chunk.uvs.insert(chunk.uvs.end(), { u, v });
+            } else if (p[0] == 'v' && p[1] == 'n') {
+                float x, y, z;
+                p = ParseFloat(p + 2, end, x);
+                p = ParseFloat(p, end, y);
+                p = ParseFloat(p, end, z);
+                chunk.normals.insert(chunk.normals.end(), { x, y, z });
+            } else if (p[0] == 'f' && IsBlank(p[1])) {
+                // v, v/vt, v//vn or v/vt/vn per corner, polygons become a triangle fan
+                Corner first = {}, previous = {};
+                int cornerIndex = 0;
+                p++;
+                while (true) {
+                    p = SkipBlanks(p, end);
+                    if (p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+
+                    Corner corner = {};
+                    bool relative;
+                    if (!ParseIndex(p, end, chunk.positions.size() / 3, corner.position, relative)) break;
+                    if (relative) corner.flags |= REL_POSITION;
+
+                    if (p < end && *p == '/') {
+                        p++;
+                        if (p < end && *p != '/') {
+                            if (!ParseIndex(p, end, chunk.uvs.size() / 2, corner.uv, relative)) break;
+                            corner.flags |= HAS_UV | (relative ? REL_UV : 0);
+                        }
+                        if (p < end && *p == '/') {
+                            p++;
+                            if (!ParseIndex(p, end, chunk.normals.size() / 3, corner.normal, relative)) break;
+                            corner.flags |= HAS_NORMAL | (relative ? REL_NORMAL : 0);
+                        }
+                    }
+
+                    if (cornerIndex == 0) first = corner;
+                    if (cornerIndex >= 2) chunk.corners.insert(chunk.corners.end(), { first, previous, corner });
+                    previous = corner;
+                    cornerIndex++;
+                }
+            }
+        }
+    }
+
+    inline bool Resolve(long long index, bool relative, size_t base, size_t count, size_t &resolved) {
+        long long global = relative ? (long long)base + index : index;
+        if (global < 0 || global >= (long long)count) return false;
+        resolved = (size_t)global;
+        return true;
+    }
+}
+
+bool ObjLoader::Load(const std::string &path, Result &result) {
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        std::cout << "ERROR::OBJ::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        return false;
+    }
+
+    ThreadPool &pool = ThreadPool::Global();
+    const char *data = (const char*)file.Data();
+    const char *dataEnd = data + file.Size();
+
+    // one chunk per participating thread, boundaries pushed forward to the next line start
+    size_t chunkCount = pool.ThreadCount() + 1;
+    size_t minChunkSize = 1 << 20;
+    if (file.Size() / chunkCount < minChunkSize) chunkCount = file.Size() / minChunkSize + 1;
+
+    std::vector<Chunk> chunks(chunkCount);
+    const char *begin = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char *end = i + 1 == chunkCount ? dataEnd : data + file.Size() * (i + 1) / chunkCount;
+        if (end < begin) end = begin;
+        while (end > data && end < dataEnd && end[-1] != '\n') end++;
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+
+    pool.ParallelFor(chunkCount, [&chunks](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) ParseChunk(chunks[i]);
+    });
+
+    // chunk bases in file order make the merge deterministic
+    std::vector<size_t> positionBase(chunkCount), uvBase(chunkCount), normalBase(chunkCount), cornerBase(chunkCount);
+    size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        positionBase[i] = positionCount;
+        uvBase[i] = uvCount;
+        normalBase[i] = normalCount;
+        cornerBase[i] = cornerCount;
+        positionCount += chunks[i].positions.size() / 3;
+        uvCount += chunks[i].uvs.size() / 2;
+        normalCount += chunks[i].normals.size() / 3;
+        cornerCount += chunks[i].corners.size();
+    }
+
+    std::vector<glm::vec3> positions(positionCount), normals(normalCount);
+    std::vector<glm::vec2> uvs(uvCount);
+    pool.ParallelFor(chunkCount, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const Chunk &chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), (float*)positions.data() + positionBase[i] * 3);
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), (float*)uvs.data() + uvBase[i] * 2);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), (float*)normals.data() + normalBase[i] * 3);
+        }
+    });
+
+    result.hasNormals = normalCount > 0;
+    result.hasUVs = uvCount > 0;
+    result.vertices.resize(cornerCount);
+    result.indices.resize(cornerCount);
+
+    std::vector<char> badIndex(chunkCount, 0);
+    pool.ParallelFor(chunkCount, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const Chunk &chunk = chunks[i];
+            Vertex *out = result.vertices.data() + cornerBase[i];
+            unsigned int *outIndex = result.indices.data() + cornerBase[i];
+
+            for (size_t c = 0; c < chunk.corners.size(); c++) {
+                const Corner &corner = chunk.corners[c];
+                Vertex v = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f) };
+                size_t index;
+
+                if (Resolve(corner.position, (corner.flags & REL_POSITION) != 0, positionBase[i], positionCount, index))
+                    v.position = positions[index];
+                else
+                    badIndex[i] = 1;
+
+                if (corner.flags & HAS_UV) {
+                    if (Resolve(corner.uv, (corner.flags & REL_UV) != 0, uvBase[i], uvCount, index)) v.texCoords = uvs[index];
+                    else badIndex[i] = 1;
+                }
+
+                if (corner.flags & HAS_NORMAL) {
+                    if (Resolve(corner.normal, (corner.flags & REL_NORMAL) != 0, normalBase[i], normalCount, index)) v.normal = normals[index];
+                    else badIndex[i] = 1;
+                }
+
+                out[c] = v;
+                outIndex[c] = (unsigned int)(cornerBase[i] + c);
+            }
+        }
+    });
+
+    for (char bad : badIndex) {
+        if (bad) {
+            std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE " << path << std::endl;
+            break;
+        }
+    }
+
+    return true;
+}
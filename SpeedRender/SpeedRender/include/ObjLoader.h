@@ -0,0 +1,22 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+// Wavefront OBJ reader. The file is memory mapped, split into line aligned chunks that are parsed
+// on the global thread pool, then merged in file order so the output does not depend on timing.
+namespace ObjLoader {
+    struct Result {
+        std::vector<Vertex> vertices;       // one vertex per triangle corner, polygons are fan triangulated
+        std::vector<unsigned int> indices;  // 0, 1, 2, ... ready for MeshOptimizer::WeldVertices
+        bool hasNormals = false;
+        bool hasUVs = false;
+    };
+
+    bool Load(const std::string &path, Result &result);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "ProgramCache.h"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'P', 'G' };
+    const uint32_t VERSION = 1;
+    const char *CACHE_DIRECTORY = "shadercache";
+
+    struct Header {
+        char     magic[4];      // "SRPG"
+        uint32_t version;
+        uint64_t key;           // repeated so a renamed or colliding file is never used
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+    };
+
+    ProgramCache::Stats stats;
+
+    // binaries are only valid for the exact driver that produced them
+    const std::string &DriverIdentity() {
+        static std::string identity;
+        if (identity.empty()) {
+            const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+            for (GLenum name : names) {
+                const char *value = (const char*)glGetString(name);
+                identity += value ? value : "?";
+                identity += "|";
+            }
+        }
+        return identity;
+    }
+}
+
+bool ProgramCache::IsSupported() {
+    static int supported = -1;
+    if (supported < 0) {
+        // core in 4.1, glad leaves the pointers null on older contexts without ARB_get_program_binary
+        GLint formats = 0;
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0;
+    }
+    return supported != 0;
+}
+
+uint64_t ProgramCache::Key(const std::string &vertexSource, const std::string &fragmentSource) {
+    uint64_t key = Hash::Fnv1a(DriverIdentity());
+    key = Hash::Fnv1a(vertexSource, key);
+    return Hash::Fnv1a(fragmentSource, key);
+}
+
+std::string ProgramCache::CachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.srprog", (unsigned long long)key);
+    return (fs::path(CACHE_DIRECTORY) / name).string();
+}
+
+bool ProgramCache::Load(uint64_t key, unsigned int program) {
+    if (!IsSupported()) return false;
+
+    std::ifstream in(CachePath(key), std::ios::binary);
+    if (!in) return false;
+
+    Header header;
+    if (!in.read((char*)&header, sizeof(Header)) || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION || header.key != key) return false;
+
+    std::vector<char> binary(header.binaryLength);
+    if (!in.read(binary.data(), binary.size())) return false;
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // drivers may reject their own binaries after an update even with an unchanged identity string
+        stats.rejected++;
+        return false;
+    }
+
+    stats.loaded++;
+    return true;
+}
+
+void ProgramCache::PrepareForStore(unsigned int program) {
+    if (IsSupported()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::Store(uint64_t key, unsigned int program) {
+    stats.compiled++;
+    if (!IsSupported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = (uint32_t)length;
+
+    std::error_code ec;
+    fs::create_directories(CACHE_DIRECTORY, ec);
+
+    std::string cachePath = CachePath(key);
+    bool written = WriteFileAtomically(cachePath, [&](std::ofstream &out) {
+        out.write((const char*)&header, sizeof(Header));
+        out.write(binary.data(), length);
+        return true;
+    });
+    if (!written) std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << cachePath << std::endl;
+}
+
+const ProgramCache::Stats &ProgramCache::GetStats() {
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary). Entries are keyed by
+// the shader sources and the driver identity, a driver update or edited shader simply misses and the
+// caller compiles from source again. GL thread only.
+namespace ProgramCache {
+    struct Stats {
+        unsigned int loaded = 0;    // programs restored from a binary
+        unsigned int compiled = 0;  // programs built from source
+        unsigned int rejected = 0;  // binaries the driver refused, e.g. after an update
+    };
+
+    // false on contexts without program binaries, everything is then compiled from source
+    bool IsSupported();
+
+    uint64_t Key(const std::string &vertexSource, const std::string &fragmentSource);
+
+    // shadercache/<key>.srprog under the working directory
+    std::string CachePath(uint64_t key);
+
+    // Restores program from the cache, true if it is now linked. On false build it from source as usual,
+    // a program whose binary was rejected can still be linked.
+    bool Load(uint64_t key, unsigned int program);
+
+    // Call before glLinkProgram so the driver keeps a retrievable binary around
+    void PrepareForStore(unsigned int program);
+    // Saves a program that was just built from source and linked successfully
+    void Store(uint64_t key, unsigned int program);
+
+    const Stats &GetStats();
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Mesh.h"
+#include "Shader.h"
+
+namespace {
+    const int PASS_SHIFT = 61;
+
+    const uint64_t PROGRAM_MASK = 0xfff;
+    const uint64_t TEXTURE_MASK = 0xffff;
+    const uint64_t MESH_MASK = 0x1ff;
+    const uint64_t DEPTH_MASK = 0xffffff;
+
+    unsigned int ProgramOf(const Shader *shader) {
+        return shader ? shader->ID : 0;
+    }
+
+    unsigned int TextureOf(const Mesh *mesh) {
+        return mesh && !mesh->textures.empty() && mesh->textures[0] ? mesh->textures[0]->id : 0;
+    }
+
+    unsigned int MeshOf(const Mesh *mesh) {
+        return mesh ? mesh->GetVAO() : 0;
+    }
+}
+
+RenderQueue::RenderQueue(UniformBuffer<UniformBlocks::Object> &objectBlock) : objectBlock(objectBlock) {}
+
+void RenderQueue::Begin(const glm::mat4 &viewProjection, const glm::vec3 &eye) {
+    this->viewProjection = viewProjection;
+    this->eye = eye;
+    transforms.clear();
+    packets.clear();
+    entries.clear();
+}
+
+uint32_t RenderQueue::AddTransform(const glm::mat4 &model) {
+    transforms.push_back({ UniformBlocks::Object::FromModel(model), viewProjection * model,
+                           glm::vec3(glm::inverse(model) * glm::vec4(eye, 1.0f)) });
+    return (uint32_t)transforms.size() - 1;
+}
+
+uint64_t RenderQueue::Key(Pass pass, const Shader *shader, const Mesh *mesh, const glm::vec3 &center) const {
+    uint64_t key = (uint64_t)pass << PASS_SHIFT;
+    uint64_t program = ProgramOf(shader) & PROGRAM_MASK, texture = TextureOf(mesh) & TEXTURE_MASK, vao = MeshOf(mesh) & MESH_MASK;
+
+    // the bits of a positive float sort like its value, the top 24 are plenty to order draws
+    float distance = glm::length(center - eye);
+    uint32_t bits;
+    memcpy(&bits, &distance, sizeof(bits));
+    uint64_t depth = (bits >> 8) & DEPTH_MASK;
+
+    switch (pass) {
+    case Pass::Opaque:
+    case Pass::AlphaTested:
+        return key | program << 49 | texture << 33 | vao << 24 | depth;
+    case Pass::Transparent:
+        return key | (DEPTH_MASK - depth) << 37 | program << 25 | texture << 9 | vao;
+    default:
+        return key;
+    }
+}
+
+void RenderQueue::Submit(Pass pass, Shader &shader, Mesh &mesh, uint32_t transform, size_t lod, bool cull, const glm::vec3 &center) {
+    entries.push_back({ Key(pass, &shader, &mesh, center), (uint32_t)packets.size() });
+    packets.push_back({ &mesh, &shader, transform, (uint32_t)lod, cull, nullptr });
+}
+
+void RenderQueue::Submit(Pass pass, std::function<size_t()> draw, Shader *shader, const glm::vec3 &center) {
+    entries.push_back({ Key(pass, shader, nullptr, center), (uint32_t)packets.size() });
+    packets.push_back({ nullptr, shader, 0, 0, false, std::move(draw) });
+}
+
+size_t RenderQueue::Changes(const std::vector<Packet> &packets, const SortEntry *order, size_t count) {
+    size_t changes = 0;
+    const Packet *previous = nullptr;
+    for (size_t i = 0; i < count; i++) {
+        const Packet &packet = packets[order ? order[i].packet : i];
+        if (previous) {
+            changes += ProgramOf(packet.shader) != ProgramOf(previous->shader);
+            changes += TextureOf(packet.mesh) != TextureOf(previous->mesh);
+            changes += MeshOf(packet.mesh) != MeshOf(previous->mesh);
+        }
+        previous = &packet;
+    }
+    return changes;
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch) {
+    // least significant byte first, every pass is stable. All eight histograms come from one read of the
+    // keys, bytes every key shares (the pass bits of a single pass, unused depth) are skipped.
+    size_t counts[8][256] = {};
+    for (const SortEntry &entry : entries)
+        for (int digit = 0; digit < 8; digit++) counts[digit][(entry.key >> (digit * 8)) & 0xff]++;
+
+    scratch.resize(entries.size());
+    for (int digit = 0; digit < 8; digit++) {
+        size_t *count = counts[digit];
+        if (entries.empty() || count[(entries[0].key >> (digit * 8)) & 0xff] == entries.size()) continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            size_t bucketCount = count[bucket];
+            count[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (const SortEntry &entry : entries) scratch[count[(entry.key >> (digit * 8)) & 0xff]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::Flush() {
+    stats = Stats();
+    stats.packets = packets.size();
+    for (const SortEntry &entry : entries) stats.passPackets[entry.key >> PASS_SHIFT]++;
+
+    stats.submittedChanges = Changes(packets, nullptr, packets.size());
+    RadixSort(entries, scratch);
+    stats.sortedChanges = Changes(packets, entries.data(), entries.size());
+
+    for (const SortEntry &entry : entries) {
+        Packet &packet = packets[entry.packet];
+        if (packet.draw) {
+            stats.trianglesDrawn += packet.draw();
+            continue;
+        }
+
+        const Transform &transform = transforms[packet.transform];
+        objectBlock.Push(transform.object);
+        if (packet.cull) {
+            stats.trianglesDrawn += packet.mesh->DrawVisible(*packet.shader, packet.lod, transform.modelViewProjection, transform.eye);
+        } else {
+            packet.mesh->Draw(*packet.shader, packet.lod);
+            const MeshLod &range = packet.mesh->lods[std::min((size_t)packet.lod, packet.mesh->lods.size() - 1)];
+            stats.trianglesDrawn += (packet.mesh->hasIndices ? range.indexCount : packet.mesh->vertexCount) / 3;
+        }
+    }
+
+    transforms.clear();
+    packets.clear();
+    entries.clear();
+}
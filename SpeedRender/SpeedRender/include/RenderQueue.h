@@ -0,0 +1,92 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "UniformBlocks.h"
+
+class Mesh;
+class Shader;
+
+// Draws are submitted here during the frame and issued together by Flush, in the order that is cheapest for
+// the GPU instead of the order the code happens to submit them. Every packet gets a 64 bit key, the pass in
+// the top bits so passes stay in order, then within a pass:
+//   opaque, alpha tested: program, texture, mesh, then front to back so early depth rejects the rest
+//   transparent:          back to front for correct blending, then program, texture, mesh
+//   skybox, UI:           submission order
+// The keys are radix sorted, which is stable, so equal keys also keep their submission order.
+class RenderQueue {
+public:
+    enum class Pass { Opaque, AlphaTested, Skybox, Transparent, UI, Count };
+
+    struct Stats {
+        size_t packets = 0;
+        size_t passPackets[(int)Pass::Count] = {};
+        // program, texture or mesh switches between neighbouring packets in each order
+        size_t submittedChanges = 0;
+        size_t sortedChanges = 0;
+        size_t trianglesDrawn = 0;
+    };
+
+    // Object blocks of the packets are pushed to objectBlock
+    explicit RenderQueue(UniformBuffer<UniformBlocks::Object> &objectBlock);
+
+    // camera of this frame's packets, clears anything not flushed
+    void Begin(const glm::mat4 &viewProjection, const glm::vec3 &eye);
+
+    // an object transform shared by the packets that pass the returned index
+    uint32_t AddTransform(const glm::mat4 &model);
+
+    // One LOD of mesh, with its visible meshlets only if cull is set. center is in world space and only
+    // used for depth sorting.
+    void Submit(Pass pass, Shader &shader, Mesh &mesh, uint32_t transform, size_t lod, bool cull, const glm::vec3 &center);
+    // a draw the queue knows nothing about, e.g. the skybox or ImGui, returning the triangles it drew for
+    // the stats. shader only groups it with other packets of the same program.
+    void Submit(Pass pass, std::function<size_t()> draw, Shader *shader = nullptr, const glm::vec3 &center = glm::vec3(0.0f));
+
+    // sorts and draws everything submitted since Begin
+    void Flush();
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    struct Transform {
+        UniformBlocks::Object object;
+        glm::mat4 modelViewProjection;
+        glm::vec3 eye;      // camera position in model space, for meshlet cone culling
+    };
+
+    struct Packet {
+        Mesh *mesh;
+        Shader *shader;
+        uint32_t transform;
+        uint32_t lod;
+        bool cull;
+        std::function<size_t()> draw;
+    };
+
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    uint64_t Key(Pass pass, const Shader *shader, const Mesh *mesh, const glm::vec3 &center) const;
+    static size_t Changes(const std::vector<Packet> &packets, const SortEntry *order, size_t count);
+    static void RadixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch);
+
+    UniformBuffer<UniformBlocks::Object> &objectBlock;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 eye = glm::vec3(0.0f);
+
+    // kept between frames so a steady scene allocates nothing
+    std::vector<Transform> transforms;
+    std::vector<Packet> packets;
+    std::vector<SortEntry> entries, scratch;
+    Stats stats;
+};
+
+#endif
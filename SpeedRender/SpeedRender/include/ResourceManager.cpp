@@ -0,0 +1,119 @@
+#include "ResourceManager.h"
+#include "TextureLoader.h"
+#include "GLState.h"
+#include "Model.h"
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <iostream>
+
+ResourceManager::Cache<Texture> ResourceManager::textures;
+ResourceManager::Cache<Cubemap> ResourceManager::cubemaps;
+ResourceManager::Cache<Shader> ResourceManager::shaders;
+ResourceManager::Cache<Mesh> ResourceManager::meshes;
+
+template <typename T, typename Load>
+std::shared_ptr<T> ResourceManager::Acquire(Cache<T> &cache, const std::string &key, Load load) {
+    auto it = cache.entries.find(key);
+    if (it != cache.entries.end()) {
+        std::shared_ptr<T> resource = it->second.lock();
+        if (resource) {
+            cache.hits++;
+            return resource;
+        }
+    }
+
+    cache.misses++;
+    std::shared_ptr<T> resource = load();
+    if (resource) cache.entries[key] = resource;
+
+    // drop entries whose resource has been freed so the map doesn't grow with churn
+    for (auto entry = cache.entries.begin(); entry != cache.entries.end(); ) {
+        if (entry->second.expired()) entry = cache.entries.erase(entry);
+        else ++entry;
+    }
+    return resource;
+}
+
+std::shared_ptr<Texture> ResourceManager::GetTexture(const std::string &path, const std::string &type) {
+    // the decoded image depends on the flip setting, so it is part of the key
+    bool flip = TextureLoader::Get().GetFlipOnLoad();
+    std::string key = path + "|" + type + (flip ? "|flip" : "");
+    return Acquire(textures, key, [&]() { return std::make_shared<Texture>(path, type); });
+}
+
+std::shared_ptr<Cubemap> ResourceManager::GetCubemap(const std::vector<std::string> &faces) {
+    std::string key = TextureLoader::Get().GetFlipOnLoad() ? "flip" : "";
+    for (const std::string &face : faces) key += "|" + face;
+    return Acquire(cubemaps, key, [&]() { return std::make_shared<Cubemap>(faces); });
+}
+
+std::shared_ptr<Shader> ResourceManager::GetShader(const std::string &vertexPath, const std::string &fragmentPath,
+                                                   const ShaderPreprocessor::Defines &defines) {
+    std::string key = vertexPath + "|" + fragmentPath + "|" + ShaderPreprocessor::DefinesKey(defines);
+    return Acquire(shaders, key, [&]() {
+        return std::make_shared<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines);
+    });
+}
+
+std::shared_ptr<Shader> ResourceManager::GetShader(const std::string &vertexPath, const std::string &fragmentPath,
+                                                   const ShaderPreprocessor::Defines &defines, const Shader::Source &source) {
+    std::string key = vertexPath + "|" + fragmentPath + "|" + ShaderPreprocessor::DefinesKey(defines);
+    return Acquire(shaders, key, [&]() { return std::make_shared<Shader>(source); });
+}
+
+std::shared_ptr<Mesh> ResourceManager::GetMesh(const std::string &path) {
+    // the same file uploads differently per vertex layout
+    std::string key = path + "|" + VertexFormat::LayoutName(Mesh::GetDefaultLayout());
+    return Acquire(meshes, key, [&]() { return Model::LoadMesh(path); });
+}
+
+std::shared_ptr<Mesh> ResourceManager::GetMesh(const std::string &path, const MeshData &data) {
+    std::string key = path + "|" + VertexFormat::LayoutName(Mesh::GetDefaultLayout());
+    return Acquire(meshes, key, [&]() { return Model::CreateMesh(data); });
+}
+
+void ResourceManager::WarmUpShaders() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // no attributes enabled, so every vertex lands on the same point and nothing is rasterized
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    GLState::BindVertexArray(vao);
+
+    unsigned int count = 0;
+    for (auto &entry : shaders.entries) {
+        std::shared_ptr<Shader> shader = entry.second.lock();
+        if (!shader) continue;
+        shader->Use();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        count++;
+    }
+
+    GLState::BindVertexArray(0);
+    GLState::ForgetVertexArray(vao);
+    glDeleteVertexArrays(1, &vao);
+    GLState::UseProgram(0);
+    glFinish();
+
+    const ProgramCache::Stats &stats = ProgramCache::GetStats();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Warmed up " << count << " shaders in " << ms << " ms (" << stats.loaded << " from cache, "
+              << stats.compiled << " compiled, " << stats.rejected << " rejected binaries)" << std::endl;
+}
+
+template <typename T>
+void ResourceManager::PrintCache(const char *name, Cache<T> &cache) {
+    std::cout << name << ": " << cache.hits << " hits, " << cache.misses << " loads" << std::endl;
+    for (auto &entry : cache.entries) {
+        long references = entry.second.use_count();
+        if (references > 0) std::cout << "  " << entry.first << " (" << references << " refs)" << std::endl;
+    }
+}
+
+void ResourceManager::PrintStats() {
+    PrintCache("Textures", textures);
+    PrintCache("Cubemaps", cubemaps);
+    PrintCache("Shaders", shaders);
+    PrintCache("Meshes", meshes);
+}
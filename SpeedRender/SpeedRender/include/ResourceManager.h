@@ -0,0 +1,59 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Texture.h"
+#include "Cubemap.h"
+#include "Shader.h"
+#include "Mesh.h"
+
+// Central cache of GPU resources keyed by their source paths and load parameters. Every asset is loaded
+// once and handed out as a shared handle, its GL objects are freed when the last handle goes away.
+// GL thread only.
+struct MeshData;
+
+class ResourceManager {
+public:
+    static std::shared_ptr<Texture> GetTexture(const std::string &path, const std::string &type = "diffuse");
+    static std::shared_ptr<Cubemap> GetCubemap(const std::vector<std::string> &faces);
+    // every distinct define set is its own permutation, compiled the first time it is asked for
+    static std::shared_ptr<Shader> GetShader(const std::string &vertexPath, const std::string &fragmentPath,
+                                             const ShaderPreprocessor::Defines &defines = {});
+    // same, but links source the caller already ran through Shader::Preprocess when the permutation isn't resident
+    static std::shared_ptr<Shader> GetShader(const std::string &vertexPath, const std::string &fragmentPath,
+                                             const ShaderPreprocessor::Defines &defines, const Shader::Source &source);
+    static std::shared_ptr<Mesh> GetMesh(const std::string &path);
+    // same, but uploads data the caller already loaded with Model::LoadMeshData when path isn't resident
+    static std::shared_ptr<Mesh> GetMesh(const std::string &path, const MeshData &data);
+
+    // Drivers often finish compiling a program on its first draw rather than at link time. This issues a
+    // degenerate draw with every live shader so that cost is paid before the first frame.
+    static void WarmUpShaders();
+
+    // hit/miss counters and the reference count of every live resource
+    static void PrintStats();
+
+private:
+    template <typename T>
+    struct Cache {
+        std::unordered_map<std::string, std::weak_ptr<T>> entries;
+        size_t hits = 0, misses = 0;
+    };
+
+    template <typename T, typename Load>
+    static std::shared_ptr<T> Acquire(Cache<T> &cache, const std::string &key, Load load);
+
+    template <typename T>
+    static void PrintCache(const char *name, Cache<T> &cache);
+
+    static Cache<Texture> textures;
+    static Cache<Cubemap> cubemaps;
+    static Cache<Shader> shaders;
+    static Cache<Mesh> meshes;
+};
+
+#endif
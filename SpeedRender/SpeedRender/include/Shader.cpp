@@ -1,40 +1,57 @@
 #include "Shader.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "GLState.h"
+#include "Hash.h"
+#include "ProgramCache.h"
+#include "UniformBlocks.h"
+
+namespace {
+    Shader::UniformStats uniformStats;
+
+    uint64_t NameHash(std::string_view name) {
+        return Hash::Fnv1a(name.data(), name.size());
+    }
+
+    // error lines refer to files by source string number, list which is which
+    std::string SourceNames(const std::vector<std::string> &files) {
+        std::string names;
+        for (size_t i = 0; i < files.size(); i++) names += "  " + std::to_string(i) + ": " + files[i] + "\n";
+        return names;
+    }
+}
+
 Shader::Shader() {}
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    } catch (std::ifstream::failure e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderPreprocessor::Defines &defines)
+    : Shader(Preprocess(vertexPath, fragmentPath, defines)) {}
+
+Shader::Source Shader::Preprocess(const std::string &vertexPath, const std::string &fragmentPath, const ShaderPreprocessor::Defines &defines) {
+    // 1. retrieve the vertex/fragment source code from filePath, with includes and defines expanded
+    Source source;
+    ShaderPreprocessor::Process(vertexPath, defines, source.vertexCode, source.vertexFiles);
+    ShaderPreprocessor::Process(fragmentPath, defines, source.fragmentCode, source.fragmentFiles);
+    return source;
+}
+
+Shader::Shader(const Source &source) {
+    const std::string &vertexCode = source.vertexCode, &fragmentCode = source.fragmentCode;
+    const std::vector<std::string> &vertexFiles = source.vertexFiles, &fragmentFiles = source.fragmentFiles;
+
+    // 2. reuse the program binary from a previous run if the sources and driver are unchanged
+    ID = glCreateProgram();
+    uint64_t cacheKey = ProgramCache::Key(vertexCode, fragmentCode);
+    if (ProgramCache::Load(cacheKey, ID)) {
+        ReflectUniforms();
+        return;
     }
 
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    // 2. compile shaders
+    // 3. compile shaders
     unsigned int vertex, fragment;
     int success;
     char infoLog[512];
@@ -47,7 +64,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
     if(!success) {
         glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << SourceNames(vertexFiles) << std::endl;
     };
 
     // fragment Shader
@@ -58,19 +75,22 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
     if(!success) {
         glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << SourceNames(fragmentFiles) << std::endl;
     };
 
     // shader Program
-    ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    ProgramCache::PrepareForStore(ID);
     glLinkProgram(ID);
     // print linking errors if any
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
     if(!success) {
         glGetProgramInfoLog(ID, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    } else {
+        ProgramCache::Store(cacheKey, ID);
+        ReflectUniforms();
     }
       
     // delete the shaders as they're linked into our program now and no longer necessary
@@ -78,26 +98,128 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glDeleteShader(fragment);
 }
 
+Shader::~Shader() {
+    GLState::ForgetProgram(ID);
+    glDeleteProgram(ID);
+}
+
 void Shader::Use() const { 
-    glUseProgram(ID);
+    GLState::UseProgram(ID);
+    GLState::SetDepthTest(depthTest);
+    GLState::SetDepthWrite(depthWrite);
+    GLState::SetDepthFunc(depthFunc);
+    GLState::SetBlend(blend);
+    if (blend) GLState::SetBlendFunc(blendSource, blendDestination);
+    GLState::SetCullFace(cullFace);
+    GLState::SetPolygonMode(polygonMode);
 }  
 
-void Shader::SetBool(const std::string &name, bool value) const {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+void Shader::ReflectUniforms() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // arrays are listed once as "name[0]", each element has its own location
+        bool isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        std::string base = isArray ? name.substr(0, name.size() - 3) : name;
+        for (GLint element = 0; element < (isArray ? size : 1); element++) {
+            std::string elementName = isArray ? base + "[" + std::to_string(element) + "]" : name;
+            GLint location = glGetUniformLocation(ID, elementName.c_str());
+            // members of uniform blocks have none
+            if (location < 0) continue;
+
+            uniforms.push_back({ location, 0, {} });
+            slots.push_back({ NameHash(elementName), elementName, (uint32_t)uniforms.size() - 1 });
+            if (isArray && element == 0) slots.push_back({ NameHash(base), base, (uint32_t)uniforms.size() - 1 });
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [](const Slot &a, const Slot &b) { return a.hash < b.hash; });
+
+    // GLSL 3.30 can't give blocks a binding itself, the buffers are bound by UniformBuffer
+    GLint blockCount = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    buffer.resize(std::max(maxLength, 1));
+    for (GLint i = 0; i < blockCount; i++) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(ID, i, (GLsizei)buffer.size(), &length, buffer.data());
+        std::string_view name(buffer.data(), length);
+
+        unsigned int binding;
+        size_t size;
+        if (!UniformBlocks::Find(name, binding, size)) {
+            std::cout << "ERROR::SHADER::UNKNOWN_UNIFORM_BLOCK " << name << std::endl;
+            continue;
+        }
+        GLint dataSize = 0;
+        glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+        if ((size_t)dataSize != size)
+            std::cout << "ERROR::SHADER::UNIFORM_BLOCK_SIZE " << name << " is " << dataSize << " bytes, expected " << size << std::endl;
+        glUniformBlockBinding(ID, i, binding);
+    }
+}
+
+int Shader::Update(std::string_view name, const void *value, unsigned int size) const {
+    uint64_t hash = NameHash(name);
+    auto it = std::lower_bound(slots.begin(), slots.end(), hash, [](const Slot &slot, uint64_t value) { return slot.hash < value; });
+    for (; it != slots.end() && it->hash == hash && it->name != name; ++it) {}
+    if (it == slots.end() || it->hash != hash) {
+        uniformStats.inactive++;
+        return -1;
+    }
+
+    Uniform &uniform = uniforms[it->uniform];
+    if (uniform.size == size && memcmp(uniform.value, value, size) == 0) {
+        uniformStats.skipped++;
+        return -1;
+    }
+    memcpy(uniform.value, value, size);
+    uniform.size = size;
+    uniformStats.issued++;
+    return uniform.location;
 }
 
-void Shader::SetInt(const std::string &name, int value) const { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+void Shader::SetBool(std::string_view name, bool value) const {
+    SetInt(name, (int)value);
 }
 
-void Shader::SetFloat(const std::string &name, float value) const { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
-} 
+void Shader::SetInt(std::string_view name, int value) const {
+    int location = Update(name, &value, sizeof(value));
+    if (location >= 0) glUniform1i(location, value);
+}
+
+void Shader::SetFloat(std::string_view name, float value) const {
+    int location = Update(name, &value, sizeof(value));
+    if (location >= 0) glUniform1f(location, value);
+}
+
+void Shader::SetMat4(std::string_view name, const glm::mat4 &value) const {
+    int location = Update(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::SetVec2(std::string_view name, const glm::vec2 &value) const {
+    int location = Update(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniform2f(location, value.x, value.y);
+}
+
+void Shader::SetVec3(std::string_view name, const glm::vec3 &value) const {
+    int location = Update(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniform3f(location, value.x, value.y, value.z);
+}
 
-void Shader::SetMat4(const std::string& name, const glm::mat4 &value) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()) , 1, GL_FALSE, glm::value_ptr(value));
+const Shader::UniformStats &Shader::GetUniformStats() {
+    return uniformStats;
 }
 
-void Shader::SetVec3(const std::string& name, const glm::vec3 &value) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z);
+void Shader::ResetUniformStats() {
+    uniformStats = UniformStats();
 }
@@ -7,30 +7,95 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
   
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 #include <GLFW/glfw3.h>
+
+#include "ShaderPreprocessor.h"
   
+// A linked program plus a table of its active uniforms, read once after linking. The setters find a uniform
+// there instead of asking glGetUniformLocation and keep the value they last uploaded, so setting a uniform
+// to what it already holds costs no GL call. The program has to be in use, as with plain glUniform*.
+// Uniform blocks are bound to their binding points in UniformBlocks.h once, values there are shared.
 class Shader {
 public:
+    // setter calls since the last ResetUniformStats, all programs together
+    struct UniformStats {
+        unsigned int issued = 0;    // reached GL
+        unsigned int skipped = 0;   // same value as the last upload
+        unsigned int inactive = 0;  // not an active uniform of the program, e.g. optimized out
+    };
+
+    // both stages with includes and defines expanded, the part of building a program that needs no GL
+    struct Source {
+        std::string vertexCode, fragmentCode;
+        std::vector<std::string> vertexFiles, fragmentFiles;
+    };
+
     Shader();
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // defines specialize both stages, see ShaderPreprocessor
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderPreprocessor::Defines &defines = {});
+    // links source from Preprocess, e.g. when that ran on a worker
+    explicit Shader(const Source &source);
+    ~Shader();
 
+    // owns the GL program, share it through ResourceManager instead of copying
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
+    // makes the program current along with the render state below
     void Use() const;
 
-    void SetBool(const std::string &name, bool value) const;  
-    void SetInt(const std::string &name, int value) const;   
-    void SetFloat(const std::string &name, float value) const;
-    void SetMat4(const std::string &name, const glm::mat4 &value) const;
-    void SetVec3(const std::string& name, const glm::vec3& value) const;
+    void SetBool(std::string_view name, bool value) const;
+    void SetInt(std::string_view name, int value) const;
+    void SetFloat(std::string_view name, float value) const;
+    void SetMat4(std::string_view name, const glm::mat4 &value) const;
+    void SetVec2(std::string_view name, const glm::vec2 &value) const;
+    void SetVec3(std::string_view name, const glm::vec3 &value) const;
+
+    // reads and expands both stages, safe on any thread
+    static Source Preprocess(const std::string &vertexPath, const std::string &fragmentPath, const ShaderPreprocessor::Defines &defines = {});
 
-    unsigned int ID;
+    static const UniformStats &GetUniformStats();
+    // once per frame, so the stats count a single frame
+    static void ResetUniformStats();
+
+    unsigned int ID = 0;
     bool depthTest = true;
     bool depthWrite = true;
     unsigned int depthFunc = GL_LESS;
+    bool blend = false;
+    unsigned int blendSource = GL_SRC_ALPHA, blendDestination = GL_ONE_MINUS_SRC_ALPHA;
+    bool cullFace = false;
+    unsigned int polygonMode = GL_FILL;
+
+private:
+    // one active uniform, arrays get an entry per element
+    struct Uniform {
+        int location;
+        unsigned int size = 0;      // bytes of value in use, 0 until the first upload
+        float value[16];            // the last upload, a mat4 at most
+    };
+
+    // names hashed and sorted, an array's bare name is an alias of its first element
+    struct Slot {
+        uint64_t hash;
+        std::string name;
+        uint32_t uniform;
+    };
+
+    void ReflectUniforms();
+    // the location to upload value to, or -1 if the uniform is inactive or already holds it
+    int Update(std::string_view name, const void *value, unsigned int size) const;
+
+    mutable std::vector<Uniform> uniforms;
+    std::vector<Slot> slots;
 };
   
 #endif
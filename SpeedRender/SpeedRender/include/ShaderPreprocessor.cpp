@@ -0,0 +1,132 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "AssetPack.h"
+#include "CookedAssets.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool ReadFile(const std::string &path, std::string &contents) {
+        std::unique_ptr<MappedFile> packed = AssetPack::Global().Find(path);
+        if (packed) {
+            contents.assign((const char*)packed->Data(), packed->Size());
+            return true;
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+        return true;
+    }
+
+    // the quoted file name if line is an #include directive
+    bool ParseInclude(const std::string &line, std::string &name) {
+        size_t hash = line.find_first_not_of(" \t");
+        if (hash == std::string::npos || line.compare(hash, 8, "#include") != 0) return false;
+
+        size_t open = line.find('"', hash + 8), close = line.find('"', open + 1);
+        if (open == std::string::npos || close == std::string::npos) return false;
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    bool IsVersion(const std::string &line) {
+        size_t hash = line.find_first_not_of(" \t");
+        return hash != std::string::npos && line.compare(hash, 8, "#version") == 0;
+    }
+
+    struct Context {
+        const ShaderPreprocessor::Defines &defines;
+        std::vector<std::string> &files;
+        std::string &out;
+    };
+
+    bool Expand(Context &context, const std::string &path) {
+        std::string normalized = fs::path(path).lexically_normal().generic_string();
+        if (std::find(context.files.begin(), context.files.end(), normalized) != context.files.end()) return true;
+
+        std::string source;
+        if (!ReadFile(normalized, source)) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << normalized << std::endl;
+            return false;
+        }
+
+        int sourceNumber = (int)context.files.size();
+        context.files.push_back(normalized);
+        if (sourceNumber > 0) context.out += "#line 1 " + std::to_string(sourceNumber) + "\n";
+
+        std::istringstream lines(source);
+        std::string line, include;
+        for (int lineNumber = 1; std::getline(lines, line); lineNumber++) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            if (ParseInclude(line, include)) {
+                std::string includePath = (fs::path(normalized).parent_path() / include).generic_string();
+                if (!Expand(context, includePath)) return false;
+                context.out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+                continue;
+            }
+
+            context.out += line;
+            context.out += '\n';
+
+            // defines have to come after #version, which must be the first statement of the shader
+            if (sourceNumber == 0 && IsVersion(line)) {
+                for (const std::string &define : context.defines)
+                    if (!define.empty()) context.out += "#define " + define + "\n";
+                context.out += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+            }
+        }
+        return true;
+    }
+}
+
+bool ShaderPreprocessor::Process(const std::string &path, const Defines &defines, std::string &out, std::vector<std::string> &files) {
+    out.clear();
+    files.clear();
+
+    // the cooked form has every include pasted in already, only the defines are left to add
+    const CookedAssets::Entry *cooked = nullptr;
+    std::string cookedPath = CookedAssets::Find(path, ".glsl", &cooked);
+    std::string source;
+    if (!cookedPath.empty() && ReadFile(cookedPath, source)) {
+        for (const CookedAssets::Input &input : cooked->inputs) files.push_back(input.path);
+
+        std::istringstream lines(source);
+        std::string line;
+        bool injected = false;
+        while (std::getline(lines, line)) {
+            out += line;
+            out += '\n';
+            if (!injected && IsVersion(line)) {
+                for (const std::string &define : defines)
+                    if (!define.empty()) out += "#define " + define + "\n";
+                injected = true;
+            }
+        }
+        return true;
+    }
+
+    Context context = { defines, files, out };
+    return Expand(context, path);
+}
+
+std::string ShaderPreprocessor::DefinesKey(const Defines &defines) {
+    Defines sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+    std::string key;
+    for (const std::string &define : sorted) {
+        if (define.empty()) continue;
+        key += define;
+        key += ';';
+    }
+    return key;
+}
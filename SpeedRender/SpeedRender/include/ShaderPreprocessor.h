@@ -0,0 +1,23 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+
+// Expands the bits of GLSL the driver doesn't handle for us: #include of shared chunks and per variant
+// defines, so one source file can be specialized into many programs.
+namespace ShaderPreprocessor {
+    // each entry is "NAME" or "NAME VALUE"
+    typedef std::vector<std::string> Defines;
+
+    // Reads path, injects defines right after #version and replaces every #include "file" line with the
+    // file's contents. Includes resolve relative to the including file and every file is pasted at most
+    // once, so chunks can include each other freely. files receives the path behind each source string
+    // number used in the emitted #line directives, for error messages.
+    bool Process(const std::string &path, const Defines &defines, std::string &out, std::vector<std::string> &files);
+
+    // Defines in a canonical order, for permutation cache keys
+    std::string DefinesKey(const Defines &defines);
+}
+
+#endif
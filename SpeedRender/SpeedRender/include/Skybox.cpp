@@ -1,4 +1,6 @@
 #include "Skybox.h"
+#include "GLState.h"
+#include "ResourceManager.h"
 
 std::vector<float> skyboxVertices = {
     // positions          
@@ -46,40 +48,40 @@ std::vector<float> skyboxVertices = {
 };
 
 Skybox::Skybox(const std::vector<std::string>& faces) {
-    cubemap = new Cubemap(faces);
-    shader = new Shader("assets/shaders/Skybox.vert", "assets/shaders/Skybox.frag");
+    cubemap = ResourceManager::GetCubemap(faces);
+    shader = ResourceManager::GetShader("assets/shaders/Skybox.vert", "assets/shaders/Skybox.frag");
+    // drawn last at the far plane, where the cleared depth is
+    shader->depthFunc = GL_LEQUAL;
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
   
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::BindVertexArray(VAO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
 
     glBufferData(GL_ARRAY_BUFFER, skyboxVertices.size() * sizeof(float), &skyboxVertices[0], GL_STATIC_DRAW);  
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
-void Skybox::Draw(glm::mat4 v, glm::mat4 p) {
-    v = glm::mat4(glm::mat3(v));  
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE); 
-    glDepthFunc(GL_LEQUAL);
+Skybox::~Skybox() {
+    GLState::ForgetVertexArray(VAO);
+    GLState::ForgetBuffer(VBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap->id);
+void Skybox::Draw() {
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, cubemap->id);
 
     // skybox uniforms
     shader->Use();
-    shader->SetMat4("view", v);
-    shader->SetMat4("projection", p);
     shader->SetInt("skybox", 0);
+    shader->SetBool("hdr", cubemap->hdr);
 
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
 }
@@ -1,6 +1,7 @@
 #ifndef SKYBOX_H
 #define SKYBOX_H
 
+#include <memory>
 #include <vector>
 
 #include "Shader.h"
@@ -9,11 +10,17 @@
 class Skybox {
 public:
     Skybox(const std::vector<std::string>& faces);
-	void Draw(glm::mat4 v, glm::mat4 p);
+    ~Skybox();
+
+    Skybox(const Skybox&) = delete;
+    Skybox &operator=(const Skybox&) = delete;
+
+	// camera from the Frame block
+	void Draw();
 private:
 	unsigned int VAO, VBO;
-	Cubemap *cubemap;
-	Shader* shader;
+	std::shared_ptr<Cubemap> cubemap;
+	std::shared_ptr<Shader> shader;
 };
 
 #endif
\ No newline at end of file
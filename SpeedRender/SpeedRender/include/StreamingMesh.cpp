@@ -0,0 +1,389 @@
+#include "StreamingMesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "GLState.h"
+#include "ThreadPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'S', 'T' };
+    const uint32_t NO_VERTEX = ~0u;
+
+    uint64_t AlignUp(uint64_t offset) {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+
+    // frustum planes (Gribb & Hartmann), normalized so they measure distances
+    void ExtractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]) {
+        glm::mat4 m = glm::transpose(viewProjection);
+        planes[0] = m[3] + m[0]; planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1]; planes[3] = m[3] - m[1];
+        planes[4] = m[3] + m[2]; planes[5] = m[3] - m[2];
+        for (int i = 0; i < 6; i++) planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+
+    // true if the box lies completely behind one of the planes, tested with its corner furthest along the plane
+    bool IsOutside(const glm::vec4 planes[6], const StreamingMesh::Chunk &chunk) {
+        for (int i = 0; i < 6; i++) {
+            glm::vec3 corner(planes[i].x >= 0.0f ? chunk.boundsMax[0] : chunk.boundsMin[0],
+                             planes[i].y >= 0.0f ? chunk.boundsMax[1] : chunk.boundsMin[1],
+                             planes[i].z >= 0.0f ? chunk.boundsMax[2] : chunk.boundsMin[2]);
+            if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f) return true;
+        }
+        return false;
+    }
+
+    float Distance(const StreamingMesh::Chunk &chunk, const glm::vec3 &eye) {
+        glm::vec3 min(chunk.boundsMin[0], chunk.boundsMin[1], chunk.boundsMin[2]);
+        glm::vec3 max(chunk.boundsMax[0], chunk.boundsMax[1], chunk.boundsMax[2]);
+        return glm::length(glm::max(glm::max(min - eye, eye - max), glm::vec3(0.0f)));
+    }
+
+    bool ReadChunk(const std::string &path, const StreamingMesh::Chunk &chunk, std::vector<unsigned char> &data) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.seekg(chunk.offset) || !file.read((char*)data.data(), data.size())) return false;
+
+        // a bad index would read outside the chunk's slot, into its neighbour's vertices
+        const uint16_t *indices = (const uint16_t*)(data.data() + chunk.vertexCount * sizeof(Vertex));
+        for (uint32_t i = 0; i < chunk.indexCount; i++)
+            if (indices[i] >= chunk.vertexCount) return false;
+        return true;
+    }
+}
+
+StreamingMesh::Writer::Writer(const std::string &path, const AABB &bounds, bool hasNormals, bool hasUVs)
+    : path(path), tempPath(path + ".tmp"), out(new std::ofstream(path + ".tmp", std::ios::binary | std::ios::trunc)) {
+    header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (hasNormals ? FLAG_NORMALS : 0) | (hasUVs ? FLAG_UVS : 0);
+    memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+
+    // filled in again by Finish once the chunk table's place is known
+    failed = !out->write((const char*)&header, sizeof(Header));
+    offset = sizeof(Header);
+}
+
+StreamingMesh::Writer::~Writer() {
+    if (out) {
+        out.reset();
+        std::error_code ec;
+        fs::remove(tempPath, ec);
+    }
+}
+
+bool StreamingMesh::Writer::AddCell(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices) {
+    // triangles stay in order, each chunk takes the vertices its triangles use in the order they are first used
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<unsigned int> used;
+    std::vector<Vertex> chunkVertices;
+    std::vector<uint16_t> chunkIndices;
+
+    for (size_t i = 0; i + 2 < indices.size() && !failed; i += 3) {
+        size_t added = 0;
+        for (int k = 0; k < 3; k++) added += remap[indices[i + k]] == NO_VERTEX;
+
+        if (chunkVertices.size() + added > CHUNK_VERTICES || chunkIndices.size() + 3 > CHUNK_INDICES) {
+            failed = !WriteChunk(chunkVertices, chunkIndices);
+            for (unsigned int vertex : used) remap[vertex] = NO_VERTEX;
+            used.clear();
+            chunkVertices.clear();
+            chunkIndices.clear();
+        }
+
+        for (int k = 0; k < 3; k++) {
+            unsigned int vertex = indices[i + k];
+            if (remap[vertex] == NO_VERTEX) {
+                remap[vertex] = (uint32_t)chunkVertices.size();
+                chunkVertices.push_back(vertices[vertex]);
+                used.push_back(vertex);
+            }
+            chunkIndices.push_back((uint16_t)remap[vertex]);
+        }
+    }
+
+    if (!chunkIndices.empty() && !failed) failed = !WriteChunk(chunkVertices, chunkIndices);
+    return !failed;
+}
+
+bool StreamingMesh::Writer::WriteChunk(const std::vector<Vertex> &vertices, const std::vector<uint16_t> &indices) {
+    static const char zeros[16] = {};
+    uint64_t start = AlignUp(offset);
+    out->write(zeros, start - offset);
+
+    Chunk chunk = {};
+    AABB chunkBounds = Mesh::ComputeBounds(vertices.data(), vertices.size());
+    memcpy(chunk.boundsMin, &chunkBounds.min, sizeof(chunk.boundsMin));
+    memcpy(chunk.boundsMax, &chunkBounds.max, sizeof(chunk.boundsMax));
+    chunk.vertexCount = (uint32_t)vertices.size();
+    chunk.indexCount = (uint32_t)indices.size();
+    chunk.offset = start;
+    chunks.push_back(chunk);
+
+    out->write((const char*)vertices.data(), vertices.size() * sizeof(Vertex));
+    out->write((const char*)indices.data(), indices.size() * sizeof(uint16_t));
+    offset = start + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint16_t);
+    return (bool)*out;
+}
+
+bool StreamingMesh::Writer::Finish() {
+    if (!out || failed) return false;
+
+    static const char zeros[16] = {};
+    uint64_t tableOffset = AlignUp(offset);
+    out->write(zeros, tableOffset - offset);
+    out->write((const char*)chunks.data(), chunks.size() * sizeof(Chunk));
+
+    header.chunkCount = (uint32_t)chunks.size();
+    header.chunkOffset = tableOffset;
+    out->seekp(0);
+    out->write((const char*)&header, sizeof(Header));
+    bool ok = (bool)*out;
+    out.reset();
+
+    std::error_code ec;
+    if (ok) fs::rename(tempPath, path, ec);
+    if (!ok || ec) fs::remove(tempPath, ec);
+    return ok && !ec;
+}
+
+StreamingMesh::StreamingMesh(const std::string &path, size_t vramBudget) : path(path) {
+    std::ifstream file(path, std::ios::binary);
+    Header header;
+    if (!file.read((char*)&header, sizeof(Header))) {
+        std::cout << "Failed to open streaming mesh " << path << std::endl;
+        return;
+    }
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        std::cout << "ERROR::STREAMING_MESH::VERSION_MISMATCH " << path << std::endl;
+        return;
+    }
+
+    std::error_code ec;
+    uint64_t fileSize = fs::file_size(path, ec);
+    chunks.resize(header.chunkCount);
+    if (ec || header.chunkOffset + (uint64_t)header.chunkCount * sizeof(Chunk) > fileSize ||
+        !file.seekg(header.chunkOffset) || !file.read((char*)chunks.data(), chunks.size() * sizeof(Chunk))) {
+        std::cout << "ERROR::STREAMING_MESH::TRUNCATED " << path << std::endl;
+        chunks.clear();
+        return;
+    }
+
+    for (const Chunk &chunk : chunks) {
+        if (chunk.vertexCount > CHUNK_VERTICES || chunk.indexCount > CHUNK_INDICES || chunk.offset + ChunkBytes(chunk) > fileSize) {
+            std::cout << "ERROR::STREAMING_MESH::CORRUPT " << path << std::endl;
+            chunks.clear();
+            return;
+        }
+        slotVertices = std::max(slotVertices, chunk.vertexCount);
+        slotIndices = std::max(slotIndices, chunk.indexCount);
+    }
+
+    memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+    hasNormals = (header.flags & FLAG_NORMALS) != 0;
+    hasUVs = (header.flags & FLAG_UVS) != 0;
+    states.resize(chunks.size());
+
+    // every slot fits the largest chunk, so any chunk can go into any free slot without fragmenting the pool
+    size_t slotBytes = (size_t)slotVertices * sizeof(Vertex) + (size_t)slotIndices * sizeof(uint16_t);
+    size_t slotCount = slotBytes > 0 ? std::min(chunks.size(), vramBudget / slotBytes) : 0;
+    if (slotCount == 0) {
+        std::cout << "ERROR::STREAMING_MESH::BUDGET_TOO_SMALL " << path << " needs " << slotBytes << " bytes per chunk" << std::endl;
+        return;
+    }
+    slots.assign(slotCount, -1);
+    stats.vramBytes = slotCount * slotBytes;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    GLState::BindVertexArray(VAO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, slotCount * slotVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, slotCount * slotIndices * sizeof(uint16_t), nullptr, GL_DYNAMIC_DRAW);
+
+    // the locations MainVertex.vert declares, attributes the file has no data for stay at their defaults
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    if (hasNormals) {
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    }
+    if (hasUVs) {
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    }
+    GLState::BindVertexArray(0);
+}
+
+StreamingMesh::~StreamingMesh() {
+    // the reads write into their own buffers, but don't leave them running past the object
+    for (uint32_t index : pending)
+        if (states[index].state == State::Loading) states[index].loaded.wait();
+
+    if (VAO) {
+        GLState::ForgetVertexArray(VAO);
+        GLState::ForgetBuffer(VBO);
+        GLState::ForgetBuffer(EBO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+}
+
+size_t StreamingMesh::ChunkBytes(const Chunk &chunk) const {
+    return (size_t)chunk.vertexCount * sizeof(Vertex) + (size_t)chunk.indexCount * sizeof(uint16_t);
+}
+
+void StreamingMesh::Update(const glm::mat4 &viewProjection, const glm::vec3 &eye) {
+    if (!IsOpen()) return;
+    frame++;
+
+    glm::vec4 planes[6];
+    ExtractPlanes(viewProjection, planes);
+
+    // the nearest chunks in view, then the nearest out of it, as many as there are slots
+    ranking.clear();
+    for (uint32_t i = 0; i < chunks.size(); i++) {
+        if (states[i].state == State::Failed) continue;
+        ranking.push_back({ IsOutside(planes, chunks[i]), Distance(chunks[i], eye), i });
+    }
+    size_t wanted = std::min(slots.size(), ranking.size());
+    std::partial_sort(ranking.begin(), ranking.begin() + wanted, ranking.end(), [](const Rank &a, const Rank &b) {
+        return a.outside != b.outside ? b.outside : a.distance < b.distance;
+    });
+    for (size_t i = 0; i < wanted; i++) states[ranking[i].index].lastWanted = frame;
+
+    // reads in order of rank while they fit the budget, always one so a budget below a chunk still moves
+    for (size_t i = 0; i < wanted; i++) {
+        uint32_t index = ranking[i].index;
+        ChunkState &chunk = states[index];
+        if (chunk.state != State::Missing) continue;
+
+        size_t bytes = ChunkBytes(chunks[index]);
+        if (stats.ramBytes + bytes > ramBudget && stats.ramBytes > 0) break;
+
+        chunk.state = State::Loading;
+        chunk.data = std::make_shared<std::vector<unsigned char>>(bytes);
+        std::shared_ptr<std::vector<unsigned char>> data = chunk.data;
+        std::string file = path;
+        Chunk range = chunks[index];
+        chunk.loaded = ThreadPool::Global().Submit([file, range, data]() { return ReadChunk(file, range, *data); });
+
+        pending.push_back(index);
+        stats.ramBytes += bytes;
+        stats.peakRamBytes = std::max(stats.peakRamBytes, stats.ramBytes);
+        stats.loads++;
+    }
+
+    // finished reads go into the pool, a chunk nobody wants any more is dropped instead of evicting one that is
+    size_t uploaded = 0;
+    for (size_t i = 0; i < pending.size(); ) {
+        uint32_t index = pending[i];
+        ChunkState &chunk = states[index];
+        if (chunk.state == State::Loading) {
+            if (chunk.loaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                i++;
+                continue;
+            }
+            if (!chunk.loaded.get()) {
+                std::cout << "ERROR::STREAMING_MESH::READ_FAILED " << path << " chunk " << index << std::endl;
+                chunk.state = State::Failed;
+            } else {
+                chunk.state = State::Loaded;
+            }
+        }
+
+        int slot = -1;
+        if (chunk.state == State::Loaded && chunk.lastWanted == frame) {
+            if (uploaded >= uploadBudget || (slot = AcquireSlot()) < 0) {
+                i++;
+                continue;
+            }
+            Upload(index, slot);
+            uploaded += chunk.data->size();
+        } else if (chunk.state == State::Loaded) {
+            chunk.state = State::Missing;
+        }
+
+        stats.ramBytes -= chunk.data->size();
+        chunk.data.reset();
+        pending.erase(pending.begin() + i);
+    }
+
+    stats.loadingChunks = pending.size();
+    stats.residentChunks = (size_t)std::count_if(slots.begin(), slots.end(), [](int chunk) { return chunk >= 0; });
+}
+
+int StreamingMesh::AcquireSlot() {
+    int oldest = -1;
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot] < 0) return (int)slot;
+        const ChunkState &chunk = states[slots[slot]];
+        if (chunk.lastWanted < frame && (oldest < 0 || chunk.lastWanted < states[slots[oldest]].lastWanted)) oldest = (int)slot;
+    }
+    if (oldest < 0) return -1;
+
+    ChunkState &evicted = states[slots[oldest]];
+    evicted.state = State::Missing;
+    evicted.slot = -1;
+    slots[oldest] = -1;
+    stats.evictions++;
+    return oldest;
+}
+
+void StreamingMesh::Upload(uint32_t index, int slot) {
+    const Chunk &chunk = chunks[index];
+    ChunkState &state = states[index];
+    size_t vertexBytes = (size_t)chunk.vertexCount * sizeof(Vertex);
+
+    // the element buffer binding belongs to the VAO, bind it first
+    GLState::BindVertexArray(VAO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (size_t)slot * slotVertices * sizeof(Vertex), vertexBytes, state.data->data());
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (size_t)slot * slotIndices * sizeof(uint16_t),
+                    (size_t)chunk.indexCount * sizeof(uint16_t), state.data->data() + vertexBytes);
+
+    state.state = State::Resident;
+    state.slot = slot;
+    slots[slot] = (int)index;
+}
+
+size_t StreamingMesh::Draw(Shader &shader, const glm::mat4 &viewProjection) {
+    stats.trianglesDrawn = 0;
+    if (!IsOpen()) return 0;
+
+    shader.Use();
+
+    // the pool holds plain float vertices, undo whatever a packed mesh left in the dequantization uniforms
+    shader.SetVec3("positionOffset", glm::vec3(0.0f));
+    shader.SetVec3("positionScale", glm::vec3(1.0f));
+    shader.SetVec2("uvOffset", glm::vec2(0.0f));
+    shader.SetVec2("uvScale", glm::vec2(1.0f));
+    shader.SetBool("octNormals", false);
+
+    glm::vec4 planes[6];
+    ExtractPlanes(viewProjection, planes);
+
+    GLState::BindVertexArray(VAO);
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot] < 0) continue;
+        const Chunk &chunk = chunks[slots[slot]];
+        if (IsOutside(planes, chunk)) continue;
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_SHORT,
+                                 (void*)(slot * slotIndices * sizeof(uint16_t)), (GLint)(slot * slotVertices));
+        stats.trianglesDrawn += chunk.indexCount / 3;
+    }
+    return stats.trianglesDrawn;
+}
@@ -0,0 +1,150 @@
+#ifndef STREAMING_MESH_H
+#define STREAMING_MESH_H
+
+#include <cstdint>
+#include <future>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Core.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+// A mesh too large to load whole, e.g. a scan bigger than system memory. A .srstream file cuts it into the
+// cells of a uniform grid and every cell into chunks of at most CHUNK_VERTICES vertices, each with its own
+// vertex block and 16 bit index block, so no part of the mesh ever has to be read with the rest.
+// At runtime the chunks nearest the camera, the ones in view first, are read on the thread pool and copied
+// into a fixed pool of equally sized slots in one vertex and one index buffer. When a nearer chunk needs a
+// slot the least recently wanted one gives it up. GPU memory is the pool, sized once from vramBudget; CPU
+// memory is the chunks being read or waiting for a slot, limited by ramBudget. Neither grows with the mesh.
+class StreamingMesh {
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t CHUNK_VERTICES = 65535;      // local indices are 16 bit
+    static const uint32_t CHUNK_INDICES = 3 * 65536;
+
+    static const uint32_t FLAG_NORMALS = 1 << 0;
+    static const uint32_t FLAG_UVS = 1 << 1;
+
+    struct Header {
+        char     magic[4];      // "SRST"
+        uint32_t version;
+        uint32_t flags;
+        uint32_t chunkCount;
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint64_t chunkOffset;   // chunkCount Chunks, after the data
+    };
+
+    struct Chunk {
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t offset;        // vertexCount Vertex then indexCount uint16_t, 16 byte aligned
+    };
+
+    // Writes a .srstream one cell at a time, so only the current cell is ever in memory
+    class Writer {
+    public:
+        Writer(const std::string &path, const AABB &bounds, bool hasNormals, bool hasUVs);
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        // One cell of the grid with cell local indices, split into as many chunks as it takes
+        bool AddCell(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices);
+        // Appends the chunk table and moves the file into place
+        bool Finish();
+
+        size_t GetChunkCount() const { return chunks.size(); }
+        uint64_t GetBytes() const { return offset; }
+
+    private:
+        bool WriteChunk(const std::vector<Vertex> &vertices, const std::vector<uint16_t> &indices);
+
+        std::string path, tempPath;
+        std::unique_ptr<std::ofstream> out;
+        Header header;
+        std::vector<Chunk> chunks;
+        uint64_t offset = 0;
+        bool failed = false;
+    };
+
+    struct Stats {
+        size_t residentChunks = 0;
+        size_t loadingChunks = 0;       // being read or waiting for a slot
+        size_t loads = 0;
+        size_t evictions = 0;
+        size_t ramBytes = 0;            // held by loadingChunks
+        size_t peakRamBytes = 0;
+        size_t vramBytes = 0;           // the pool, allocated up front
+        size_t trianglesDrawn = 0;
+    };
+
+    // Reads the chunk table and allocates the pool, as many slots of the largest chunk as fit into vramBudget.
+    // Needs a GL context.
+    StreamingMesh(const std::string &path, size_t vramBudget = 256 * 1024 * 1024);
+    ~StreamingMesh();
+
+    StreamingMesh(const StreamingMesh &) = delete;
+    StreamingMesh &operator=(const StreamingMesh &) = delete;
+
+    bool IsOpen() const { return VAO != 0; }
+    const AABB &GetBounds() const { return bounds; }
+    size_t GetChunkCount() const { return chunks.size(); }
+    size_t GetSlotCount() const { return slots.size(); }
+    const Stats &GetStats() const { return stats; }
+
+    // Once per frame on the GL thread, before Draw: ranks the chunks, starts reads for the nearest missing
+    // ones and copies finished reads into the pool, at most uploadBudget bytes
+    void Update(const glm::mat4 &viewProjection, const glm::vec3 &eye);
+
+    // Draws the resident chunks inside the frustum, the caller sets the shader's matrices
+    size_t Draw(Shader &shader, const glm::mat4 &viewProjection);
+
+    size_t ramBudget = 64 * 1024 * 1024;
+    size_t uploadBudget = 16 * 1024 * 1024;
+
+private:
+    enum class State { Missing, Loading, Loaded, Resident, Failed };
+
+    struct ChunkState {
+        State state = State::Missing;
+        int slot = -1;
+        uint64_t lastWanted = 0;
+        std::shared_ptr<std::vector<unsigned char>> data;
+        std::future<bool> loaded;
+    };
+
+    struct Rank {
+        bool outside;       // of the frustum, ranked after everything inside
+        float distance;
+        uint32_t index;
+    };
+
+    size_t ChunkBytes(const Chunk &chunk) const;
+    int AcquireSlot();
+    void Upload(uint32_t index, int slot);
+
+    std::string path;
+    AABB bounds;
+    std::vector<Chunk> chunks;
+    std::vector<ChunkState> states;
+    std::vector<int> slots;                 // chunk in each slot, -1 if free
+    std::vector<uint32_t> pending;          // chunks Loading or Loaded
+    std::vector<Rank> ranking;
+    uint32_t slotVertices = 0, slotIndices = 0;
+    bool hasNormals = false, hasUVs = false;
+    uint64_t frame = 0;
+    Stats stats;
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+};
+
+#endif
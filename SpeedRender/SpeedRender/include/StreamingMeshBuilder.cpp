@@ -0,0 +1,283 @@
+#include "StreamingMeshBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "StreamingMesh.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+    inline const char *SkipBlanks(const char *p, const char *end) {
+        while (p < end && IsBlank(*p)) p++;
+        return p;
+    }
+
+    inline const char *NextLine(const char *p, const char *end) {
+        while (p < end && *p != '\n') p++;
+        return p < end ? p + 1 : end;
+    }
+
+    inline const char *ParseFloats(const char *p, const char *end, float *values, int count) {
+        for (int i = 0; i < count; i++) {
+            p = SkipBlanks(p, end);
+            if (p < end && *p == '+') p++;
+            std::from_chars_result r = std::from_chars(p, end, values[i]);
+            if (r.ec != std::errc()) values[i] = 0.0f;
+            p = r.ptr;
+        }
+        return p;
+    }
+
+    // one based, negative counts back from the last element seen so far; false if missing or out of range
+    inline bool ParseIndex(const char *&p, const char *end, uint64_t seen, uint64_t &index) {
+        long long value = 0;
+        std::from_chars_result r = std::from_chars(p, end, value);
+        if (r.ec != std::errc() || value == 0) return false;
+        p = r.ptr;
+        long long resolved = value < 0 ? (long long)seen + value : value - 1;
+        if (resolved < 0 || (uint64_t)resolved >= seen) return false;
+        index = (uint64_t)resolved;
+        return true;
+    }
+
+    // a scratch array of floats written while scanning and mapped for the faces
+    struct Scratch {
+        std::string path;
+        std::ofstream out;
+        std::unique_ptr<MappedFile> mapped;
+        uint64_t count = 0;
+
+        Scratch(const std::string &path) : path(path), out(path, std::ios::binary | std::ios::trunc) {}
+        ~Scratch() {
+            mapped.reset();
+            if (out.is_open()) out.close();
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+
+        const float *Map() {
+            out.close();
+            if (count == 0) return nullptr;
+            mapped.reset(new MappedFile(path));
+            return mapped->IsOpen() ? (const float*)mapped->Data() : nullptr;
+        }
+    };
+}
+
+StreamingMeshBuilder::StreamingMeshBuilder(const std::string &path, const AABB &bounds, bool hasNormals, bool hasUVs,
+                                           unsigned int cellsPerAxis, size_t memoryBudget)
+    : path(path), spillPath(path + ".spill"), bounds(bounds), hasNormals(hasNormals), hasUVs(hasUVs), memoryBudget(memoryBudget) {
+    // cubic cells, cellsPerAxis along the longest side
+    glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+    float side = std::max(extent.x, std::max(extent.y, extent.z)) / std::max(cellsPerAxis, 1u);
+    for (int axis = 0; axis < 3; axis++)
+        grid[axis] = std::min(std::max((unsigned int)std::ceil(extent[axis] / side), 1u), std::max(cellsPerAxis, 1u));
+    cellSize = extent / glm::vec3(grid);
+
+    cells.resize((size_t)grid.x * grid.y * grid.z);
+    spans.resize(cells.size());
+}
+
+StreamingMeshBuilder::~StreamingMeshBuilder() {
+    spill.reset();
+    std::error_code ec;
+    fs::remove(spillPath, ec);
+}
+
+unsigned int StreamingMeshBuilder::CellOf(const glm::vec3 &point) const {
+    glm::ivec3 cell = glm::ivec3(glm::floor((point - bounds.min) / cellSize));
+    cell = glm::clamp(cell, glm::ivec3(0), glm::ivec3(grid) - 1);
+    return (unsigned int)(cell.x + grid.x * (cell.y + grid.y * cell.z));
+}
+
+void StreamingMeshBuilder::AddTriangle(const Vertex &a, const Vertex &b, const Vertex &c) {
+    std::vector<Vertex> &cell = cells[CellOf((a.position + b.position + c.position) / 3.0f)];
+    cell.push_back(a);
+    cell.push_back(b);
+    cell.push_back(c);
+    bufferedBytes += 3 * sizeof(Vertex);
+    triangleCount++;
+
+    if (bufferedBytes > memoryBudget && !failed) failed = !Spill();
+}
+
+bool StreamingMeshBuilder::Spill() {
+    if (!spill) spill.reset(new std::ofstream(spillPath, std::ios::binary | std::ios::trunc));
+
+    for (size_t i = 0; i < cells.size(); i++) {
+        std::vector<Vertex> &cell = cells[i];
+        if (cell.empty()) continue;
+
+        spans[i].push_back({ spillBytes, cell.size() / 3 });
+        spill->write((const char*)cell.data(), cell.size() * sizeof(Vertex));
+        spillBytes += cell.size() * sizeof(Vertex);
+        std::vector<Vertex>().swap(cell);
+    }
+    bufferedBytes = 0;
+    return (bool)*spill;
+}
+
+bool StreamingMeshBuilder::Finish() {
+    if (failed) return false;
+
+    std::unique_ptr<std::ifstream> spilled;
+    if (spill) {
+        spill.reset();
+        spilled.reset(new std::ifstream(spillPath, std::ios::binary));
+    }
+
+    StreamingMesh::Writer writer(path, bounds, hasNormals, hasUVs);
+    for (size_t i = 0; i < cells.size(); i++) {
+        // the cell's triangles in the order they were added, spilled ones first
+        std::vector<Vertex> corners;
+        for (const Span &span : spans[i]) {
+            size_t start = corners.size();
+            corners.resize(start + span.triangleCount * 3);
+            if (!spilled->seekg(span.offset) || !spilled->read((char*)(corners.data() + start), span.triangleCount * 3 * sizeof(Vertex))) {
+                std::cout << "Failed to read " << spillPath << std::endl;
+                return false;
+            }
+        }
+        corners.insert(corners.end(), cells[i].begin(), cells[i].end());
+        std::vector<Vertex>().swap(cells[i]);
+        if (corners.empty()) continue;
+
+        std::vector<unsigned int> indices(corners.size());
+        for (size_t k = 0; k < indices.size(); k++) indices[k] = (unsigned int)k;
+        MeshOptimizer::WeldVertices(corners, indices);
+        MeshOptimizer::OptimizeVertexCache(indices, corners.size());
+
+        if (!writer.AddCell(corners, indices)) return false;
+    }
+
+    chunkCount = writer.GetChunkCount();
+    return writer.Finish();
+}
+
+bool StreamingMeshBuilder::ImportObj(const std::string &objPath, const std::string &path, unsigned int cellsPerAxis, size_t memoryBudget) {
+    MappedFile obj(objPath);
+    if (!obj.IsOpen()) {
+        std::cout << "Failed to open " << objPath << std::endl;
+        return false;
+    }
+    const char *begin = (const char*)obj.Data(), *end = begin + obj.Size();
+
+    // first pass: the attribute arrays, out of memory
+    Scratch positions(path + ".v.tmp"), uvs(path + ".vt.tmp"), normals(path + ".vn.tmp");
+    AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (const char *p = begin; p < end; p = NextLine(p, end)) {
+        p = SkipBlanks(p, end);
+        if (end - p < 2) continue;
+
+        float values[3];
+        if (p[0] == 'v' && IsBlank(p[1])) {
+            ParseFloats(p + 1, end, values, 3);
+            positions.out.write((const char*)values, 3 * sizeof(float));
+            positions.count++;
+            bounds.min = glm::min(bounds.min, glm::vec3(values[0], values[1], values[2]));
+            bounds.max = glm::max(bounds.max, glm::vec3(values[0], values[1], values[2]));
+        } else if (p[0] == 'v' && p[1] == 't') {
+            ParseFloats(p + 2, end, values, 2);
+            uvs.out.write((const char*)values, 2 * sizeof(float));
+            uvs.count++;
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            ParseFloats(p + 2, end, values, 3);
+            normals.out.write((const char*)values, 3 * sizeof(float));
+            normals.count++;
+        }
+    }
+    if (!positions.out || !uvs.out || !normals.out) {
+        std::cout << "Failed to write scratch arrays for " << objPath << std::endl;
+        return false;
+    }
+
+    if (positions.count == 0) {
+        std::cout << "No vertices in " << objPath << std::endl;
+        return false;
+    }
+    const float *positionData = positions.Map(), *uvData = uvs.Map(), *normalData = normals.Map();
+    if (!positionData || (uvs.count > 0 && !uvData) || (normals.count > 0 && !normalData)) {
+        std::cout << "Failed to map scratch arrays for " << objPath << std::endl;
+        return false;
+    }
+
+    // second pass: faces, fan triangulated, resolved against what was seen up to them
+    StreamingMeshBuilder builder(path, bounds, normals.count > 0, uvs.count > 0, cellsPerAxis, memoryBudget);
+    uint64_t seenPositions = 0, seenUVs = 0, seenNormals = 0, skipped = 0;
+    for (const char *p = begin; p < end; p = NextLine(p, end)) {
+        p = SkipBlanks(p, end);
+        if (end - p < 2) continue;
+
+        if (p[0] == 'v' && IsBlank(p[1])) seenPositions++;
+        else if (p[0] == 'v' && p[1] == 't') seenUVs++;
+        else if (p[0] == 'v' && p[1] == 'n') seenNormals++;
+        if (p[0] != 'f' || !IsBlank(p[1])) continue;
+
+        Vertex first = {}, previous = {};
+        int corner = 0;
+        bool valid = true;
+        for (p++; valid; corner++) {
+            p = SkipBlanks(p, end);
+            if (p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+
+            // v, v/vt, v//vn or v/vt/vn
+            Vertex vertex = {};
+            uint64_t index;
+            valid = ParseIndex(p, end, seenPositions, index);
+            if (valid) memcpy(&vertex.position, positionData + index * 3, sizeof(vertex.position));
+            if (valid && p < end && *p == '/') {
+                p++;
+                if (p < end && *p != '/') {
+                    valid = ParseIndex(p, end, seenUVs, index);
+                    if (valid) memcpy(&vertex.texCoords, uvData + index * 2, sizeof(vertex.texCoords));
+                }
+                if (valid && p < end && *p == '/') {
+                    p++;
+                    valid = ParseIndex(p, end, seenNormals, index);
+                    if (valid) memcpy(&vertex.normal, normalData + index * 3, sizeof(vertex.normal));
+                }
+            }
+            if (!valid) break;
+
+            if (corner == 0) first = vertex;
+            else if (corner >= 2) builder.AddTriangle(first, previous, vertex);
+            previous = vertex;
+        }
+        if (!valid) skipped++;
+    }
+
+    if (skipped > 0) std::cout << "Skipped " << skipped << " faces with bad indices in " << objPath << std::endl;
+    return builder.Finish();
+}
+
+bool StreamingMeshBuilder::Run(int argc, char **argv) {
+    if (argc < 3 || strcmp(argv[1], "--stream-build") != 0) return false;
+
+    std::string objPath = argv[2];
+    std::string path = argc >= 4 ? argv[3] : fs::path(objPath).replace_extension(".srstream").string();
+    unsigned int cellsPerAxis = argc >= 5 ? (unsigned int)std::max(atoi(argv[4]), 1) : 16;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!ImportObj(objPath, path, cellsPerAxis)) {
+        std::cout << "Failed to build streaming mesh " << path << std::endl;
+        return true;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::error_code ec;
+    std::cout << "Built " << path << ": " << fs::file_size(path, ec) / (1024.0 * 1024.0) << " MB in " << ms << " ms" << std::endl;
+    return true;
+}
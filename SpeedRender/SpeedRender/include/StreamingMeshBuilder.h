@@ -0,0 +1,68 @@
+#ifndef STREAMING_MESH_BUILDER_H
+#define STREAMING_MESH_BUILDER_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Core.h"
+#include "Mesh.h"
+
+// Turns a triangle soup of any size into a .srstream without holding it in memory. Triangles are put into
+// the cell of the grid their centroid falls in and spilled to a scratch file next to the output whenever
+// the cells hold more than memoryBudget. Finish() then welds and writes one cell at a time, so memory peaks
+// at the budget or the largest cell, whichever is bigger; raise cellsPerAxis for very dense meshes.
+class StreamingMeshBuilder {
+public:
+    // bounds has to hold everything that will be added, it fixes the grid
+    StreamingMeshBuilder(const std::string &path, const AABB &bounds, bool hasNormals, bool hasUVs,
+                         unsigned int cellsPerAxis = 16, size_t memoryBudget = 256 * 1024 * 1024);
+    ~StreamingMeshBuilder();
+
+    StreamingMeshBuilder(const StreamingMeshBuilder &) = delete;
+    StreamingMeshBuilder &operator=(const StreamingMeshBuilder &) = delete;
+
+    void AddTriangle(const Vertex &a, const Vertex &b, const Vertex &c);
+    bool Finish();
+
+    size_t GetTriangleCount() const { return triangleCount; }
+    size_t GetChunkCount() const { return chunkCount; }
+
+    // An OBJ of any size to .srstream. Positions, UVs and normals are copied to scratch arrays first, faces
+    // are then resolved against their mappings.
+    static bool ImportObj(const std::string &objPath, const std::string &path, unsigned int cellsPerAxis = 16,
+                          size_t memoryBudget = 256 * 1024 * 1024);
+
+    // --stream-build <file.obj> [out.srstream] [cells per axis], true if argv asked for it
+    static bool Run(int argc, char **argv);
+
+private:
+    // triangles of one cell written to the scratch file in one go
+    struct Span {
+        uint64_t offset;
+        uint64_t triangleCount;
+    };
+
+    unsigned int CellOf(const glm::vec3 &point) const;
+    bool Spill();
+
+    std::string path, spillPath;
+    AABB bounds;
+    glm::vec3 cellSize;
+    glm::uvec3 grid;
+    bool hasNormals, hasUVs;
+    size_t memoryBudget;
+
+    std::vector<std::vector<Vertex>> cells;     // three corners per triangle
+    std::vector<std::vector<Span>> spans;
+    std::unique_ptr<std::ofstream> spill;
+    uint64_t spillBytes = 0;
+    size_t bufferedBytes = 0;
+    size_t triangleCount = 0;
+    size_t chunkCount = 0;
+    bool failed = false;
+};
+
+#endif
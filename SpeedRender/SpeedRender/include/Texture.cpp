@@ -1,13 +1,14 @@
 #include "Texture.h"
+#include "GLState.h"
+#include "TextureLoader.h"
 
 Texture::Texture(std::string filepath, std::string type) {
     glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+    GLState::BindTexture(GL_TEXTURE_2D, id);
 
     this->type = type;
 
     // TODO: wrap and filter parameters
-    // TODO: handle file formats (rgb, rgba, etc.)
 
     //// set the texture wrapping/filtering options (on the currently bound texture object)
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
@@ -15,13 +16,23 @@ Texture::Texture(std::string filepath, std::string type) {
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // load and generate the texture
-    unsigned char *data = stbi_load(filepath.c_str(), &width, &height, &numChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture at " << filepath << std::endl;
-    }
-    stbi_image_free(data);
-}
\ No newline at end of file
+    // white placeholder until the loader has decoded and uploaded the image
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    // the image size is only known once decoded, and copies of this object won't see it
+    width = height = numChannels = 0;
+    TextureLoader::Get().Request(id, GL_TEXTURE_2D, { filepath }, true, TextureCompressor::IsSRGBType(type),
+                                 TextureCompressor::FormatForType(type));
+}
+
+Texture::~Texture() {
+    TextureLoader::Get().Cancel(id);
+    GLState::ForgetTexture(id);
+    glDeleteTextures(1, &id);
+}
+
+void Texture::SetFlipImageOnLoad(bool flip) {
+    stbi_set_flip_vertically_on_load(flip);
+    TextureLoader::Get().SetFlipOnLoad(flip);
+}
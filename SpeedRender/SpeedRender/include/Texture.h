@@ -10,10 +10,14 @@
 class Texture {
 public:
 	Texture(std::string filepath, std::string type="diffuse");
+	~Texture();
 
-	static void SetFlipImageOnLoad(bool flip) {
-		stbi_set_flip_vertically_on_load(flip);
-	}
+	// owns the GL texture, share it through ResourceManager instead of copying
+	Texture(const Texture &) = delete;
+	Texture &operator=(const Texture &) = delete;
+
+	// applies to every texture and cubemap requested afterwards, decoding happens later on a worker
+	static void SetFlipImageOnLoad(bool flip);
 
     unsigned int id;
 	std::string type;
@@ -0,0 +1,109 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "AssetPack.h"
+#include "CookedAssets.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'R', 'T', 'X' };
+
+    uint64_t AlignUp(uint64_t offset) {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+}
+
+std::string TextureCache::CachePath(const std::string &sourcePath, TextureCompressor::Format format) {
+    return fs::path(sourcePath).replace_extension(Extension(format)).string();
+}
+
+std::string TextureCache::Extension(TextureCompressor::Format format) {
+    std::string extension = std::string(".") + TextureCompressor::FormatName(format) + ".srtex";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extension;
+}
+
+bool TextureCache::Load(const std::string &cachePath, const std::string &sourcePath, TextureCompressor::Format format,
+                        uint32_t flags, View &view) {
+    std::unique_ptr<MappedFile> file = AssetPack::Map(cachePath);
+    if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+    const Header *header = (const Header*)file->Data();
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) return false;
+    if (header->format != (uint32_t)format || header->flags != flags) return false;
+
+    // a missing source is fine, shipped builds only carry the caches
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (CookedAssets::GetStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != header->sourceSize || sourceTime != header->sourceTime)) return false;
+
+    uint64_t levelCount = (uint64_t)header->levelCount * header->faceCount;
+    if (levelCount == 0 || sizeof(Header) + levelCount * sizeof(Level) > file->Size()) {
+        std::cout << "ERROR::TEXTURE_CACHE::TRUNCATED " << cachePath << std::endl;
+        return false;
+    }
+
+    const Level *levels = (const Level*)(file->Data() + sizeof(Header));
+    for (uint64_t i = 0; i < levelCount; i++) {
+        if (levels[i].offset + levels[i].size > file->Size()) {
+            std::cout << "ERROR::TEXTURE_CACHE::TRUNCATED " << cachePath << std::endl;
+            return false;
+        }
+    }
+
+    view.header = header;
+    view.levels = levels;
+    view.file = std::move(file);
+    return true;
+}
+
+bool TextureCache::Write(const std::string &cachePath, const std::string &sourcePath, TextureCompressor::Format format,
+                         uint32_t flags, int width, int height, unsigned int faceCount,
+                         const std::vector<std::vector<unsigned char>> &images) {
+    if (faceCount == 0 || images.empty() || images.size() % faceCount != 0) return false;
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.format = (uint32_t)format;
+    header.flags = flags;
+    header.width = width;
+    header.height = height;
+    header.levelCount = (uint32_t)(images.size() / faceCount);
+    header.faceCount = faceCount;
+    if (!CookedAssets::GetStamp(sourcePath, header.sourceSize, header.sourceTime)) return false;
+
+    std::vector<Level> levels(images.size());
+    uint64_t offset = AlignUp(sizeof(Header) + levels.size() * sizeof(Level));
+    for (size_t i = 0; i < levels.size(); i++) {
+        unsigned int level = (unsigned int)(i % header.levelCount);
+        levels[i].width = std::max(width >> level, 1);
+        levels[i].height = std::max(height >> level, 1);
+        levels[i].offset = offset;
+        levels[i].size = images[i].size();
+        offset = AlignUp(offset + images[i].size());
+    }
+
+    bool written = WriteFileAtomically(cachePath, [&](std::ofstream &out) {
+        const char padding[16] = {};
+        uint64_t position = sizeof(Header) + levels.size() * sizeof(Level);
+        out.write((const char*)&header, sizeof(Header));
+        out.write((const char*)levels.data(), levels.size() * sizeof(Level));
+        for (size_t i = 0; i < levels.size(); i++) {
+            out.write(padding, levels[i].offset - position);
+            out.write((const char*)images[i].data(), images[i].size());
+            position = levels[i].offset + images[i].size();
+        }
+        return true;
+    });
+    if (!written) std::cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED " << cachePath << std::endl;
+    return written;
+}
@@ -0,0 +1,67 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "TextureCompressor.h"
+
+// Binary .srtex files hold a texture after compression, every face with its full mip chain, so later runs
+// can map them and hand the levels straight to glCompressedTexImage2D.
+namespace TextureCache {
+    const uint32_t VERSION = 2;
+
+    const uint32_t FLAG_FLIPPED = 1 << 0;      // rows were flipped vertically on load
+    const uint32_t FLAG_SRGB_MIPS = 1 << 1;    // mips were filtered in linear space, the image is sRGB color
+
+    struct Header {
+        char     magic[4];      // "SRTX"
+        uint32_t version;
+        uint32_t format;        // TextureCompressor::Format
+        uint32_t flags;
+        uint32_t width;         // of level 0
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t faceCount;
+        uint64_t sourceSize;    // size and modification time of the source image
+        int64_t  sourceTime;
+    };
+
+    // levelCount * faceCount of these follow the header, face major
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;        // from the start of the file, 16 byte aligned
+        uint64_t size;
+    };
+
+    // A validated cache file kept mapped while the levels are uploaded
+    struct View {
+        std::unique_ptr<MappedFile> file;
+        const Header *header = nullptr;
+        const Level *levels = nullptr;
+
+        const Level &GetLevel(unsigned int face, unsigned int level) const { return levels[face * header->levelCount + level]; }
+        const unsigned char *Data(const Level &level) const { return file->Data() + level.offset; }
+    };
+
+    // container2.png -> container2.bc7.srtex next to the source
+    std::string CachePath(const std::string &sourcePath, TextureCompressor::Format format);
+    // the ".bc7.srtex" part
+    std::string Extension(TextureCompressor::Format format);
+
+    // Maps cachePath and checks it against the source and the requested format and flags. Returns false
+    // when the cache is missing, from another version or stale.
+    bool Load(const std::string &cachePath, const std::string &sourcePath, TextureCompressor::Format format,
+              uint32_t flags, View &view);
+
+    // images holds faceCount * levelCount compressed levels, face major, level 0 is width x height
+    bool Write(const std::string &cachePath, const std::string &sourcePath, TextureCompressor::Format format,
+               uint32_t flags, int width, int height, unsigned int faceCount,
+               const std::vector<std::vector<unsigned char>> &images);
+}
+
+#endif
@@ -0,0 +1,689 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+namespace {
+    using TextureCompressor::Format;
+
+    // one 4x4 block stored per channel, so the palette search can work on 8 texels per register
+    struct Block {
+        alignas(16) int16_t channel[4][16];
+    };
+
+    // edge blocks repeat the last row and column of the image
+    void LoadBlock(const unsigned char *rgba, int width, int height, int bx, int by, Block &block) {
+        for (int y = 0; y < 4; y++) {
+            int sy = std::min(by * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++) {
+                int sx = std::min(bx * 4 + x, width - 1);
+                const unsigned char *texel = rgba + ((size_t)sy * width + sx) * 4;
+                for (int c = 0; c < 4; c++) block.channel[c][y * 4 + x] = texel[c];
+            }
+        }
+    }
+
+    // Picks the closest palette entry for every texel and returns the summed squared error. Channels the
+    // caller doesn't care about have to be zero in both the block and the palette.
+    uint32_t FitIndices(const Block &block, const int (*palette)[4], int paletteSize, uint8_t indices[16]) {
+#ifdef TEXTURE_COMPRESSOR_SSE2
+        __m128i texels[4][2];
+        for (int c = 0; c < 4; c++) {
+            texels[c][0] = _mm_load_si128((const __m128i*)&block.channel[c][0]);
+            texels[c][1] = _mm_load_si128((const __m128i*)&block.channel[c][8]);
+        }
+
+        // four texels per register, errors as 32 bit lanes
+        __m128i bestError[4], bestIndex[4];
+        for (int q = 0; q < 4; q++) {
+            bestError[q] = _mm_set1_epi32(INT_MAX);
+            bestIndex[q] = _mm_setzero_si128();
+        }
+
+        for (int p = 0; p < paletteSize; p++) {
+            __m128i r = _mm_set1_epi16((short)palette[p][0]);
+            __m128i g = _mm_set1_epi16((short)palette[p][1]);
+            __m128i b = _mm_set1_epi16((short)palette[p][2]);
+            __m128i a = _mm_set1_epi16((short)palette[p][3]);
+            __m128i index = _mm_set1_epi32(p);
+
+            for (int h = 0; h < 2; h++) {
+                __m128i dr = _mm_sub_epi16(texels[0][h], r);
+                __m128i dg = _mm_sub_epi16(texels[1][h], g);
+                __m128i db = _mm_sub_epi16(texels[2][h], b);
+                __m128i da = _mm_sub_epi16(texels[3][h], a);
+
+                // interleave channel pairs so madd squares and sums them per texel
+                __m128i rgLow = _mm_unpacklo_epi16(dr, dg), rgHigh = _mm_unpackhi_epi16(dr, dg);
+                __m128i baLow = _mm_unpacklo_epi16(db, da), baHigh = _mm_unpackhi_epi16(db, da);
+                __m128i error[2] = {
+                    _mm_add_epi32(_mm_madd_epi16(rgLow, rgLow), _mm_madd_epi16(baLow, baLow)),
+                    _mm_add_epi32(_mm_madd_epi16(rgHigh, rgHigh), _mm_madd_epi16(baHigh, baHigh))
+                };
+
+                for (int k = 0; k < 2; k++) {
+                    int q = h * 2 + k;
+                    __m128i better = _mm_cmplt_epi32(error[k], bestError[q]);
+                    bestError[q] = _mm_or_si128(_mm_and_si128(better, error[k]), _mm_andnot_si128(better, bestError[q]));
+                    bestIndex[q] = _mm_or_si128(_mm_and_si128(better, index), _mm_andnot_si128(better, bestIndex[q]));
+                }
+            }
+        }
+
+        alignas(16) int32_t errors[16], best[16];
+        for (int q = 0; q < 4; q++) {
+            _mm_store_si128((__m128i*)&errors[q * 4], bestError[q]);
+            _mm_store_si128((__m128i*)&best[q * 4], bestIndex[q]);
+        }
+
+        uint32_t total = 0;
+        for (int i = 0; i < 16; i++) {
+            total += errors[i];
+            indices[i] = (uint8_t)best[i];
+        }
+        return total;
+#else
+        uint32_t total = 0;
+        for (int i = 0; i < 16; i++) {
+            int bestError = INT_MAX, best = 0;
+            for (int p = 0; p < paletteSize; p++) {
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    int d = block.channel[c][i] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            total += bestError;
+            indices[i] = (uint8_t)best;
+        }
+        return total;
+#endif
+    }
+
+    // Mean and principal axis of the texels over the first channels, the axis is unit length
+    void PrincipalAxis(const Block &block, int channels, float mean[4], float axis[4]) {
+        float low[4] = { 255, 255, 255, 255 }, high[4] = { 0, 0, 0, 0 };
+        for (int c = 0; c < 4; c++) {
+            mean[c] = axis[c] = 0.0f;
+            if (c >= channels) continue;
+            for (int i = 0; i < 16; i++) {
+                mean[c] += block.channel[c][i];
+                low[c] = std::min(low[c], (float)block.channel[c][i]);
+                high[c] = std::max(high[c], (float)block.channel[c][i]);
+            }
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++) {
+            float d[4];
+            for (int c = 0; c < channels; c++) d[c] = block.channel[c][i] - mean[c];
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++) covariance[a][b] += d[a] * d[b];
+        }
+
+        // power iteration, seeded with the bounding box diagonal
+        for (int c = 0; c < channels; c++) axis[c] = high[c] - low[c];
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float next[4] = {};
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+
+            float length = 0.0f;
+            for (int c = 0; c < channels; c++) length += next[c] * next[c];
+            if (length < 1e-12f) break;
+            length = 1.0f / std::sqrt(length);
+            for (int c = 0; c < channels; c++) axis[c] = next[c] * length;
+        }
+
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++) length += axis[c] * axis[c];
+        if (length < 1e-12f) {
+            for (int c = 0; c < channels; c++) axis[c] = 1.0f;
+            length = (float)channels;
+        }
+        length = 1.0f / std::sqrt(length);
+        for (int c = 0; c < channels; c++) axis[c] *= length;
+    }
+
+    // endpoints at the extremes of the texels projected onto the principal axis, pulled in by inset of the range
+    void AxisEndpoints(const Block &block, int channels, float inset, float low[4], float high[4]) {
+        float mean[4], axis[4];
+        PrincipalAxis(block, channels, mean, axis);
+
+        float minT = 1e30f, maxT = -1e30f;
+        for (int i = 0; i < 16; i++) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; c++) t += (block.channel[c][i] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        float pull = (maxT - minT) * inset;
+        for (int c = 0; c < 4; c++) {
+            low[c] = c < channels ? mean[c] + axis[c] * (minT + pull) : 0.0f;
+            high[c] = c < channels ? mean[c] + axis[c] * (maxT - pull) : 0.0f;
+        }
+    }
+
+    // Least squares endpoints for texels that sit at weights[indices[i]] between low (0) and high (1)
+    bool FitEndpoints(const Block &block, int channels, const uint8_t indices[16], const float *weights, float low[4], float high[4]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; i++) {
+            float b = weights[indices[i]], a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < channels; c++) {
+                ax[c] += a * block.channel[c][i];
+                bx[c] += b * block.channel[c][i];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f) return false;
+        determinant = 1.0f / determinant;
+        for (int c = 0; c < channels; c++) {
+            low[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) * determinant, 0.0f), 255.0f);
+            high[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) * determinant, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    // --- BC1 color blocks, also the color half of BC3 ---
+
+    uint16_t To565(const float color[4]) {
+        int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+        int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+        int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void From565(uint16_t color, int out[4]) {
+        int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+        out[3] = 0;
+    }
+
+    // index order of the hardware: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+    const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    void BC1Palette(uint16_t c0, uint16_t c1, int palette[4][4]) {
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int c = 0; c < 4; c++) {
+            if (c0 > c1) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            } else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+    }
+
+    void EncodeColorBlock(const Block &block, unsigned char out[8]) {
+        Block rgb = block;
+        memset(rgb.channel[3], 0, sizeof(rgb.channel[3]));
+
+        float low[4], high[4];
+        AxisEndpoints(rgb, 3, 1.0f / 16.0f, low, high);
+        uint16_t c0 = To565(high), c1 = To565(low);
+
+        uint32_t bestError = UINT32_MAX;
+        uint16_t best0 = 0, best1 = 0;
+        uint8_t bestIndices[16] = {};
+        for (int iteration = 0; iteration < 3; iteration++) {
+            // c0 > c1 selects the four color mode, equal endpoints only ever use index 0
+            if (c0 < c1) std::swap(c0, c1);
+            int palette[4][4];
+            BC1Palette(c0, c1, palette);
+
+            uint8_t indices[16];
+            uint32_t error = FitIndices(rgb, palette, c0 == c1 ? 1 : 4, indices);
+            if (error >= bestError) break;
+            bestError = error;
+            best0 = c0;
+            best1 = c1;
+            memcpy(bestIndices, indices, sizeof(indices));
+            if (error == 0 || c0 == c1) break;
+
+            // endpoints are the low/high pair with c0 at weight 0
+            if (!FitEndpoints(rgb, 3, indices, BC1_WEIGHTS, high, low)) break;
+            c0 = To565(high);
+            c1 = To565(low);
+        }
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= (uint32_t)bestIndices[i] << (2 * i);
+        out[0] = (unsigned char)(best0 & 0xFF);
+        out[1] = (unsigned char)(best0 >> 8);
+        out[2] = (unsigned char)(best1 & 0xFF);
+        out[3] = (unsigned char)(best1 >> 8);
+        memcpy(out + 4, &bits, 4);
+    }
+
+    void DecodeColorBlock(const unsigned char in[8], bool forceFourColor, unsigned char texels[16][4]) {
+        uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8)), c1 = (uint16_t)(in[2] | (in[3] << 8));
+        int palette[4][4];
+        if (forceFourColor && c0 <= c1) {
+            // BC3 color blocks always interpolate
+            From565(c0, palette[0]);
+            From565(c1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+        } else {
+            BC1Palette(c0, c1, palette);
+        }
+        bool transparentBlack = !forceFourColor && c0 <= c1;
+
+        uint32_t bits;
+        memcpy(&bits, in + 4, 4);
+        for (int i = 0; i < 16; i++) {
+            int index = (bits >> (2 * i)) & 3;
+            for (int c = 0; c < 3; c++) texels[i][c] = (unsigned char)palette[index][c];
+            texels[i][3] = transparentBlack && index == 3 ? 0 : 255;
+        }
+    }
+
+    // --- BC4 single channel blocks, also the alpha of BC3 and both halves of BC5 ---
+
+    void BC4Palette(int e0, int e1, int palette[8][4]) {
+        for (int i = 0; i < 8; i++) palette[i][1] = palette[i][2] = palette[i][3] = 0;
+        palette[0][0] = e0;
+        palette[1][0] = e1;
+        if (e0 > e1) {
+            for (int i = 1; i <= 6; i++) palette[1 + i][0] = ((7 - i) * e0 + i * e1 + 3) / 7;
+        } else {
+            for (int i = 1; i <= 4; i++) palette[1 + i][0] = ((5 - i) * e0 + i * e1 + 2) / 5;
+            palette[6][0] = 0;
+            palette[7][0] = 255;
+        }
+    }
+
+    const float BC4_WEIGHTS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+    uint32_t FitSingleChannel(const Block &single, int e0, int e1, uint8_t indices[16]) {
+        int palette[8][4];
+        BC4Palette(e0, e1, palette);
+        return FitIndices(single, palette, 8, indices);
+    }
+
+    void EncodeSingleChannelBlock(const Block &block, int channel, unsigned char out[8]) {
+        Block single = {};
+        memcpy(single.channel[0], block.channel[channel], sizeof(single.channel[0]));
+
+        int low = 255, high = 0, innerLow = 255, innerHigh = 0;
+        for (int i = 0; i < 16; i++) {
+            int v = single.channel[0][i];
+            low = std::min(low, v);
+            high = std::max(high, v);
+            if (v != 0 && v != 255) {
+                innerLow = std::min(innerLow, v);
+                innerHigh = std::max(innerHigh, v);
+            }
+        }
+
+        int best0 = high, best1 = low;
+        uint8_t bestIndices[16] = {};
+        uint32_t bestError = 0;
+        if (low != high) {
+            // eight interpolated values spanning the block
+            bestError = FitSingleChannel(single, high, low, bestIndices);
+
+            // one least squares pass, kept in the eight value ordering
+            float fitLow[4], fitHigh[4];
+            if (bestError > 0 && FitEndpoints(single, 1, bestIndices, BC4_WEIGHTS, fitHigh, fitLow)) {
+                int e0 = (int)std::lround(fitHigh[0]), e1 = (int)std::lround(fitLow[0]);
+                if (e0 > e1) {
+                    uint8_t indices[16];
+                    uint32_t error = FitSingleChannel(single, e0, e1, indices);
+                    if (error < bestError) {
+                        bestError = error;
+                        best0 = e0;
+                        best1 = e1;
+                        memcpy(bestIndices, indices, sizeof(indices));
+                    }
+                }
+            }
+
+            // six values plus exact 0 and 255 for blocks that touch the extremes
+            if (bestError > 0 && (low == 0 || high == 255) && innerLow <= innerHigh) {
+                uint8_t indices[16];
+                uint32_t error = FitSingleChannel(single, innerLow, innerHigh, indices);
+                if (error < bestError) {
+                    bestError = error;
+                    best0 = innerLow;
+                    best1 = innerHigh;
+                    memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= (uint64_t)bestIndices[i] << (3 * i);
+        out[0] = (unsigned char)best0;
+        out[1] = (unsigned char)best1;
+        for (int i = 0; i < 6; i++) out[2 + i] = (unsigned char)(bits >> (8 * i));
+    }
+
+    void DecodeSingleChannelBlock(const unsigned char in[8], unsigned char values[16]) {
+        int palette[8][4];
+        BC4Palette(in[0], in[1], palette);
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++) bits |= (uint64_t)in[2 + i] << (8 * i);
+        for (int i = 0; i < 16; i++) values[i] = (unsigned char)palette[(bits >> (3 * i)) & 7][0];
+    }
+
+    // --- BC7, mode 6 only: one subset, RGBA endpoints with 7 bits plus a p-bit, 4 bit indices ---
+
+    const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    const float BC7_FIT_WEIGHTS[16] = {
+        0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+        34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+    };
+
+    struct BitWriter {
+        uint64_t word[2] = { 0, 0 };
+        int position = 0;
+
+        void Put(uint32_t value, int count) {
+            for (int i = 0; i < count; i++, position++)
+                if ((value >> i) & 1) word[position >> 6] |= 1ull << (position & 63);
+        }
+    };
+
+    struct BitReader {
+        uint64_t word[2];
+        int position = 0;
+
+        uint32_t Get(int count) {
+            uint32_t value = 0;
+            for (int i = 0; i < count; i++, position++)
+                value |= (uint32_t)((word[position >> 6] >> (position & 63)) & 1) << i;
+            return value;
+        }
+    };
+
+    // 7 bits per channel plus a p-bit shared by all four, picked to best match the 8 bit endpoint
+    void QuantizeBC7Endpoint(const float endpoint[4], int quantized[4], int &pbit) {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++) {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                candidate[c] = std::min(std::max((int)std::lround((endpoint[c] - p) * 0.5f), 0), 127);
+                float d = (candidate[c] * 2 + p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pbit = p;
+                memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    void BC7Palette(const int q0[4], int p0, const int q1[4], int p1, int palette[16][4]) {
+        for (int c = 0; c < 4; c++) {
+            int e0 = q0[c] * 2 + p0, e1 = q1[c] * 2 + p1;
+            for (int i = 0; i < 16; i++) palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+        }
+    }
+
+    void EncodeBC7Block(const Block &block, unsigned char out[16]) {
+        float low[4], high[4];
+        AxisEndpoints(block, 4, 0.0f, low, high);
+
+        uint32_t bestError = UINT32_MAX;
+        int best0[4] = {}, best1[4] = {}, bestP0 = 0, bestP1 = 0;
+        uint8_t bestIndices[16] = {};
+        for (int iteration = 0; iteration < 3; iteration++) {
+            int q0[4], q1[4], p0, p1;
+            QuantizeBC7Endpoint(low, q0, p0);
+            QuantizeBC7Endpoint(high, q1, p1);
+
+            int palette[16][4];
+            BC7Palette(q0, p0, q1, p1, palette);
+            uint8_t indices[16];
+            uint32_t error = FitIndices(block, palette, 16, indices);
+            if (error >= bestError) break;
+            bestError = error;
+            memcpy(best0, q0, sizeof(q0));
+            memcpy(best1, q1, sizeof(q1));
+            bestP0 = p0;
+            bestP1 = p1;
+            memcpy(bestIndices, indices, sizeof(indices));
+            if (error == 0) break;
+
+            if (!FitEndpoints(block, 4, indices, BC7_FIT_WEIGHTS, low, high)) break;
+        }
+
+        // the top bit of the first index is implied zero, flip the ramp if it is set
+        if (bestIndices[0] & 8) {
+            std::swap(best0, best1);
+            std::swap(bestP0, bestP1);
+            for (int i = 0; i < 16; i++) bestIndices[i] = 15 - bestIndices[i];
+        }
+
+        BitWriter bits;
+        bits.Put(1 << 6, 7);
+        for (int c = 0; c < 4; c++) {
+            bits.Put(best0[c], 7);
+            bits.Put(best1[c], 7);
+        }
+        bits.Put(bestP0, 1);
+        bits.Put(bestP1, 1);
+        bits.Put(bestIndices[0], 3);
+        for (int i = 1; i < 16; i++) bits.Put(bestIndices[i], 4);
+        memcpy(out, bits.word, 16);
+    }
+
+    void DecodeBC7Block(const unsigned char in[16], unsigned char texels[16][4]) {
+        BitReader bits;
+        memcpy(bits.word, in, 16);
+        if (bits.Get(7) != 1 << 6) {
+            for (int i = 0; i < 16; i++) {
+                texels[i][0] = texels[i][2] = texels[i][3] = 255;
+                texels[i][1] = 0;
+            }
+            return;
+        }
+
+        int q0[4], q1[4];
+        for (int c = 0; c < 4; c++) {
+            q0[c] = bits.Get(7);
+            q1[c] = bits.Get(7);
+        }
+        int p0 = bits.Get(1), p1 = bits.Get(1);
+
+        int palette[16][4];
+        BC7Palette(q0, p0, q1, p1, palette);
+        for (int i = 0; i < 16; i++) {
+            int index = bits.Get(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)palette[index][c];
+        }
+    }
+
+    void EncodeBlock(Format format, const Block &block, unsigned char *out) {
+        switch (format) {
+        case Format::BC1: EncodeColorBlock(block, out); break;
+        case Format::BC3: EncodeSingleChannelBlock(block, 3, out); EncodeColorBlock(block, out + 8); break;
+        case Format::BC4: EncodeSingleChannelBlock(block, 0, out); break;
+        case Format::BC5: EncodeSingleChannelBlock(block, 0, out); EncodeSingleChannelBlock(block, 1, out + 8); break;
+        case Format::BC7: EncodeBC7Block(block, out); break;
+        default: break;
+        }
+    }
+
+    void DecodeBlock(Format format, const unsigned char *in, unsigned char texels[16][4]) {
+        unsigned char values[16];
+        switch (format) {
+        case Format::BC1:
+            DecodeColorBlock(in, false, texels);
+            break;
+        case Format::BC3:
+            DecodeColorBlock(in + 8, true, texels);
+            DecodeSingleChannelBlock(in, values);
+            for (int i = 0; i < 16; i++) texels[i][3] = values[i];
+            break;
+        case Format::BC4:
+            DecodeSingleChannelBlock(in, values);
+            for (int i = 0; i < 16; i++) {
+                texels[i][0] = values[i];
+                texels[i][1] = texels[i][2] = 0;
+                texels[i][3] = 255;
+            }
+            break;
+        case Format::BC5:
+            DecodeSingleChannelBlock(in, values);
+            for (int i = 0; i < 16; i++) texels[i][0] = values[i];
+            DecodeSingleChannelBlock(in + 8, values);
+            for (int i = 0; i < 16; i++) {
+                texels[i][1] = values[i];
+                texels[i][2] = 0;
+                texels[i][3] = 255;
+            }
+            break;
+        case Format::BC7:
+            DecodeBC7Block(in, texels);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+const char *TextureCompressor::FormatName(Format format) {
+    switch (format) {
+    case Format::RGBA8: return "RGBA8";
+    case Format::BC1: return "BC1";
+    case Format::BC3: return "BC3";
+    case Format::BC4: return "BC4";
+    case Format::BC5: return "BC5";
+    case Format::BC7: return "BC7";
+    case Format::RGB16F: return "RGB16F";
+    }
+    return "?";
+}
+
+GLenum TextureCompressor::GLFormat(Format format, bool srgb) {
+    switch (format) {
+    case Format::RGBA8: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    case Format::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Format::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Format::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case Format::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case Format::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case Format::RGB16F: return GL_RGB16F;
+    }
+    return GL_RGBA8;
+}
+
+int TextureCompressor::ChannelCount(Format format) {
+    switch (format) {
+    case Format::BC1:
+    case Format::RGB16F: return 3;
+    case Format::BC4: return 1;
+    case Format::BC5: return 2;
+    default: return 4;
+    }
+}
+
+TextureCompressor::Format TextureCompressor::FormatForType(const std::string &type) {
+    // specular maps are intensity only and normal maps need two channels, BC7 beats BC1 by a wide margin
+    // on color for the same bandwidth as BC3
+    if (type == "specular") return Format::BC4;
+    if (type == "normal") return Format::BC5;
+    return Format::BC7;
+}
+
+bool TextureCompressor::IsSRGBType(const std::string &type) {
+    return type != "specular" && type != "normal";
+}
+
+size_t TextureCompressor::BlockBytes(Format format) {
+    switch (format) {
+    case Format::RGBA8: return 64;
+    case Format::BC1:
+    case Format::BC4: return 8;
+    default: return 16;
+    }
+}
+
+size_t TextureCompressor::CompressedSize(Format format, int width, int height) {
+    if (format == Format::RGBA8) return (size_t)width * height * 4;
+    if (format == Format::RGB16F) return (size_t)width * height * 6;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+void TextureCompressor::Compress(Format format, const unsigned char *rgba, int width, int height, unsigned char *out) {
+    if (format == Format::RGBA8) {
+        memcpy(out, rgba, CompressedSize(format, width, height));
+        return;
+    }
+
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+    ThreadPool::Global().ParallelFor(blocksY, [&](size_t begin, size_t end) {
+        Block block;
+        for (size_t by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                LoadBlock(rgba, width, height, bx, (int)by, block);
+                EncodeBlock(format, block, out + (by * blocksX + bx) * blockBytes);
+            }
+        }
+    });
+}
+
+void TextureCompressor::Decompress(Format format, const unsigned char *blocks, int width, int height, unsigned char *rgba) {
+    if (format == Format::RGBA8) {
+        memcpy(rgba, blocks, CompressedSize(format, width, height));
+        return;
+    }
+
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            unsigned char texels[16][4];
+            DecodeBlock(format, blocks + ((size_t)by * blocksX + bx) * blockBytes, texels);
+
+            for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+        }
+    }
+}
+
+void TextureCompressor::CompressMipChain(Format format, const unsigned char *rgba, int width, int height, bool mipmaps, bool srgb,
+                                         std::vector<std::vector<unsigned char>> &levels) {
+    std::vector<std::vector<unsigned char>> mips;
+    if (mipmaps) MipGenerator::Generate(rgba, width, height, 4, srgb, mips);
+
+    for (size_t level = 0; level <= mips.size(); level++) {
+        int levelWidth = std::max(width >> level, 1), levelHeight = std::max(height >> level, 1);
+        levels.emplace_back(CompressedSize(format, levelWidth, levelHeight));
+        Compress(format, level == 0 ? rgba : mips[level - 1].data(), levelWidth, levelHeight, levels.back().data());
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// glad is generated without EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT       0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// CPU encoder for the BCn block formats. Input is always tightly packed RGBA8, output is a row major array
+// of 4x4 blocks ready for glCompressedTexImage2D. Blocks are spread over the global thread pool and the
+// palette search runs on SSE2 where available.
+namespace TextureCompressor {
+    enum class Format : uint32_t {
+        RGBA8,  // uncompressed, 32 bits per texel
+        BC1,    // RGB, 4 bits per texel
+        BC3,    // RGBA, 8 bits per texel, alpha stored like BC4
+        BC4,    // R, 4 bits per texel
+        BC5,    // RG, 8 bits per texel
+        BC7,    // RGBA, 8 bits per texel, encoded with mode 6 only
+        RGB16F  // half float HDR, 48 bits per texel, made by EquirectConverter and never passed to Compress
+    };
+
+    const char *FormatName(Format format);
+    // with srgb the color formats pick their sRGB variant, BC4 and BC5 have none
+    GLenum GLFormat(Format format, bool srgb = false);
+    // number of channels the format stores, the rest decode as 0 (or 255 for alpha)
+    int ChannelCount(Format format);
+
+    // Format used for a texture of the given type ("diffuse", "specular", "normal", ...), see --bench-bc
+    Format FormatForType(const std::string &type);
+    // true for types holding sRGB encoded color, as opposed to data like specular intensity or normals
+    bool IsSRGBType(const std::string &type);
+
+    size_t BlockBytes(Format format);
+    size_t CompressedSize(Format format, int width, int height);
+
+    // out must hold CompressedSize(format, width, height) bytes
+    void Compress(Format format, const unsigned char *rgba, int width, int height, unsigned char *out);
+    // Inverse of Compress, used to measure quality. BC7 blocks in modes other than 6 decode as magenta.
+    void Decompress(Format format, const unsigned char *blocks, int width, int height, unsigned char *rgba);
+
+    // Compresses level 0 and, with mipmaps, every level down to 1x1 into levels. Each level is filtered
+    // by MipGenerator from the uncompressed level above it, not from decoded blocks, in linear space with srgb.
+    void CompressMipChain(Format format, const unsigned char *rgba, int width, int height, bool mipmaps, bool srgb,
+                          std::vector<std::vector<unsigned char>> &levels);
+}
+
+#endif
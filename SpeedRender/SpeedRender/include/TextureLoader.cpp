@@ -0,0 +1,442 @@
+#include "TextureLoader.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "CookedAssets.h"
+#include "EquirectConverter.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+namespace {
+    // what the cooker compresses cubemap faces to
+    const TextureCompressor::Format CUBEMAP_FORMAT = TextureCompressor::Format::BC1;
+
+    GLenum PixelFormat(int channels) {
+        switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+        }
+    }
+
+    // one and two channel images are grey and grey with alpha, sRGB only exists for color
+    GLenum InternalFormat(int channels, bool srgb) {
+        switch (channels) {
+        case 1: return GL_R8;
+        case 2: return GL_RG8;
+        case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+        default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        }
+    }
+
+    // spreads grey over RGB so shaders read such textures like color ones
+    void SetGreySwizzle(GLenum target, int channels) {
+        if (channels > 2) return;
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, channels == 2 ? GL_GREEN : GL_ONE };
+        glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    GLenum FaceTarget(GLenum target, unsigned int face) {
+        return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+    }
+
+    // index of the 1x1 level at the end of a full mip chain
+    int TopLevel(int width, int height) {
+        return (int)std::floor(std::log2((double)std::max(std::max(width, height), 1)));
+    }
+
+    bool HasExtension(const char *name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension && strcmp(extension, name) == 0) return true;
+        }
+        return false;
+    }
+
+    // RGTC is core since 3.0, S3TC and BPTC need the extensions on a 3.3 context
+    TextureCompressor::Format SupportedFormat(TextureCompressor::Format format) {
+        using TextureCompressor::Format;
+        static const bool s3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+        static const bool bptc = GLAD_GL_VERSION_4_2 || HasExtension("GL_ARB_texture_compression_bptc");
+
+        if (format == Format::BC7 && !bptc) format = Format::BC3;
+        if ((format == Format::BC1 || format == Format::BC3) && !s3tc) format = Format::RGBA8;
+        return format;
+    }
+}
+
+TextureLoader &TextureLoader::Get() {
+    static TextureLoader loader;
+    return loader;
+}
+
+TextureLoader::TextureLoader() {
+    // make sure the pool is constructed first so it outlives the decodes we hand it
+    ThreadPool::Global();
+}
+
+TextureLoader::~TextureLoader() {
+    // GL objects die with the context, only the decoded images need cleaning up
+    for (std::unique_ptr<Job> &job : jobs) {
+        job->decoded.wait();
+        for (unsigned char *pixels : job->pixels) stbi_image_free(pixels);
+    }
+}
+
+void TextureLoader::Request(unsigned int id, GLenum target, const std::vector<std::string> &paths, bool mipmaps, bool srgb,
+                            TextureCompressor::Format format) {
+    std::unique_ptr<Job> job(new Job());
+    job->id = id;
+    job->target = target;
+    job->paths = paths;
+    job->flip = flipOnLoad;
+    job->mipmaps = mipmaps;
+    job->srgb = srgb;
+    job->requested = std::chrono::steady_clock::now();
+    job->format = TextureCompressor::Format::RGBA8;
+    if (compressTextures && target == GL_TEXTURE_2D) job->format = SupportedFormat(format);
+
+    // cubemaps are only compressed by the cooker, use its output when the driver takes the format
+    if (compressTextures && target == GL_TEXTURE_CUBE_MAP && paths.size() == 6) {
+        job->cookedPath = CookedAssets::Find(paths[0], ".cube" + TextureCache::Extension(CUBEMAP_FORMAT));
+        if (!job->cookedPath.empty() && SupportedFormat(CUBEMAP_FORMAT) == CUBEMAP_FORMAT) job->format = CUBEMAP_FORMAT;
+    }
+    // a cubemap from a single panorama is converted to half float faces
+    if (target == GL_TEXTURE_CUBE_MAP && paths.size() == 1) job->format = TextureCompressor::Format::RGB16F;
+
+    Job *raw = job.get();
+    job->decoded = ThreadPool::Global().Submit([raw]() { Decode(*raw); });
+    jobs.push_back(std::move(job));
+}
+
+void TextureLoader::Decode(Job &job) {
+    // the global stb flag can change under us while the main thread queues more work
+    stbi_set_flip_vertically_on_load_thread(job.flip);
+
+    if (job.format == TextureCompressor::Format::RGB16F) {
+        DecodeEquirect(job);
+        return;
+    }
+    if (job.format != TextureCompressor::Format::RGBA8) {
+        DecodeCompressed(job);
+        return;
+    }
+
+    // the first image decides the channel count, so cubemap faces can be decoded side by side
+    int firstWidth, firstHeight;
+    if (!stbi_info(job.paths[0].c_str(), &firstWidth, &firstHeight, &job.channels)) {
+        std::cout << "Failed to load texture at " << job.paths[0] << std::endl;
+        job.failed = true;
+        return;
+    }
+
+    size_t count = job.paths.size();
+    std::vector<int> widths(count), heights(count);
+    std::vector<std::vector<std::vector<unsigned char>>> mips(count);
+    job.pixels.assign(count, nullptr);
+    ThreadPool::Global().ParallelFor(count, [&](size_t begin, size_t end) {
+        // the flag is per thread and this may run on another worker
+        stbi_set_flip_vertically_on_load_thread(job.flip);
+        for (size_t i = begin; i < end; i++) {
+            int fileChannels;
+            job.pixels[i] = stbi_load(job.paths[i].c_str(), &widths[i], &heights[i], &fileChannels, job.channels);
+            if (job.pixels[i] && job.mipmaps)
+                MipGenerator::Generate(job.pixels[i], widths[i], heights[i], job.channels, job.srgb, mips[i]);
+        }
+    });
+
+    for (size_t i = 0; i < count; i++) {
+        if (!job.pixels[i]) {
+            std::cout << "Failed to load texture at " << job.paths[i] << std::endl;
+            job.failed = true;
+            return;
+        }
+        if (widths[i] != widths[0] || heights[i] != heights[0]) {
+            std::cout << "Texture face size mismatch at " << job.paths[i] << std::endl;
+            job.failed = true;
+            return;
+        }
+        for (std::vector<unsigned char> &mip : mips[i]) job.mips.push_back(std::move(mip));
+    }
+    job.width = widths[0];
+    job.height = heights[0];
+}
+
+void TextureLoader::DecodeEquirect(Job &job) {
+    const std::string &path = job.paths[0];
+    std::string cachePath = TextureCache::CachePath(path, job.format);
+
+    // converted once, later runs map the faces from the cache next to the panorama
+    if (TextureCache::Load(cachePath, path, job.format, 0, job.cache) && job.cache.header->faceCount == 6 &&
+        (job.cache.header->levelCount > 1) == job.mipmaps) {
+        for (unsigned int face = 0; face < 6; face++) {
+            for (unsigned int i = 0; i < job.cache.header->levelCount; i++) {
+                const TextureCache::Level &level = job.cache.GetLevel(face, i);
+                job.levels.push_back({ (int)level.width, (int)level.height, job.cache.Data(level), (size_t)level.size });
+            }
+        }
+        job.faceCount = 6;
+        job.width = job.height = job.cache.header->width;
+        return;
+    }
+    job.cache = TextureCache::View();
+
+    // the projection fixes which way is up, the flip flag doesn't apply
+    stbi_set_flip_vertically_on_load_thread(false);
+    int width, height, channels;
+    float *data = stbi_loadf(path.c_str(), &width, &height, &channels, 4);
+    if (!data) {
+        std::cout << "Failed to load texture at " << path << std::endl;
+        job.failed = true;
+        return;
+    }
+
+    int faceSize = EquirectConverter::FaceSize(width);
+    EquirectConverter::Convert(data, width, height, faceSize, job.mipmaps, job.compressed);
+    stbi_image_free(data);
+
+    int levelCount = (int)job.compressed.size() / 6;
+    for (size_t i = 0; i < job.compressed.size(); i++) {
+        int size = std::max(faceSize >> (i % levelCount), 1);
+        job.levels.push_back({ size, size, job.compressed[i].data(), job.compressed[i].size() });
+    }
+    job.faceCount = 6;
+    job.width = job.height = faceSize;
+
+    TextureCache::Write(cachePath, path, job.format, 0, faceSize, faceSize, 6, job.compressed);
+}
+
+void TextureLoader::DecodeCompressed(Job &job) {
+    const std::string &path = job.paths[0];
+    uint32_t flags = (job.flip ? TextureCache::FLAG_FLIPPED : 0) | (job.srgb && job.mipmaps ? TextureCache::FLAG_SRGB_MIPS : 0);
+    std::string cachePath = TextureCache::CachePath(path, job.format);
+    unsigned int faceCount = job.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+    // the cooked file was checked against its sources by the manifest, our own cache against the image
+    if (job.cookedPath.empty() && job.target == GL_TEXTURE_2D) job.cookedPath = CookedAssets::Find(path, TextureCache::Extension(job.format));
+    if ((!job.cookedPath.empty() && TextureCache::Load(job.cookedPath, "", job.format, flags, job.cache)) ||
+        (faceCount == 1 && TextureCache::Load(cachePath, path, job.format, flags, job.cache))) {
+        if (job.cache.header->faceCount == faceCount) {
+            for (unsigned int face = 0; face < faceCount; face++) {
+                for (unsigned int i = 0; i < job.cache.header->levelCount; i++) {
+                    const TextureCache::Level &level = job.cache.GetLevel(face, i);
+                    job.levels.push_back({ (int)level.width, (int)level.height, job.cache.Data(level), (size_t)level.size });
+                }
+            }
+            job.faceCount = faceCount;
+            job.width = job.cache.header->width;
+            job.height = job.cache.header->height;
+            return;
+        }
+        job.cache = TextureCache::View();
+    }
+
+    // cubemaps are never compressed here, fall back to plain faces
+    if (faceCount > 1) {
+        job.format = TextureCompressor::Format::RGBA8;
+        Decode(job);
+        return;
+    }
+
+    int width, height, fileChannels;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &fileChannels, 4);
+    if (!data) {
+        std::cout << "Failed to load texture at " << path << std::endl;
+        job.failed = true;
+        return;
+    }
+    TextureCompressor::CompressMipChain(job.format, data, width, height, job.mipmaps, job.srgb, job.compressed);
+    stbi_image_free(data);
+    for (size_t level = 0; level < job.compressed.size(); level++)
+        job.levels.push_back({ std::max(width >> level, 1), std::max(height >> level, 1), job.compressed[level].data(), job.compressed[level].size() });
+    job.width = width;
+    job.height = height;
+
+    TextureCache::Write(cachePath, path, job.format, flags, width, height, 1, job.compressed);
+}
+
+void TextureLoader::Cancel(unsigned int id) {
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        Job &job = **it;
+        if (job.id != id) continue;
+
+        job.decoded.wait();
+        for (unsigned char *pixels : job.pixels) stbi_image_free(pixels);
+        jobs.erase(it);
+        return;
+    }
+}
+
+void TextureLoader::Update() {
+    size_t budget = uploadBudget;
+    for (auto it = jobs.begin(); it != jobs.end() && budget > 0; ) {
+        Job &job = **it;
+        if (job.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready || !Upload(job, budget)) {
+            ++it;
+            continue;
+        }
+
+        Finish(job);
+        it = jobs.erase(it);
+    }
+}
+
+void TextureLoader::Flush() {
+    while (!jobs.empty()) {
+        Job &job = *jobs.front();
+        job.decoded.wait();
+
+        size_t budget = SIZE_MAX;
+        Upload(job, budget);
+        Finish(job);
+        jobs.pop_front();
+    }
+}
+
+bool TextureLoader::Upload(Job &job, size_t &budget) {
+    if (job.failed) return true;
+    if (job.format != TextureCompressor::Format::RGBA8) return UploadCompressed(job, budget);
+
+    if (pbo == 0) glGenBuffers(1, &pbo);
+
+    GLenum format = PixelFormat(job.channels);
+    GLenum internalFormat = InternalFormat(job.channels, job.srgb && srgbSampling);
+    size_t rowBytes = (size_t)job.width * job.channels;
+    int topLevel = TopLevel(job.width, job.height);
+
+    GLState::BindTexture(job.target, job.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (!job.allocated) {
+        // Allocate the real level 0 plus the 1x1 end of the mip chain. Sampling is clamped to that single
+        // texel, the last mip or the image's average color without mips, while the levels in between and
+        // then level 0 are filled over the next frames.
+        for (unsigned int face = 0; face < job.pixels.size(); face++) {
+            GLenum faceTarget = FaceTarget(job.target, face);
+            glTexImage2D(faceTarget, 0, internalFormat, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+
+            if (topLevel > 0 && job.mipmaps) {
+                glTexImage2D(faceTarget, topLevel, internalFormat, 1, 1, 0, format, GL_UNSIGNED_BYTE, job.mips[(face + 1) * topLevel - 1].data());
+            } else if (topLevel > 0) {
+                unsigned char average[4] = { 0, 0, 0, 255 };
+                unsigned long long sums[4] = { 0, 0, 0, 0 }, samples = 0;
+                int step = std::max(std::max(job.width, job.height) / 64, 1);
+                for (int y = 0; y < job.height; y += step) {
+                    for (int x = 0; x < job.width; x += step) {
+                        const unsigned char *texel = job.pixels[face] + y * rowBytes + x * job.channels;
+                        for (int c = 0; c < job.channels; c++) sums[c] += texel[c];
+                        samples++;
+                    }
+                }
+                for (int c = 0; c < job.channels; c++) average[c] = (unsigned char)(sums[c] / samples);
+
+                glTexImage2D(faceTarget, topLevel, internalFormat, 1, 1, 0, format, GL_UNSIGNED_BYTE, average);
+            }
+        }
+        SetGreySwizzle(job.target, job.channels);
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, topLevel);
+        glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, topLevel);
+        job.level = job.mipmaps ? std::max(topLevel - 1, 0) : 0;
+        job.allocated = true;
+    }
+
+    // the mips in between, smallest first, each one widens the sampled range
+    while (job.level > 0 && budget > 0) {
+        for (unsigned int face = 0; face < job.pixels.size(); face++) {
+            const std::vector<unsigned char> &mip = job.mips[face * topLevel + job.level - 1];
+            glTexImage2D(FaceTarget(job.target, face), job.level, internalFormat, std::max(job.width >> job.level, 1),
+                         std::max(job.height >> job.level, 1), 0, format, GL_UNSIGNED_BYTE, mip.data());
+            budget -= std::min(budget, mip.size());
+        }
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, job.level);
+        job.level--;
+    }
+
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    while (job.level == 0 && job.face < job.pixels.size() && budget > 0) {
+        int rows = (int)std::min<size_t>(job.height - job.row, std::max<size_t>(budget / rowBytes, 1));
+        size_t bytes = rows * rowBytes;
+
+        // orphan the previous slice so the driver never has to wait for the GPU to finish reading it
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst) {
+            memcpy(dst, job.pixels[job.face] + job.row * rowBytes, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(FaceTarget(job.target, job.face), 0, 0, job.row, job.width, rows, format, GL_UNSIGNED_BYTE, (void*)0);
+        }
+
+        budget -= std::min(budget, bytes);
+        job.row += rows;
+        if (job.row == job.height) {
+            job.row = 0;
+            job.face++;
+        }
+    }
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return job.face == job.pixels.size();
+}
+
+bool TextureLoader::UploadCompressed(Job &job, size_t &budget) {
+    GLenum format = TextureCompressor::GLFormat(job.format, job.srgb && srgbSampling);
+    int levelCount = (int)(job.levels.size() / job.faceCount);
+
+    GLState::BindTexture(job.target, job.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (!job.allocated) {
+        if (job.format == TextureCompressor::Format::BC4) SetGreySwizzle(job.target, 1);
+        job.level = levelCount - 1;
+        job.allocated = true;
+    }
+
+    // smallest level first, each one widens the sampled range so the texture sharpens as it streams in
+    while (job.level >= 0 && budget > 0) {
+        for (unsigned int face = 0; face < job.faceCount; face++) {
+            const Job::Level &level = job.levels[face * levelCount + job.level];
+            // half float panoramas are the only uncompressed levels in here
+            if (job.format == TextureCompressor::Format::RGB16F)
+                glTexImage2D(FaceTarget(job.target, face), job.level, format, level.width, level.height, 0, GL_RGB, GL_HALF_FLOAT, level.data);
+            else
+                glCompressedTexImage2D(FaceTarget(job.target, face), job.level, format, level.width, level.height, 0, (GLsizei)level.size, level.data);
+            budget -= std::min(budget, level.size);
+        }
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, job.level);
+        glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        job.level--;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return job.level < 0;
+}
+
+void TextureLoader::Finish(Job &job) {
+    if (!job.failed && job.format == TextureCompressor::Format::RGBA8) {
+        GLState::BindTexture(job.target, job.id);
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, job.mipmaps ? TopLevel(job.width, job.height) : 0);
+    }
+
+    if (!job.failed) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.requested).count();
+        timings.push_back({ job.paths[0], ms });
+    }
+
+    for (unsigned char *pixels : job.pixels) stbi_image_free(pixels);
+    job.pixels.clear();
+    job.mips.clear();
+    job.levels.clear();
+    job.compressed.clear();
+    job.cache = TextureCache::View();
+}
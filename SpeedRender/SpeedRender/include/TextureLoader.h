@@ -0,0 +1,116 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TextureCache.h"
+#include "TextureCompressor.h"
+
+// Streams images into existing texture objects. Files are decoded on the thread pool, Update() then
+// copies them through a pixel buffer object in slices, never more than uploadBudget bytes per frame.
+// Until an image is fully resident the texture samples a 1x1 placeholder, so it is always complete.
+// 2D textures requested with a block format are compressed once and cached as .srtex, their mip levels
+// then stream in smallest first. Textures and cubemaps cooked by --cook are taken from assets/cooked.
+// Uncompressed images keep the channel count of the file (R8, RG8, RGB8, RGBA8) and get their mips from
+// MipGenerator on the worker, which stream in the same way before level 0. Cubemap faces are decoded in
+// parallel.
+class TextureLoader {
+public:
+    static TextureLoader &Get();
+    ~TextureLoader();
+
+    // target is GL_TEXTURE_2D with one path, or GL_TEXTURE_CUBE_MAP with six (+X, -X, +Y, -Y, +Z, -Z) or
+    // one equirectangular panorama, which becomes a half float cubemap cached as .rgb16f.srtex
+    // srgb marks color images, their mips are filtered in linear space and srgbSampling applies to them
+    // format only applies to 2D textures, it falls back to what the driver supports
+    void Request(unsigned int id, GLenum target, const std::vector<std::string> &paths, bool mipmaps, bool srgb,
+                 TextureCompressor::Format format = TextureCompressor::Format::RGBA8);
+
+    // Drops a pending request, e.g. because its texture is being deleted
+    void Cancel(unsigned int id);
+
+    // Call once per frame on the GL thread
+    void Update();
+    // Blocks until every request is resident, ignoring the budget
+    void Flush();
+
+    size_t PendingCount() const { return jobs.size(); }
+
+    // time from Request to fully resident for every finished texture, for the startup breakdown
+    struct Timing {
+        std::string path;
+        double ms;
+    };
+    const std::vector<Timing> &GetTimings() const { return timings; }
+
+    void SetFlipOnLoad(bool flip) { flipOnLoad = flip; }
+    bool GetFlipOnLoad() const { return flipOnLoad; }
+
+    size_t uploadBudget = 8 * 1024 * 1024;
+    // off uploads everything as RGBA8, e.g. to compare against the compressed formats
+    bool compressTextures = true;
+    // Uploads color images with the sRGB formats so shaders sample linear values. Off by default because
+    // the shaders light in gamma space, turn it on together with GL_FRAMEBUFFER_SRGB.
+    bool srgbSampling = false;
+
+private:
+    struct Job {
+        unsigned int id;
+        GLenum target;
+        std::vector<std::string> paths;
+        bool flip;
+        bool mipmaps;
+        bool srgb;
+        TextureCompressor::Format format;
+        std::chrono::steady_clock::time_point requested;
+
+        // written by the decode task, read once decoded is ready
+        std::future<void> decoded;
+        std::vector<unsigned char*> pixels;
+        std::vector<std::vector<unsigned char>> mips;   // levels 1 and up of every face, face major
+        int width = 0, height = 0, channels = 0;
+        bool failed = false;
+
+        // compressed mip chain, backed by the mapped cache file or by the freshly compressed images
+        struct Level {
+            int width, height;
+            const unsigned char *data;
+            size_t size;
+        };
+        std::vector<Level> levels;
+        TextureCache::View cache;
+        std::vector<std::vector<unsigned char>> compressed;
+        std::string cookedPath;
+        unsigned int faceCount = 1;     // levels holds faceCount chains back to back
+
+        // upload progress
+        bool allocated = false;
+        unsigned int face = 0;
+        int row = 0;
+        int level = 0;
+    };
+
+    TextureLoader();
+
+    static void Decode(Job &job);
+    static void DecodeCompressed(Job &job);
+    static void DecodeEquirect(Job &job);
+    // uploads as much of job as budget allows, returns true once it is complete
+    bool Upload(Job &job, size_t &budget);
+    bool UploadCompressed(Job &job, size_t &budget);
+    void Finish(Job &job);
+
+    std::deque<std::unique_ptr<Job>> jobs;
+    std::vector<Timing> timings;
+    unsigned int pbo = 0;
+    bool flipOnLoad = false;
+};
+
+#endif
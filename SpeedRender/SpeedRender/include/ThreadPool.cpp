@@ -0,0 +1,73 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    threadCount = std::max(threadCount, 1u);
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread &worker : workers) worker.join();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+bool ThreadPool::RunPendingTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop();
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &body) {
+    if (count == 0) return;
+
+    size_t rangeCount = std::min<size_t>(count, workers.size() + 1);
+    size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+    std::vector<std::future<void>> pending;
+    for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+        size_t end = std::min(begin + rangeSize, count);
+        pending.push_back(Submit([&body, begin, end]() { body(begin, end); }));
+    }
+
+    body(0, std::min(rangeSize, count));
+
+    for (std::future<void> &f : pending) {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!RunPendingTask()) f.wait_for(std::chrono::microseconds(100));
+        }
+        f.get();
+    }
+}
+
+ThreadPool &ThreadPool::Global() {
+    // the main thread pitches in during ParallelFor, leave a core for it
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return pool;
+}
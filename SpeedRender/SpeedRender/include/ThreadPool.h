@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template <typename F>
+    auto Submit(F &&task) -> std::future<decltype(task())> {
+        // std::function needs a copyable target, so the packaged task lives behind a shared_ptr
+        auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<F>(task));
+        std::future<decltype(task())> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged]() { (*packaged)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    // Splits [0, count) into contiguous ranges, one per worker plus the caller, and blocks until all are done.
+    // Safe to call from inside a task: the caller keeps draining the queue while it waits.
+    void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &body);
+
+    // Runs one queued task on the calling thread, false if the queue was empty
+    bool RunPendingTask();
+
+    unsigned int ThreadCount() const { return (unsigned int)workers.size(); }
+
+    // shared pool sized to the machine, created on first use
+    static ThreadPool &Global();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+#endif
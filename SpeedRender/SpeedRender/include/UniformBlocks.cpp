@@ -0,0 +1,49 @@
+#include "UniformBlocks.h"
+
+namespace {
+    struct Block {
+        const char *name;
+        unsigned int binding;
+        size_t size;
+    };
+
+    template <typename T>
+    Block Describe() {
+        return { T::NAME, T::BINDING, sizeof(T) };
+    }
+
+    const Block blocks[] = {
+        Describe<UniformBlocks::Frame>(),
+        Describe<UniformBlocks::Object>(),
+        Describe<UniformBlocks::Material>()
+    };
+
+    UniformBlocks::Stats stats;
+}
+
+bool UniformBlocks::Find(std::string_view name, unsigned int &binding, size_t &size) {
+    for (const Block &block : blocks) {
+        if (name != block.name) continue;
+        binding = block.binding;
+        size = block.size;
+        return true;
+    }
+    return false;
+}
+
+size_t UniformBlocks::OffsetAlignment() {
+    static size_t alignment = []() {
+        GLint value = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        return (size_t)std::max(value, 1);
+    }();
+    return alignment;
+}
+
+UniformBlocks::Stats &UniformBlocks::GetStats() {
+    return stats;
+}
+
+void UniformBlocks::ResetStats() {
+    stats = Stats();
+}
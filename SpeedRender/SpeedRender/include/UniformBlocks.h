@@ -0,0 +1,177 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "GLState.h"
+
+// Uniform blocks shared by every program, the C++ side of assets/shaders/include/Blocks.glsl. Each struct is
+// laid out like its std140 block and the offsets are checked below, so a member that drifts out of place
+// fails the build instead of shading with garbage. Shader binds every block it finds to the struct's
+// BINDING after linking, and checks the block's size against the struct's.
+namespace UniformBlocks {
+    // light array sizes in the Frame block, MAX_LIGHTS in Blocks.glsl
+    const int MAX_LIGHTS = 8;
+
+    // std140 rounds the stride of array elements up to a vec4, whatever their type
+    template <typename T>
+    struct alignas(16) Element {
+        T value;
+    };
+
+    template <typename T, size_t N>
+    struct Array {
+        Element<T> elements[N];
+
+        T &operator[](size_t i) { return elements[i].value; }
+        const T &operator[](size_t i) const { return elements[i].value; }
+    };
+
+    // camera and lights, written once per frame
+    struct Frame {
+        static const unsigned int BINDING = 0;
+        static constexpr const char *NAME = "Frame";
+
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec3 cameraPos;
+        int lightCount;
+        Array<glm::vec3, MAX_LIGHTS> lightPositions;
+        Array<glm::vec3, MAX_LIGHTS> lightColors;
+    };
+
+    // transforms of the object being drawn
+    struct Object {
+        static const unsigned int BINDING = 1;
+        static constexpr const char *NAME = "Object";
+
+        glm::mat4 model;
+        // mat3 columns are vec4 sized in std140 anyway, a mat4 is the same size plus one column
+        glm::mat4 normalMatrix;
+
+        static Object FromModel(const glm::mat4 &model) {
+            return { model, glm::transpose(glm::inverse(model)) };
+        }
+    };
+
+    // parameters of every material shader, each reads the ones it needs
+    struct Material {
+        static const unsigned int BINDING = 2;
+        static constexpr const char *NAME = "Material";
+
+        glm::vec3 albedo;
+        float metallic;
+        glm::vec3 color;        // flat color of the unlit, wireframe and placeholder shaders
+        float roughness;
+        float ao;
+        float refractionIndex;
+        float reflectance;
+        float flatness;
+    };
+
+    static_assert(offsetof(Frame, view) == 0, "Frame.view");
+    static_assert(offsetof(Frame, projection) == 64, "Frame.projection");
+    static_assert(offsetof(Frame, viewProjection) == 128, "Frame.viewProjection");
+    static_assert(offsetof(Frame, cameraPos) == 192, "Frame.cameraPos");
+    static_assert(offsetof(Frame, lightCount) == 204, "Frame.lightCount");
+    static_assert(offsetof(Frame, lightPositions) == 208, "Frame.lightPositions");
+    static_assert(offsetof(Frame, lightColors) == 208 + 16 * MAX_LIGHTS, "Frame.lightColors");
+    static_assert(sizeof(Frame) == 208 + 32 * MAX_LIGHTS, "Frame size");
+
+    static_assert(offsetof(Object, model) == 0, "Object.model");
+    static_assert(offsetof(Object, normalMatrix) == 64, "Object.normalMatrix");
+    static_assert(sizeof(Object) == 128, "Object size");
+
+    static_assert(offsetof(Material, albedo) == 0, "Material.albedo");
+    static_assert(offsetof(Material, metallic) == 12, "Material.metallic");
+    static_assert(offsetof(Material, color) == 16, "Material.color");
+    static_assert(offsetof(Material, roughness) == 28, "Material.roughness");
+    static_assert(offsetof(Material, ao) == 32, "Material.ao");
+    static_assert(offsetof(Material, refractionIndex) == 36, "Material.refractionIndex");
+    static_assert(offsetof(Material, reflectance) == 40, "Material.reflectance");
+    static_assert(offsetof(Material, flatness) == 44, "Material.flatness");
+    static_assert(sizeof(Material) == 48, "Material size");
+
+    // the binding point and struct size of a block by its GLSL name, false for blocks not declared here
+    bool Find(std::string_view name, unsigned int &binding, size_t &size);
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, queried once
+    size_t OffsetAlignment();
+
+    // Push calls since the last ResetStats, all blocks together
+    struct Stats {
+        unsigned int uploads = 0;
+        unsigned int skipped = 0;   // same value as the last push
+    };
+
+    Stats &GetStats();
+    // once per frame, like Shader::ResetUniformStats
+    void ResetStats();
+}
+
+// A GL buffer holding slots of one block, each pushed value goes to a fresh slot and is bound to the block's
+// binding point. Once the slots run out the storage is orphaned and refilled from the start, so a write
+// never has to wait on a draw still reading an earlier slot. Pushing the value already bound is free.
+// Only one buffer per block type should be live, skipped pushes trust the binding point is still theirs.
+template <typename T>
+class UniformBuffer {
+    static_assert(sizeof(T) % 16 == 0, "std140 blocks are padded to a multiple of 16 bytes");
+    static_assert(std::is_trivially_copyable<T>::value, "blocks are copied to the GPU byte for byte");
+
+public:
+    // slots is how many values can be pushed before the storage is orphaned, a few per frame for per object blocks
+    explicit UniformBuffer(unsigned int slots = 1) : slots(std::max(slots, 1u)) {
+        size_t alignment = UniformBlocks::OffsetAlignment();
+        stride = (sizeof(T) + alignment - 1) / alignment * alignment;
+
+        glGenBuffers(1, &id);
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, id);
+        glBufferData(GL_UNIFORM_BUFFER, stride * this->slots, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    ~UniformBuffer() {
+        GLState::ForgetBuffer(id);
+        glDeleteBuffers(1, &id);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer &operator=(const UniformBuffer&) = delete;
+
+    void Push(const T &value) {
+        if (pushed && memcmp(&last, &value, sizeof(T)) == 0) {
+            UniformBlocks::GetStats().skipped++;
+            return;
+        }
+
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, id);
+        if (cursor == slots) {
+            glBufferData(GL_UNIFORM_BUFFER, stride * slots, nullptr, GL_DYNAMIC_DRAW);
+            cursor = 0;
+        }
+        glBufferSubData(GL_UNIFORM_BUFFER, cursor * stride, sizeof(T), &value);
+        GLState::BindBufferRange(GL_UNIFORM_BUFFER, T::BINDING, id, cursor * stride, sizeof(T));
+
+        cursor++;
+        last = value;
+        pushed = true;
+        UniformBlocks::GetStats().uploads++;
+    }
+
+private:
+    unsigned int id = 0;
+    unsigned int slots;
+    unsigned int cursor = 0;
+    size_t stride;
+    T last;
+    bool pushed = false;
+};
+
+#endif
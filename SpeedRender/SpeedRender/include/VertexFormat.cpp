@@ -0,0 +1,169 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
+#include "Mesh.h"
+
+namespace {
+    const float UNORM16_MAX = 65535.0f;
+    const float SNORM16_MAX = 32767.0f;
+
+    uint16_t QuantizeUnorm(float value, float offset, float scale) {
+        if (scale <= 0.0f) return 0;
+        float t = std::min(std::max((value - offset) / scale, 0.0f), 1.0f);
+        return (uint16_t)std::lround(t * UNORM16_MAX);
+    }
+
+    float DequantizeUnorm(uint16_t value, float offset, float scale) {
+        return value / UNORM16_MAX * scale + offset;
+    }
+
+    // GL 4.2+ snorm conversion, which every driver we run on uses even in a 3.3 context
+    float DequantizeSnorm(int16_t value) {
+        return std::max(value / SNORM16_MAX, -1.0f);
+    }
+
+    glm::vec2 OctWrap(const glm::vec2 &v) {
+        return glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+    }
+}
+
+const char *VertexFormat::LayoutName(Layout layout) {
+    switch (layout) {
+        case Layout::Float: return "float";
+        case Layout::Packed: return "packed";
+        case Layout::PackedUnormUV: return "packed-unorm-uv";
+    }
+    return "unknown";
+}
+
+size_t VertexFormat::Stride(Layout layout) {
+    return layout == Layout::Float ? sizeof(Vertex) : sizeof(PackedVertex);
+}
+
+VertexFormat::Dequantization VertexFormat::ComputeDequantization(Layout layout, const Vertex *vertices, size_t count, const AABB &bounds) {
+    Dequantization dequantization;
+    if (layout == Layout::Float) return dequantization;
+
+    dequantization.positionOffset = bounds.min;
+    dequantization.positionScale = bounds.max - bounds.min;
+    dequantization.octNormals = true;
+
+    if (layout == Layout::PackedUnormUV && count > 0) {
+        glm::vec2 uvMin = vertices[0].texCoords, uvMax = vertices[0].texCoords;
+        for (size_t i = 1; i < count; i++) {
+            uvMin = glm::min(uvMin, vertices[i].texCoords);
+            uvMax = glm::max(uvMax, vertices[i].texCoords);
+        }
+        dequantization.uvOffset = uvMin;
+        dequantization.uvScale = uvMax - uvMin;
+    }
+    return dequantization;
+}
+
+void VertexFormat::Pack(const Vertex *vertices, size_t count, const Dequantization &dequantization, Layout layout, PackedVertex *out) {
+    const Dequantization &d = dequantization;
+    for (size_t i = 0; i < count; i++) {
+        const Vertex &v = vertices[i];
+        PackedVertex &p = out[i];
+
+        for (int c = 0; c < 3; c++)
+            p.position[c] = QuantizeUnorm(v.position[c], d.positionOffset[c], d.positionScale[c]);
+        p.position[3] = 0;
+
+        OctEncode(v.normal, p.normal);
+
+        for (int c = 0; c < 2; c++) {
+            if (layout == Layout::PackedUnormUV) p.texCoords[c] = QuantizeUnorm(v.texCoords[c], d.uvOffset[c], d.uvScale[c]);
+            else p.texCoords[c] = glm::packHalf1x16(v.texCoords[c]);
+        }
+    }
+}
+
+void VertexFormat::Unpack(const PackedVertex *packed, size_t count, const Dequantization &dequantization, Layout layout, Vertex *out) {
+    const Dequantization &d = dequantization;
+    for (size_t i = 0; i < count; i++) {
+        const PackedVertex &p = packed[i];
+        Vertex &v = out[i];
+
+        for (int c = 0; c < 3; c++)
+            v.position[c] = DequantizeUnorm(p.position[c], d.positionOffset[c], d.positionScale[c]);
+
+        v.normal = OctDecode(p.normal);
+
+        for (int c = 0; c < 2; c++) {
+            if (layout == Layout::PackedUnormUV) v.texCoords[c] = DequantizeUnorm(p.texCoords[c], d.uvOffset[c], d.uvScale[c]);
+            else v.texCoords[c] = glm::unpackHalf1x16(p.texCoords[c]);
+        }
+    }
+}
+
+VertexFormat::Error VertexFormat::Measure(const Vertex *vertices, size_t count, const AABB &bounds, Layout layout) {
+    Error error;
+    if (layout == Layout::Float) return error;
+
+    Dequantization dequantization = ComputeDequantization(layout, vertices, count, bounds);
+    std::vector<PackedVertex> packed(count);
+    std::vector<Vertex> unpacked(count);
+    Pack(vertices, count, dequantization, layout, packed.data());
+    Unpack(packed.data(), count, dequantization, layout, unpacked.data());
+
+    for (size_t i = 0; i < count; i++) {
+        const Vertex &a = vertices[i], &b = unpacked[i];
+        glm::vec3 dp = glm::abs(a.position - b.position);
+        glm::vec2 duv = glm::abs(a.texCoords - b.texCoords);
+        error.position = std::max(error.position, std::max(dp.x, std::max(dp.y, dp.z)));
+        error.uv = std::max(error.uv, std::max(duv.x, duv.y));
+
+        // atan2 instead of acos, which has no precision left for angles this small
+        float length = glm::length(a.normal);
+        if (length > 0.0f) {
+            glm::vec3 n = a.normal / length;
+            float angle = std::atan2(glm::length(glm::cross(n, b.normal)), glm::dot(n, b.normal));
+            error.normalDegrees = std::max(error.normalDegrees, glm::degrees(angle));
+        }
+    }
+    return error;
+}
+
+void VertexFormat::OctEncode(const glm::vec3 &n, int16_t out[2]) {
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 <= 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    glm::vec2 e = glm::vec2(n.x, n.y) / l1;
+    if (n.z < 0.0f) e = OctWrap(e);
+
+    // try both roundings per axis and keep the one that decodes closest to n
+    glm::vec3 target = n / glm::length(n);
+    float best = -2.0f;
+    for (int i = 0; i < 4; i++) {
+        int16_t candidate[2];
+        for (int c = 0; c < 2; c++) {
+            float scaled = std::min(std::max(e[c], -1.0f), 1.0f) * SNORM16_MAX;
+            float rounded = ((i >> c) & 1) ? std::ceil(scaled) : std::floor(scaled);
+            candidate[c] = (int16_t)std::min(std::max(rounded, -SNORM16_MAX), SNORM16_MAX);
+        }
+        float similarity = glm::dot(OctDecode(candidate), target);
+        if (similarity > best) {
+            best = similarity;
+            out[0] = candidate[0];
+            out[1] = candidate[1];
+        }
+    }
+}
+
+glm::vec3 VertexFormat::OctDecode(const int16_t in[2]) {
+    glm::vec2 e(DequantizeSnorm(in[0]), DequantizeSnorm(in[1]));
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
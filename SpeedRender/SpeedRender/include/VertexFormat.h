@@ -0,0 +1,62 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Core.h"
+
+struct Vertex;
+
+// Compact GPU layouts for mesh vertices. Meshes keep loading and caching full float Vertex arrays and
+// are packed right before upload, MainVertex.vert undoes the packing with the mesh's Dequantization.
+namespace VertexFormat {
+    enum class Layout : uint32_t {
+        Float,          // 32 bytes, the Vertex struct as is
+        Packed,         // 16 bytes, 16 bit positions in the mesh AABB, octahedral normals, half float UVs
+        PackedUnormUV   // 16 bytes, as Packed but with 16 bit UVs in the mesh's UV range
+    };
+
+    // positions are 3 x unorm16 plus padding, normals 2 x snorm16 on the octahedron, UVs 2 x half or unorm16
+    struct PackedVertex {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t texCoords[2];
+    };
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+    // maps what the vertex shader reads back to model space, value * scale + offset
+    struct Dequantization {
+        glm::vec3 positionOffset = glm::vec3(0.0f);
+        glm::vec3 positionScale = glm::vec3(1.0f);
+        glm::vec2 uvOffset = glm::vec2(0.0f);
+        glm::vec2 uvScale = glm::vec2(1.0f);
+        bool octNormals = false;
+    };
+
+    // largest difference between the original and the unpacked vertices
+    struct Error {
+        float position = 0.0f;      // model space units
+        float normalDegrees = 0.0f;
+        float uv = 0.0f;
+    };
+
+    const char *LayoutName(Layout layout);
+    size_t Stride(Layout layout);
+
+    Dequantization ComputeDequantization(Layout layout, const Vertex *vertices, size_t count, const AABB &bounds);
+
+    void Pack(const Vertex *vertices, size_t count, const Dequantization &dequantization, Layout layout, PackedVertex *out);
+    void Unpack(const PackedVertex *packed, size_t count, const Dequantization &dequantization, Layout layout, Vertex *out);
+
+    // Packs and unpacks vertices and reports the worst error. Zero normals (meshes without normals)
+    // are skipped.
+    Error Measure(const Vertex *vertices, size_t count, const AABB &bounds, Layout layout);
+
+    // Octahedral mapping of a unit vector to [-1, 1]^2. The encoder picks whichever of the four
+    // neighbouring snorm16 values decodes closest to n instead of plain rounding.
+    void OctEncode(const glm::vec3 &n, int16_t out[2]);
+    glm::vec3 OctDecode(const int16_t in[2]);
+}
+
+#endif